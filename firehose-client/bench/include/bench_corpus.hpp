@@ -0,0 +1,68 @@
+#pragma once
+#include "frame_builder.hpp"
+#include "nlohmann/json.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Recorded content shared with the unit tests, copied alongside the binary
+constexpr const char *DataPath = "./data/";
+
+inline nlohmann::json load_json(std::string const &filename) {
+  std::ifstream ifs(std::string(DataPath) + filename);
+  if (!ifs.is_open())
+    throw std::runtime_error("cannot open " + filename);
+  return nlohmann::json::parse(ifs);
+}
+
+// Recorded follow commit, plus post and profile commits built from the
+// recorded jetstream records
+inline std::vector<std::vector<uint8_t>> const &corpus() {
+  static const std::vector<std::vector<uint8_t>> frames([] {
+    std::vector<std::vector<uint8_t>> result;
+    result.emplace_back(make_frame(
+        "#commit", restore_binary(load_json("raw_firehose_commit.json"))));
+    auto post(load_json("post.json"));
+    result.emplace_back(
+        make_commit_frame(post["did"].template get<std::string>(),
+                          post["commit"]["record"], "3lc23oncbdk2l", 2));
+    auto profile(load_json("profile.json"));
+    result.emplace_back(
+        make_commit_frame(profile["did"].template get<std::string>(),
+                          profile["commit"]["record"], "self", 3));
+    return result;
+  }());
+  return frames;
+}
+
+// jetstream records: 0 = post, 1 = profile, 2 = profile that matches rules
+inline std::vector<nlohmann::json> const &records() {
+  static const std::vector<nlohmann::json> loaded([] {
+    std::vector<nlohmann::json> result;
+    for (auto const &filename :
+         {"post.json", "profile.json", "abusive_profile.json"}) {
+      result.push_back(load_json(filename)["commit"]["record"]);
+    }
+    return result;
+  }());
+  return loaded;
+}
+
+// Post and profile commits for the relay stand-in to stamp with seq, rev,
+// repo and time as it sends them, see relay_standin.hpp
+inline std::vector<std::vector<uint8_t>> synthetic_frames() {
+  std::vector<std::vector<uint8_t>> result;
+  // encodes as an 8-byte integer whatever seq is sent
+  constexpr int64_t SeqPlaceholder = 0x0100000000000000;
+  const std::string RevPlaceholder("2222222222222");
+  auto post(load_json("post.json"));
+  result.emplace_back(make_commit_frame(
+      post["did"].template get<std::string>(), post["commit"]["record"],
+      "3lc23oncbdk2l", SeqPlaceholder, RevPlaceholder));
+  auto profile(load_json("profile.json"));
+  result.emplace_back(make_commit_frame(
+      profile["did"].template get<std::string>(), profile["commit"]["record"],
+      "self", SeqPlaceholder, RevPlaceholder));
+  return result;
+}
@@ -0,0 +1,462 @@
+#pragma once
+#include "capture_log.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <zstd.h>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+namespace ssl = boost::asio::ssl;
+using tcp = boost::asio::ip::tcp;
+
+// A #commit frame with the fields the stand-in rewrites per send located
+// once, so each frame is a copy-free patch of the encoded bytes
+class frame_template {
+public:
+  explicit frame_template(std::vector<uint8_t> &&frame)
+      : _frame(std::move(frame)) {
+    // CBOR text key followed by the header of the placeholder value
+    static constexpr std::array<uint8_t, 5> SeqKey = {0x63, 's', 'e', 'q',
+                                                      0x1b};
+    static constexpr std::array<uint8_t, 5> RevKey = {0x63, 'r', 'e', 'v',
+                                                      0x6d};
+    static constexpr std::array<uint8_t, 7> TimeKey = {0x64, 't', 'i', 'm',
+                                                       'e',  0x78, 0x18};
+    static constexpr std::array<uint8_t, 7> RepoKey = {0x64, 'r', 'e', 'p',
+                                                       'o',  0x78, 0x20};
+    _seq = locate(SeqKey);
+    _rev = locate(RevKey);
+    _time = locate(TimeKey);
+    _repo = locate(RepoKey);
+    if (_seq == 0 || _rev == 0 || _time == 0)
+      throw std::invalid_argument("frame has no seq, rev or time placeholder");
+  }
+
+  static constexpr size_t TimeLength = 24;
+
+  // Each seq has its own rev and one of repo_count repos. The repo is only
+  // varied for did:plc, which has a fixed length.
+  std::span<const uint8_t> render(const int64_t seq, const uint32_t repo_count,
+                                  std::string_view time_stamp) {
+    for (size_t index = 0; index < 8; ++index) {
+      _frame[_seq + index] = static_cast<uint8_t>(
+          static_cast<uint64_t>(seq) >> (56 - 8 * index));
+    }
+    // TID order follows seq order
+    constexpr uint64_t BaseMicroseconds = 1700000000000000;
+    uint64_t tid((BaseMicroseconds + static_cast<uint64_t>(seq)) << 10);
+    for (size_t index = 0; index < 13; ++index) {
+      _frame[_rev + index] = static_cast<uint8_t>(
+          TidAlphabet[(tid >> (60 - 5 * index)) & 0x1f]);
+    }
+    if (_repo != 0 && repo_count > 0) {
+      uint32_t repo(static_cast<uint32_t>(static_cast<uint64_t>(seq) %
+                                          repo_count));
+      // last 6 characters of the 32-character did:plc
+      for (size_t index = 0; index < 6; ++index) {
+        _frame[_repo + 26 + index] = static_cast<uint8_t>(
+            PlcAlphabet[(repo >> (25 - 5 * index)) & 0x1f]);
+      }
+    }
+    std::memcpy(_frame.data() + _time, time_stamp.data(),
+                std::min(time_stamp.size(), TimeLength));
+    return _frame;
+  }
+
+private:
+  static constexpr std::string_view TidAlphabet =
+      "234567abcdefghijklmnopqrstuvwxyz";
+  static constexpr std::string_view PlcAlphabet =
+      "abcdefghijklmnopqrstuvwxyz234567";
+
+  // offset of the value following key, 0 if not present
+  template <size_t N> size_t locate(std::array<uint8_t, N> const &key) const {
+    auto found(std::ranges::search(_frame, key));
+    return found.empty()
+               ? 0
+               : static_cast<size_t>(found.end() - _frame.cbegin());
+  }
+
+  std::vector<uint8_t> _frame;
+  size_t _seq = 0;
+  size_t _rev = 0;
+  size_t _time = 0;
+  size_t _repo = 0;
+};
+
+// Local stand-in for a relay's com.atproto.sync.subscribeRepos endpoint, for
+// end-to-end throughput tests of the firehose client. Serves synthetic
+// #commit frames, or the frames in a capture log, at a configurable rate and
+// from the ?cursor= the client asks for, optionally zstd-compressed with a
+// dictionary. Each client connection has its own sending thread.
+class relay_standin {
+public:
+  struct options {
+    // 0 picks a free port, see port()
+    unsigned short _port = 0;
+    // self-signed certificate, the client does not verify it
+    bool _tls = false;
+    // frames per second, 0 sends as fast as the client reads
+    double _rate = 1000.0;
+    // serve this capture log instead of synthetic frames
+    std::string _capture_directory;
+    // distinct repos in synthetic traffic
+    uint32_t _repo_count = 100000;
+    // compress each frame with this dictionary, as Jetstream does
+    std::string _zstd_dictionary;
+    // run first on each stand-in thread, e.g. to leave it out of a
+    // measurement of the in-process client
+    std::function<void()> _on_thread_start;
+  };
+
+  relay_standin(options const &settings,
+                std::vector<std::vector<uint8_t>> const &synthetic)
+      : _options(settings), _synthetic(synthetic), _rate(settings._rate) {
+    if (_options._capture_directory.empty() && _synthetic.empty())
+      throw std::invalid_argument("relay stand-in has no frames to serve");
+  }
+  ~relay_standin() { stop(); }
+  relay_standin(relay_standin const &) = delete;
+  relay_standin &operator=(relay_standin const &) = delete;
+
+  void start() {
+    if (_options._tls) {
+      use_self_signed_certificate();
+    }
+    if (!_options._zstd_dictionary.empty()) {
+      load_dictionary();
+    }
+    _acceptor.open(tcp::v4());
+    _acceptor.set_option(net::socket_base::reuse_address(true));
+    _acceptor.bind({net::ip::make_address("127.0.0.1"), _options._port});
+    _acceptor.listen();
+    _port = _acceptor.local_endpoint().port();
+    _accept_thread = std::thread([this] {
+      on_thread_start();
+      accept_connections();
+    });
+  }
+
+  void stop() {
+    if (_stopping.exchange(true) || !_accept_thread.joinable())
+      return;
+    // wake the blocking accept
+    boost::system::error_code ec;
+    tcp::socket wake(_ioc);
+    wake.connect({net::ip::make_address("127.0.0.1"), _port}, ec);
+    _accept_thread.join();
+    {
+      // unblocks a write to a client that has stopped reading
+      std::lock_guard guard(_sockets_lock);
+      for (auto socket : _sockets) {
+        socket->shutdown(tcp::socket::shutdown_both, ec);
+      }
+    }
+    std::lock_guard guard(_lock);
+    for (auto &connection : _connections) {
+      connection.join();
+    }
+  }
+
+  unsigned short port() const { return _port; }
+  void set_rate(const double rate) { _rate = rate; }
+  double rate() const { return _rate; }
+  // highest seq sent on any connection
+  int64_t head() const { return _head; }
+  uint64_t frames_sent() const { return _frames_sent; }
+
+private:
+  // registers a session's socket for stop() to shut down
+  class tracked_socket {
+  public:
+    tracked_socket(relay_standin &owner, tcp::socket &socket)
+        : _owner(owner), _socket(socket) {
+      std::lock_guard guard(_owner._sockets_lock);
+      _owner._sockets.push_back(&_socket);
+    }
+    ~tracked_socket() {
+      std::lock_guard guard(_owner._sockets_lock);
+      std::erase(_owner._sockets, &_socket);
+    }
+
+  private:
+    relay_standin &_owner;
+    tcp::socket &_socket;
+  };
+
+  void use_self_signed_certificate() {
+    std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(EVP_RSA_gen(2048),
+                                                            &EVP_PKEY_free);
+    std::unique_ptr<X509, decltype(&X509_free)> certificate(X509_new(),
+                                                            &X509_free);
+    if (!key || !certificate)
+      throw std::runtime_error("cannot create relay stand-in certificate");
+    X509_set_version(certificate.get(), 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate.get()), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate.get()), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate.get()), 7 * 24 * 60 * 60);
+    X509_set_pubkey(certificate.get(), key.get());
+    X509_NAME *name(X509_get_subject_name(certificate.get()));
+    X509_NAME_add_entry_by_txt(
+        name, "CN", MBSTRING_ASC,
+        reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(certificate.get(), name);
+    if (X509_sign(certificate.get(), key.get(), EVP_sha256()) == 0 ||
+        SSL_CTX_use_certificate(_ssl.native_handle(), certificate.get()) !=
+            1 ||
+        SSL_CTX_use_PrivateKey(_ssl.native_handle(), key.get()) != 1)
+      throw std::runtime_error("cannot use relay stand-in certificate");
+  }
+
+  void load_dictionary() {
+    std::ifstream file(_options._zstd_dictionary, std::ios::binary);
+    if (!file.is_open())
+      throw std::invalid_argument("cannot open " + _options._zstd_dictionary);
+    std::vector<char> content((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    _dictionary.reset(ZSTD_createCDict(content.data(), content.size(),
+                                       ZSTD_CLEVEL_DEFAULT));
+    if (!_dictionary)
+      throw std::invalid_argument("cannot load " + _options._zstd_dictionary);
+  }
+
+  void on_thread_start() const {
+    if (_options._on_thread_start) {
+      _options._on_thread_start();
+    }
+  }
+
+  void accept_connections() {
+    while (!_stopping) {
+      boost::system::error_code ec;
+      tcp::socket socket(_ioc);
+      _acceptor.accept(socket, ec);
+      if (_stopping || ec)
+        continue;
+      socket.set_option(tcp::no_delay(true));
+      std::lock_guard guard(_lock);
+      _connections.emplace_back(
+          [this, socket = std::move(socket)]() mutable {
+            on_thread_start();
+            try {
+              if (_options._tls) {
+                websocket::stream<ssl::stream<tcp::socket>> ws(
+                    std::move(socket), _ssl);
+                serve(ws);
+              } else {
+                websocket::stream<tcp::socket> ws(std::move(socket));
+                serve(ws);
+              }
+            } catch (std::exception const &) {
+              // client went away, or stop() closed the session
+            }
+          });
+    }
+  }
+
+  template <typename STREAM> void serve(STREAM &ws) {
+    tracked_socket tracked(*this, beast::get_lowest_layer(ws));
+    if (_stopping)
+      return;
+    if constexpr (!std::is_same_v<STREAM, websocket::stream<tcp::socket>>) {
+      ws.next_layer().handshake(ssl::stream_base::server);
+    }
+    beast::flat_buffer buffer;
+    http::request<http::string_body> request;
+    http::read(ws.next_layer(), buffer, request);
+    if (!websocket::is_upgrade(request))
+      return;
+    ws.accept(request);
+    ws.binary(true);
+    auto target(request.target());
+    int64_t cursor(cursor_of(std::string_view(target.data(), target.size())));
+    if (_options._capture_directory.empty()) {
+      serve_synthetic(ws, cursor);
+    } else {
+      serve_capture(ws, cursor);
+    }
+  }
+
+  template <typename STREAM>
+  void serve_synthetic(STREAM &ws, const int64_t cursor) {
+    // each connection stamps its own copies
+    std::vector<frame_template> templates;
+    for (auto frame : _synthetic) {
+      templates.emplace_back(std::move(frame));
+    }
+    int64_t seq(cursor > 0 ? cursor + 1 : _head + 1);
+    std::string time_stamp;
+    auto stamped(std::chrono::sys_time<std::chrono::milliseconds>::min());
+    pace(ws, [&]() -> std::span<const uint8_t> {
+      auto now(std::chrono::floor<std::chrono::milliseconds>(
+          std::chrono::system_clock::now()));
+      if (now != stamped) {
+        auto seconds(std::chrono::floor<std::chrono::seconds>(now));
+        time_stamp = std::format("{:%FT%T}.{:03}Z", seconds,
+                                 (now - seconds).count());
+        stamped = now;
+      }
+      auto &next(templates[static_cast<size_t>(seq) % templates.size()]);
+      return next.render(seq++, _options._repo_count, time_stamp);
+    });
+  }
+
+  // a capture is served once per connection, the session then idles
+  template <typename STREAM>
+  void serve_capture(STREAM &ws, const int64_t cursor) {
+    capture_reader reader(_options._capture_directory);
+    if (cursor > 0) {
+      reader.seek(cursor + 1);
+    }
+    captured_frame frame;
+    bool done(false);
+    pace(ws, [&]() -> std::span<const uint8_t> {
+      if (done || !reader.next(frame)) {
+        done = true;
+        return {};
+      }
+      return frame._frame;
+    });
+  }
+
+  // Sends frames at the current rate until stopped. Unused credit is capped
+  // so a slow client sees the offered rate, not a catch-up burst.
+  template <typename STREAM, typename NEXT>
+  void pace(STREAM &ws, NEXT const &next_frame) {
+    constexpr size_t Unpaced = 64;
+    constexpr double MaxCreditSeconds = 0.1;
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> compressor(
+        _dictionary ? ZSTD_createCCtx() : nullptr, &ZSTD_freeCCtx);
+    std::vector<uint8_t> compressed;
+    auto last(std::chrono::steady_clock::now());
+    double credit(0.0);
+    while (!_stopping) {
+      const double rate(_rate);
+      size_t due(Unpaced);
+      if (rate > 0.0) {
+        auto now(std::chrono::steady_clock::now());
+        credit = std::min(
+            credit + std::chrono::duration<double>(now - last).count() * rate,
+            std::max(rate * MaxCreditSeconds, 1.0));
+        last = now;
+        due = static_cast<size_t>(credit);
+        credit -= static_cast<double>(due);
+      }
+      for (size_t count = 0; count < due && !_stopping; ++count) {
+        auto frame(next_frame());
+        if (frame.empty()) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+          break;
+        }
+        if (compressor) {
+          compressed.resize(ZSTD_compressBound(frame.size()));
+          size_t size(ZSTD_compress_usingCDict(
+              compressor.get(), compressed.data(), compressed.size(),
+              frame.data(), frame.size(), _dictionary.get()));
+          if (ZSTD_isError(size))
+            throw std::runtime_error(ZSTD_getErrorName(size));
+          ws.write(net::buffer(compressed.data(), size));
+        } else {
+          ws.write(net::buffer(frame.data(), frame.size()));
+        }
+        ++_frames_sent;
+        int64_t seq(sequence_of(frame));
+        int64_t head(_head);
+        while (seq > head && !_head.compare_exchange_weak(head, seq)) {
+        }
+      }
+      if (due == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    // no close handshake, the client may not be reading
+    boost::system::error_code ec;
+    beast::get_lowest_layer(ws).shutdown(tcp::socket::shutdown_both, ec);
+  }
+
+  // seq as placed by frame_template, or from a capture
+  static int64_t sequence_of(std::span<const uint8_t> frame) {
+    static constexpr std::array<uint8_t, 4> SeqKey = {0x63, 's', 'e', 'q'};
+    auto found(std::ranges::search(frame, SeqKey));
+    if (found.empty() || found.end() == frame.end())
+      return -1;
+    size_t offset(static_cast<size_t>(found.end() - frame.begin()));
+    uint8_t header(frame[offset]);
+    if (header < 0x18)
+      return header;
+    size_t width(header == 0x18   ? 1
+                 : header == 0x19 ? 2
+                 : header == 0x1a ? 4
+                 : header == 0x1b ? 8
+                                  : 0);
+    if (width == 0 || offset + width >= frame.size())
+      return -1;
+    uint64_t value(0);
+    for (size_t index = 1; index <= width; ++index) {
+      value = (value << 8) | frame[offset + index];
+    }
+    return static_cast<int64_t>(value);
+  }
+
+  static int64_t cursor_of(std::string_view target) {
+    constexpr std::string_view Cursor = "cursor=";
+    size_t query(target.find('?'));
+    if (query == std::string_view::npos)
+      return 0;
+    size_t found(target.find(Cursor, query));
+    if (found == std::string_view::npos)
+      return 0;
+    int64_t cursor(0);
+    auto start(target.data() + found + Cursor.size());
+    std::from_chars(start, target.data() + target.size(), cursor);
+    return cursor;
+  }
+
+  options _options;
+  std::vector<std::vector<uint8_t>> _synthetic;
+  std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> _dictionary{
+      nullptr, &ZSTD_freeCDict};
+  std::atomic<double> _rate;
+  std::atomic<int64_t> _head = 0;
+  std::atomic<uint64_t> _frames_sent = 0;
+  std::atomic<bool> _stopping = false;
+  unsigned short _port = 0;
+
+  net::io_context _ioc;
+  ssl::context _ssl{ssl::context::tlsv12_server};
+  tcp::acceptor _acceptor{_ioc};
+  std::thread _accept_thread;
+  std::mutex _lock;
+  std::vector<std::thread> _connections;
+  std::mutex _sockets_lock;
+  std::vector<tcp::socket *> _sockets;
+};
@@ -0,0 +1,305 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "bench_corpus.hpp"
+#include "common/config.hpp"
+#include "common/controller.hpp"
+#include "common/metrics_factory.hpp"
+#include "datasource.hpp"
+#include "matcher.hpp"
+#include "payload.hpp"
+#include "project_defs.hpp"
+#include "relay_standin.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// End-to-end ingest throughput: datasource<firehose_payload> reads from an
+// in-process relay stand-in whose rate is raised in steps until the pipeline
+// saturates, that is it falls behind the offered rate or its queues grow.
+// With --relays N the client subscribes to N stand-ins serving the same
+// sequence, so all but one copy of each commit is dropped as a duplicate.
+// With --count-allocations the client's heap allocations per handled frame
+// are shown for each step, websocket read to recording.
+
+// Heap allocations made through operator new, when counting, on the client's
+// threads. The stand-in's threads and this harness's own are left out.
+namespace {
+std::atomic<bool> counting(false);
+std::atomic<uint64_t> allocations(0);
+thread_local bool uncounted(false);
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (counting.load(std::memory_order_relaxed) && !uncounted)
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+struct harness_options {
+  bool _tls = false;
+  bool _count_allocations = false;
+  size_t _relays = 1;
+  std::string _capture_directory;
+  size_t _decode_threads = 4;
+  double _start_rate = 2000.0;
+  double _step_factor = 1.5;
+  double _max_rate = 1000000.0;
+  int _step_seconds = 10;
+};
+
+// queues between websocket and recording, see stage_queue labels
+double total_backlog() {
+  auto &gauges(metrics_factory::instance().get_gauge("process_operation"));
+  return gauges.Get({{"message", "decode_backlog"}}).Value() +
+         gauges.Get({{"message", "reorder_pending"}}).Value() +
+         gauges.Get({{"message", "backlog"}}).Value() +
+         gauges.Get({{"events", "backlog"}}).Value();
+}
+
+struct latency_snapshot {
+  std::vector<double> _upper_bounds;
+  std::vector<uint64_t> _cumulative;
+
+  static latency_snapshot take() {
+    latency_snapshot snapshot;
+    for (auto const &family : metrics_factory::instance()
+                                  .get_histogram("firehose_ingest_latency")
+                                  .Collect()) {
+      for (auto const &metric : family.metric) {
+        for (auto const &bucket : metric.histogram.bucket) {
+          snapshot._upper_bounds.push_back(bucket.upper_bound);
+          snapshot._cumulative.push_back(bucket.cumulative_count);
+        }
+      }
+    }
+    return snapshot;
+  }
+  uint64_t count() const {
+    return _cumulative.empty() ? 0 : _cumulative.back();
+  }
+};
+
+// upper bound of the bucket holding the quantile, for samples in the step
+double quantile(latency_snapshot const &before, latency_snapshot const &after,
+                const double fraction) {
+  uint64_t total(after.count() - before.count());
+  if (total == 0)
+    return 0.0;
+  for (size_t index = 0; index < after._cumulative.size(); ++index) {
+    uint64_t prior(index < before._cumulative.size()
+                       ? before._cumulative[index]
+                       : 0);
+    if (static_cast<double>(after._cumulative[index] - prior) >=
+        fraction * static_cast<double>(total))
+      return after._upper_bounds[index];
+  }
+  return std::numeric_limits<double>::infinity();
+}
+
+std::shared_ptr<config>
+write_config(harness_options const &options,
+             std::vector<std::unique_ptr<relay_standin>> const &relays) {
+  auto filename(std::filesystem::temp_directory_path() /
+                "firehose_client_e2e.yml");
+  std::ofstream yaml(filename);
+  yaml << PROJECT_NAME << ":\n"
+       << "  datasource:\n"
+       << "    hosts:\n";
+  for (auto const &relay : relays) {
+    yaml << "      - localhost:" << relay->port() << '\n';
+  }
+  yaml << "    port: \"" << relays.front()->port() << "\"\n"
+       << "    subscription: /xrpc/com.atproto.sync.subscribeRepos\n"
+       << "    tls: " << (options._tls ? "true" : "false") << '\n'
+       << "    decode_threads: " << options._decode_threads << '\n'
+       << "  filters:\n"
+       << "    use_db: false\n"
+       << "    filename: " << DataPath << "filters\n";
+  yaml.close();
+  return std::make_shared<config>(filename.string());
+}
+
+harness_options parse_options(int argc, char **argv) {
+  harness_options options;
+  for (int arg = 1; arg < argc; ++arg) {
+    std::string option(argv[arg]);
+    bool has_value(arg + 1 < argc);
+    if (option == "--tls") {
+      options._tls = true;
+    } else if (option == "--count-allocations") {
+      options._count_allocations = true;
+    } else if (option == "--relays" && has_value) {
+      options._relays = std::max<size_t>(std::stoul(argv[++arg]), 1);
+    } else if (option == "--capture" && has_value) {
+      options._capture_directory = argv[++arg];
+    } else if (option == "--decode-threads" && has_value) {
+      options._decode_threads = std::stoul(argv[++arg]);
+    } else if (option == "--start-rate" && has_value) {
+      options._start_rate = std::stod(argv[++arg]);
+    } else if (option == "--step-factor" && has_value) {
+      options._step_factor = std::stod(argv[++arg]);
+    } else if (option == "--max-rate" && has_value) {
+      options._max_rate = std::stod(argv[++arg]);
+    } else if (option == "--step-seconds" && has_value) {
+      options._step_seconds = std::stoi(argv[++arg]);
+    } else {
+      throw std::invalid_argument("unknown option " + option);
+    }
+  }
+  if (options._step_factor <= 1.0 || options._start_rate <= 0.0 ||
+      options._step_seconds <= 0)
+    throw std::invalid_argument("rate must start positive and increase");
+  return options;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  uncounted = true;
+  try {
+    harness_options options(parse_options(argc, argv));
+
+    relay_standin::options relay_settings;
+    relay_settings._tls = options._tls;
+    relay_settings._rate = options._start_rate;
+    relay_settings._capture_directory = options._capture_directory;
+    relay_settings._on_thread_start = [] { uncounted = true; };
+    std::vector<std::unique_ptr<relay_standin>> relays;
+    for (size_t count = 0; count < options._relays; ++count) {
+      relays.push_back(std::make_unique<relay_standin>(
+          relay_settings, options._capture_directory.empty()
+                              ? synthetic_frames()
+                              : std::vector<std::vector<uint8_t>>()));
+      relays.back()->start();
+    }
+
+    std::shared_ptr<config> settings(write_config(options, relays));
+    controller::instance().set_config(settings);
+    controller::instance().start();
+
+    // as registered by main for the full firehose
+    metrics_factory::instance().add_counter(
+        "automation",
+        "Automated moderation activity: block-list, report, emit-event");
+    metrics_factory::instance().add_counter(
+        "realtime_alerts", "Alerts generated for possibly suspect activity");
+    metrics_factory::instance().add_gauge("process_operation",
+                                          "Statistics about process internals");
+    metrics_factory::instance().add_counter(
+        "match_prefilter", "Candidates rejected by the prefilter or passed on");
+    metrics_factory::instance().add_counter(
+        "match_cache", "Candidate match verdicts found in the cache or not");
+    matcher::shared().set_config(
+        settings->get_config()[PROJECT_NAME]["filters"]);
+
+    datasource<firehose_payload>::instance().set_config(settings, 0);
+    datasource<firehose_payload>::instance().start();
+
+    // all relays' frames, duplicates included
+    auto inbound([&] {
+      auto &counter(metrics_factory::instance().get_counter(
+          "websocket_inbound_messages"));
+      double total(0.0);
+      for (auto const &relay : relays) {
+        std::string host("localhost:" + std::to_string(relay->port()));
+        total += counter.Get({{"host", host}}).Value();
+      }
+      return total;
+    });
+    std::cout << std::format("{:>10} {:>10} {:>10} {:>10} {:>8} {:>8}",
+                             "offered/s", "inbound/s", "handled/s", "backlog",
+                             "p50 ms", "p99 ms");
+    if (options._count_allocations) {
+      std::cout << std::format(" {:>10}", "allocs/fr");
+      counting = true;
+    }
+    std::cout << '\n';
+    double sustained(0.0);
+    for (double rate = options._start_rate;
+         rate <= options._max_rate && controller::instance().is_active();
+         rate *= options._step_factor) {
+      for (auto &relay : relays) {
+        relay->set_rate(rate);
+      }
+      const double seconds(static_cast<double>(options._step_seconds));
+      const double inbound_before(inbound());
+      const double backlog_before(total_backlog());
+      const uint64_t allocations_before(allocations.load());
+      latency_snapshot latency_before(latency_snapshot::take());
+      std::this_thread::sleep_for(std::chrono::seconds(options._step_seconds));
+      const double inbound_rate((inbound() - inbound_before) / seconds);
+      const double backlog(total_backlog());
+      const uint64_t allocations_after(allocations.load());
+      latency_snapshot latency_after(latency_snapshot::take());
+      const double handled_rate(
+          static_cast<double>(latency_after.count() - latency_before.count()) /
+          seconds);
+      std::cout << std::format(
+                       "{:>10.0f} {:>10.0f} {:>10.0f} {:>10.0f} {:>8} {:>8}",
+                       rate, inbound_rate, handled_rate, backlog,
+                       quantile(latency_before, latency_after, 0.5),
+                       quantile(latency_before, latency_after, 0.99));
+      if (options._count_allocations) {
+        // duplicate and shed frames allocate too, but are not handled
+        std::cout << std::format(
+            " {:>10.2f}",
+            static_cast<double>(allocations_after - allocations_before) /
+                std::max(handled_rate * seconds, 1.0));
+      }
+      std::cout << std::endl;
+      // behind the relay, or more than 5% of the step's frames still queued
+      if (handled_rate < 0.95 * rate ||
+          backlog - backlog_before > 0.05 * rate * seconds) {
+        std::cout << std::format("saturated at {:.0f} frames/sec, sustained "
+                                 "{:.0f} frames/sec\n",
+                                 rate, sustained);
+        break;
+      }
+      sustained = rate;
+    }
+    for (auto &relay : relays) {
+      relay->stop();
+    }
+    controller::instance().force_stop();
+    std::cout.flush();
+    // pipeline threads block on their queues and cannot be joined
+    std::_Exit(EXIT_SUCCESS);
+  } catch (std::exception const &exc) {
+    std::cerr << "ingest_e2e exception : " << exc.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,129 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "bench_corpus.hpp"
+#include "common/rest_utils.hpp"
+#include "dag_cbor.hpp"
+#include "parser.hpp"
+#include "post_processor.hpp"
+#include <algorithm>
+#include <array>
+#include <benchmark/benchmark.h>
+
+namespace {
+// current path - full DOM for frame and CAR blocks
+size_t decode_dom(std::vector<uint8_t> const &frame) {
+  parser frame_parser;
+  frame_parser.json_from_cbor(frame.cbegin(), frame.cend());
+  auto const &message(frame_parser.other_cbors().back().second);
+  auto blocks(message["blocks"].template get<nlohmann::json::binary_t>());
+  parser block_parser;
+  block_parser.json_from_car(blocks.cbegin(), blocks.cend());
+  size_t count(block_parser.content_cbors().size());
+  for (auto const &matchable : block_parser.matchable_cbors()) {
+    count += parser::get_candidates_from_record(matchable.second).size();
+  }
+  return count;
+}
+
+// in-situ views over the frame
+size_t decode_views(std::vector<uint8_t> const &frame) {
+  dag_cbor::frame decoded{dag_cbor::bytes_view(frame)};
+  dag_cbor::car_reader car(decoded._message["blocks"].as_bytes());
+  dag_cbor::car_reader::block block;
+  size_t count(0);
+  while (car.next(block)) {
+    dag_cbor::value content(block.content());
+    dag_cbor::value record_type(content["$type"]);
+    if (!record_type.is_text())
+      continue;
+    if (json::TargetFieldNames.contains(record_type.as_text())) {
+      count += parser::get_candidates_from_record(content).size();
+    } else {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// ops first, only blocks they name are decoded and per the collection's plan
+size_t decode_planned(std::vector<uint8_t> const &frame) {
+  dag_cbor::frame decoded{dag_cbor::bytes_view(frame)};
+  std::vector<std::pair<dag_cbor::bytes_view, firehose::field_plan>> plans;
+  for (auto const &oper : decoded._message["ops"].items()) {
+    std::string_view path(oper["path"].as_text());
+    plans.emplace_back(oper["cid"].as_cid(),
+                       firehose::field_plan_for_collection(
+                           path.substr(0, path.find('/'))));
+  }
+  dag_cbor::car_reader car(decoded._message["blocks"].as_bytes());
+  dag_cbor::car_reader::block block;
+  size_t count(0);
+  while (car.next(block)) {
+    auto plan(std::ranges::find_if(plans, [&](auto const &candidate) {
+      return std::ranges::equal(candidate.first, block._cid);
+    }));
+    if (plan == plans.cend() || plan->second == firehose::field_plan::none)
+      continue;
+    dag_cbor::value content(block.content());
+    if (plan->second == firehose::field_plan::subject) {
+      static constexpr std::array<std::string_view, 2> Fields = {"subject",
+                                                                 "createdAt"};
+      std::array<dag_cbor::value, Fields.size()> found;
+      count += content.select(Fields, found);
+    } else {
+      count += parser::get_candidates_from_record(content).size();
+    }
+  }
+  return count;
+}
+
+void BM_DecodeDom(benchmark::State &state) {
+  auto const &frame(corpus()[static_cast<size_t>(state.range(0))]);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode_dom(frame));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(frame.size()));
+}
+
+void BM_DecodePlanned(benchmark::State &state) {
+  auto const &frame(corpus()[static_cast<size_t>(state.range(0))]);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode_planned(frame));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(frame.size()));
+}
+
+void BM_DecodeViews(benchmark::State &state) {
+  auto const &frame(corpus()[static_cast<size_t>(state.range(0))]);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode_views(frame));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(frame.size()));
+}
+} // namespace
+
+// 0 = follow, 1 = post, 2 = profile
+BENCHMARK(BM_DecodeDom)->DenseRange(0, 2);
+BENCHMARK(BM_DecodeViews)->DenseRange(0, 2);
+BENCHMARK(BM_DecodePlanned)->DenseRange(0, 2);
@@ -0,0 +1,435 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+// One benchmark per pipeline stage. Time per iteration is ns/op, items/s is
+// messages/sec for the stage.
+#include "bench_corpus.hpp"
+#include "cid.hpp"
+#include "common/activity/event_cache.hpp"
+#include "common/bluesky/compact_at_uri.hpp"
+#include "common/bluesky/platform.hpp"
+#include "common/helpers.hpp"
+#include "common/metrics_factory.hpp"
+#include "filter_automaton.hpp"
+#include "matcher.hpp"
+#include "parser.hpp"
+#include "text_skeleton.hpp"
+#include <aho_corasick/aho_corasick.hpp>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+// CAR file from the recorded commit
+nlohmann::json::binary_t const &recorded_blocks() {
+  static const nlohmann::json::binary_t blocks([] {
+    auto const &frame(corpus()[0]);
+    parser frame_parser;
+    frame_parser.json_from_cbor(frame.cbegin(), frame.cend());
+    return frame_parser.other_cbors()
+        .back()
+        .second["blocks"]
+        .template get<nlohmann::json::binary_t>();
+  }());
+  return blocks;
+}
+
+// rules as deployed, from the checked-in filter file
+matcher const &filter_matcher() {
+  static const std::unique_ptr<matcher> rules([] {
+    auto loaded(std::make_unique<matcher>());
+    loaded->load_filter_file(std::string(DataPath) + "filters");
+    return loaded;
+  }());
+  return *rules;
+}
+
+void set_items(benchmark::State &state) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void BM_JsonFromCar(benchmark::State &state) {
+  auto const &blocks(recorded_blocks());
+  for (auto _ : state) {
+    parser block_parser;
+    benchmark::DoNotOptimize(
+        block_parser.json_from_car(blocks.cbegin(), blocks.cend()));
+  }
+  set_items(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(blocks.size()));
+}
+
+void BM_CandidatesFromRecord(benchmark::State &state) {
+  auto const &record(records()[static_cast<size_t>(state.range(0))]);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(parser::get_candidates_from_record(record));
+  }
+  set_items(state);
+}
+
+// whole events as received from Jetstream, same order as records()
+std::vector<std::string> const &jetstream_events() {
+  static const std::vector<std::string> events([] {
+    std::vector<std::string> result;
+    for (auto const &filename :
+         {"post.json", "profile.json", "abusive_profile.json"}) {
+      result.push_back(load_json(filename).dump());
+    }
+    return result;
+  }());
+  return events;
+}
+
+void BM_JetstreamCandidatesDom(benchmark::State &state) {
+  auto const &event(jetstream_events()[static_cast<size_t>(state.range(0))]);
+  parser event_parser;
+  for (auto _ : state) {
+    nlohmann::json full_json(nlohmann::json::parse(event));
+    benchmark::DoNotOptimize(event_parser.get_candidates_from_json(full_json));
+  }
+  set_items(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(event.size()));
+}
+
+void BM_JetstreamCandidatesOnDemand(benchmark::State &state) {
+  auto const &event(jetstream_events()[static_cast<size_t>(state.range(0))]);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(parser::get_candidates_from_jetstream(event));
+  }
+  set_items(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(event.size()));
+}
+
+void BM_MatchPathCandidates(benchmark::State &state) {
+  auto const &record(records()[static_cast<size_t>(state.range(0))]);
+  path_candidate_list candidates(
+      {{record["$type"].template get<std::string>() + "/self",
+        "bafyreihi6ahrft2af46qzieosnn3hklwdpna6qmmw3fm7pzitoyommbgpy",
+        parser::get_candidates_from_record(record)}});
+  auto const &rules(filter_matcher());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(rules.all_matches_for_path_candidates(candidates));
+  }
+  set_items(state);
+}
+
+void BM_ToCanonical(benchmark::State &state) {
+  auto const &record(records()[static_cast<size_t>(state.range(0))]);
+  std::string text(record.contains("text")
+                       ? record["text"].template get<std::string>()
+                       : record["description"].template get<std::string>());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(to_canonical(text));
+  }
+  set_items(state);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(text.size()));
+}
+
+// post text: 0 = English, 1 = mixed script
+std::array<std::string, 2> const &sample_texts() {
+  static const std::array<std::string, 2> texts = {
+      "Just finished grading the Year 9 essays on Of Mice and Men. Some "
+      "REALLY thoughtful work this term, proud of them all! #EduSky",
+      "Rentrée: ΣΧΟΛΕΙΟ, Школа и 学校. Großartige Schüler, welcome back "
+      "to all the teachers! #EduSky"};
+  return texts;
+}
+
+void set_bytes(benchmark::State &state, std::string const &text) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(text.size()));
+}
+
+// case folding as the matcher had it, all ICU and UTF-16 in a wstring
+void BM_FoldWide(benchmark::State &state) {
+  auto const &text(sample_texts()[static_cast<size_t>(state.range(0))]);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(to_canonical(text));
+  }
+  set_items(state);
+  set_bytes(state, text);
+}
+
+// case folding as the matcher has it, ICU only for non-ASCII
+void BM_FoldUtf8(benchmark::State &state) {
+  auto const &text(sample_texts()[static_cast<size_t>(state.range(0))]);
+  std::string scratch;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fold_non_ascii(text, scratch));
+  }
+  set_items(state);
+  set_bytes(state, text);
+}
+
+// skeleton stage after folding, confusables and the configured folds
+void BM_Skeleton(benchmark::State &state) {
+  static const text_skeleton skeleton(
+      true, {{"3", "e"}, {"4", "a"}, {"5", "s"}, {"7", "t"}, {"@", "a"}});
+  auto const &text(sample_texts()[static_cast<size_t>(state.range(0))]);
+  std::string folded;
+  std::string_view input(fold_non_ascii(text, folded));
+  std::string scratch;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(skeleton.apply(input, scratch));
+  }
+  set_items(state);
+  set_bytes(state, text);
+}
+
+// folding and the scan against the deployed rules
+void BM_MatchText(benchmark::State &state) {
+  auto const &text(sample_texts()[static_cast<size_t>(state.range(0))]);
+  candidate_list candidates({{"app.bsky.feed.post", "text", text}});
+  auto const &rules(filter_matcher());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(rules.all_matches_for_candidates(candidates));
+  }
+  set_items(state);
+  set_bytes(state, text);
+}
+
+// lower-case words of 4 to 12 letters, the same for a given count
+std::vector<std::string> synthetic_filters(const size_t count) {
+  std::mt19937 generator(static_cast<std::mt19937::result_type>(count));
+  std::uniform_int_distribution<int> letter('a', 'z');
+  std::uniform_int_distribution<size_t> length(4, 12);
+  std::vector<std::string> filters(count);
+  for (auto &filter : filters) {
+    filter.resize(length(generator));
+    for (auto &next : filter) {
+      next = static_cast<char>(letter(generator));
+    }
+  }
+  return filters;
+}
+
+// heap in use where the allocator reports it, else 0
+size_t heap_in_use() {
+#if defined(__GLIBC__)
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+void set_heap(benchmark::State &state, const size_t before) {
+  if (const size_t after = heap_in_use(); after > before) {
+    state.counters["heap"] = benchmark::Counter(
+        static_cast<double>(after - before), benchmark::Counter::kDefaults,
+        benchmark::Counter::kIs1024);
+  }
+}
+
+// flat automaton scan of folded text with range(0) filters
+void BM_FilterAutomatonScan(benchmark::State &state) {
+  const size_t before(heap_in_use());
+  filter_automaton automaton;
+  uint32_t owner(0);
+  for (auto const &filter :
+       synthetic_filters(static_cast<size_t>(state.range(0)))) {
+    automaton.add(filter, {owner++, filter_automaton::role::primary, false});
+  }
+  automaton.build();
+  set_heap(state, before);
+  state.counters["footprint"] = benchmark::Counter(
+      static_cast<double>(automaton.footprint()),
+      benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+  const std::string text(to_canonical_utf8(sample_texts()[0]));
+  for (auto _ : state) {
+    size_t hits(0);
+    automaton.scan(text, [&](auto const &, size_t) { ++hits; });
+    benchmark::DoNotOptimize(hits);
+  }
+  set_items(state);
+  set_bytes(state, text);
+}
+
+// pointer-based trie the matcher used before, on the same filters and text
+void BM_WtrieScan(benchmark::State &state) {
+  const size_t before(heap_in_use());
+  aho_corasick::wtrie trie;
+  trie.case_insensitive();
+  for (auto const &filter :
+       synthetic_filters(static_cast<size_t>(state.range(0)))) {
+    trie.insert(std::wstring(filter.cbegin(), filter.cend()));
+  }
+  const std::wstring text(to_canonical(sample_texts()[0]));
+  // failure links are built by the first parse
+  benchmark::DoNotOptimize(trie.parse_text(text));
+  set_heap(state, before);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(trie.parse_text(text));
+  }
+  set_items(state);
+  set_bytes(state, sample_texts()[0]);
+}
+
+// rebuild as done on each refresh_rules
+void BM_FilterAutomatonBuild(benchmark::State &state) {
+  filter_automaton automaton;
+  uint32_t owner(0);
+  for (auto const &filter :
+       synthetic_filters(static_cast<size_t>(state.range(0)))) {
+    automaton.add(filter, {owner++, filter_automaton::role::primary, false});
+  }
+  for (auto _ : state) {
+    automaton.build();
+  }
+  set_items(state);
+}
+
+// forms seen in createdAt and the relay's time
+std::array<std::string, 5> const &time_stamps() {
+  static const std::array<std::string, 5> stamps = {
+      "2024-12-20T21:28:36.920Z", "2024-11-28T22:14:50.399Z",
+      "2024-11-28T22:14:50.399123Z", "2024-11-28T22:14:50+00:00",
+      "2024-11-28T19:14:50.399-03:00"};
+  return stamps;
+}
+
+void BM_TimeStampFromIso8601(benchmark::State &state) {
+  auto const &stamps(time_stamps());
+  size_t next(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        bsky::time_stamp_from_iso_8601(stamps[next++ % stamps.size()]));
+  }
+  set_items(state);
+}
+
+// std::chrono::parse path, for comparison
+void BM_TimeStampParsed(benchmark::State &state) {
+  auto const &stamps(time_stamps());
+  size_t next(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bsky::parsed_time_stamp_from_iso_8601(
+        stamps[next++ % stamps.size()]));
+  }
+  set_items(state);
+}
+
+// subject of a like, as built for every interaction event and hashed into
+// the author's content hits
+constexpr std::string_view LikedPost =
+    "at://did:plc:ewvi7nxzyoun6zhxrhs64oiz/app.bsky.feed.post/3lc23oncbdk2l";
+
+void BM_AtUriParseHash(benchmark::State &state) {
+  const std::string text(LikedPost);
+  for (auto _ : state) {
+    atproto::at_uri uri(text);
+    benchmark::DoNotOptimize(atproto::at_uri_hash()(uri));
+  }
+  set_items(state);
+}
+
+void BM_CompactAtUriParseHash(benchmark::State &state) {
+  // the author is already interned by earlier events
+  const atproto::compact_at_uri held(LikedPost);
+  for (auto _ : state) {
+    atproto::compact_at_uri uri(LikedPost);
+    benchmark::DoNotOptimize(atproto::compact_at_uri_hash()(uri));
+  }
+  set_items(state);
+}
+
+void BM_CidAsString(benchmark::State &state) {
+  auto cid(make_cid(static_cast<std::uint32_t>(state.range(0))));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        atproto::cid_decoder<std::vector<uint8_t>::const_iterator>(
+            cid.cbegin(), cid.cend())
+            .as_string());
+  }
+  set_items(state);
+}
+
+// binary CID rendered only where it leaves the process
+void BM_CidToString(benchmark::State &state) {
+  auto binary(make_cid(static_cast<std::uint32_t>(state.range(0))));
+  atproto::cid cid{dag_cbor::bytes_view(binary)};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cid.to_string());
+  }
+  set_items(state);
+}
+
+void BM_EventCacheRecord(benchmark::State &state) {
+  static const bool registered([] {
+    metrics_factory::instance().add_counter("realtime_alerts", "bench");
+    metrics_factory::instance().add_gauge("process_operation", "bench");
+    return true;
+  }());
+  benchmark::DoNotOptimize(registered);
+  // spread over a population of accounts, as the firehose does
+  const size_t accounts(static_cast<size_t>(state.range(0)));
+  std::vector<activity::timed_event> events;
+  events.reserve(accounts);
+  for (size_t account = 0; account < accounts; ++account) {
+    events.emplace_back("did:plc:bench" + std::to_string(account),
+                        bsky::current_time(),
+                        activity::follow{"app.bsky.graph.follow/3lc23oncbdk2l",
+                                         "did:plc:followed"});
+  }
+  static activity::event_cache cache;
+  size_t next(0);
+  for (auto _ : state) {
+    cache.record(events[next++ % events.size()]);
+  }
+  set_items(state);
+}
+} // namespace
+
+BENCHMARK(BM_JsonFromCar);
+// 0 = post, 1 = profile, 2 = profile that matches rules
+BENCHMARK(BM_CandidatesFromRecord)->DenseRange(0, 2);
+BENCHMARK(BM_JetstreamCandidatesDom)->DenseRange(0, 2);
+BENCHMARK(BM_JetstreamCandidatesOnDemand)->DenseRange(0, 2);
+BENCHMARK(BM_MatchPathCandidates)->DenseRange(0, 2);
+BENCHMARK(BM_ToCanonical)->DenseRange(0, 2);
+// 0 = English, 1 = mixed script
+BENCHMARK(BM_FoldWide)->DenseRange(0, 1);
+BENCHMARK(BM_FoldUtf8)->DenseRange(0, 1);
+BENCHMARK(BM_Skeleton)->DenseRange(0, 1);
+BENCHMARK(BM_MatchText)->DenseRange(0, 1);
+// filter counts
+BENCHMARK(BM_FilterAutomatonScan)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_WtrieScan)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_FilterAutomatonBuild)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TimeStampFromIso8601);
+BENCHMARK(BM_TimeStampParsed);
+BENCHMARK(BM_AtUriParseHash);
+BENCHMARK(BM_CompactAtUriParseHash);
+BENCHMARK(BM_CidAsString)->Arg(1)->Arg(2);
+BENCHMARK(BM_CidToString)->Arg(1)->Arg(2);
+BENCHMARK(BM_EventCacheRecord)->Arg(1000)->Arg(100000);
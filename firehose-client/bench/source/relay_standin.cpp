@@ -0,0 +1,79 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "relay_standin.hpp"
+#include "bench_corpus.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Serves subscribeRepos frames for a firehose_client configured with
+//   hosts: localhost, port: <port>, tls: as given
+// A Jetstream capture served with --zstd-dictionary needs the same file as
+// zstd_dictionary in the client config. Runs until killed.
+int main(int argc, char **argv) {
+  try {
+    if (argc < 3) {
+      std::cerr << "Usage: relay_standin <port> <frames-per-second> [--tls] "
+                   "[--capture <directory>] [--repos <count>] "
+                   "[--zstd-dictionary <file>]\n"
+                   "  frames-per-second 0 sends as fast as the client reads\n";
+      return EXIT_FAILURE;
+    }
+    relay_standin::options settings;
+    settings._port = static_cast<unsigned short>(std::stoul(argv[1]));
+    settings._rate = std::stod(argv[2]);
+    for (int arg = 3; arg < argc; ++arg) {
+      std::string option(argv[arg]);
+      if (option == "--tls") {
+        settings._tls = true;
+      } else if (option == "--capture" && arg + 1 < argc) {
+        settings._capture_directory = argv[++arg];
+      } else if (option == "--zstd-dictionary" && arg + 1 < argc) {
+        settings._zstd_dictionary = argv[++arg];
+      } else if (option == "--repos" && arg + 1 < argc) {
+        settings._repo_count = static_cast<uint32_t>(std::stoul(argv[++arg]));
+      } else {
+        std::cerr << "Unknown option " << option << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+
+    relay_standin relay(settings, settings._capture_directory.empty()
+                                      ? synthetic_frames()
+                                      : std::vector<std::vector<uint8_t>>());
+    relay.start();
+    std::cout << "relay stand-in on port " << relay.port()
+              << (settings._tls ? " (TLS)" : "") << '\n';
+    uint64_t sent(0);
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::seconds(10));
+      uint64_t now_sent(relay.frames_sent());
+      std::cout << (now_sent - sent) / 10 << " frames/sec, head seq "
+                << relay.head() << std::endl;
+      sent = now_sent;
+    }
+  } catch (std::exception const &exc) {
+    std::cerr << "relay_standin exception : " << exc.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,128 @@
+#ifndef __buffer_pool_hpp__
+#define __buffer_pool_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <array>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <prometheus/counter.h>
+#include <prometheus/gauge.h>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+
+class receive_buffer_pool;
+
+// Websocket receive buffer on loan from the pool. Ownership moves with the
+// frame through the pipeline, the buffer goes back to the pool when the last
+// owner is done with it.
+class pooled_buffer {
+public:
+  pooled_buffer() = default;
+  pooled_buffer(pooled_buffer &&other) noexcept = default;
+  pooled_buffer &operator=(pooled_buffer &&other) noexcept {
+    if (this != &other) {
+      reset();
+      _buffer = std::move(other._buffer);
+    }
+    return *this;
+  }
+  pooled_buffer(pooled_buffer const &) = delete;
+  pooled_buffer &operator=(pooled_buffer const &) = delete;
+  ~pooled_buffer() { reset(); }
+
+  inline explicit operator bool() const { return _buffer != nullptr; }
+  inline beast::flat_buffer &operator*() { return *_buffer; }
+  inline beast::flat_buffer const &operator*() const { return *_buffer; }
+  inline beast::flat_buffer *operator->() { return _buffer.get(); }
+  inline beast::flat_buffer const *operator->() const { return _buffer.get(); }
+
+  // received frame, contiguous in a flat_buffer
+  inline std::span<const uint8_t> bytes() const {
+    if (!_buffer)
+      return {};
+    auto data(_buffer->cdata());
+    return {static_cast<const uint8_t *>(data.data()), data.size()};
+  }
+  inline std::string_view text() const {
+    auto frame(bytes());
+    return {reinterpret_cast<const char *>(frame.data()), frame.size()};
+  }
+
+  // return the buffer to the pool now
+  void reset();
+
+private:
+  friend class receive_buffer_pool;
+  explicit pooled_buffer(std::unique_ptr<beast::flat_buffer> &&buffer)
+      : _buffer(std::move(buffer)) {}
+
+  std::unique_ptr<beast::flat_buffer> _buffer;
+};
+
+// Recycles receive buffers so that steady-state ingest does not allocate per
+// frame. New buffers are reserved at the p99 observed frame size, buffers
+// grown beyond p99.9 by outlier frames are released rather than retained.
+class receive_buffer_pool {
+public:
+  static constexpr size_t DefaultIdleLimit = 1024;
+  static constexpr size_t DefaultReserve = 16 * 1024;
+  // frames observed between recalculations of the size percentiles
+  static constexpr uint64_t SampleWindow = 4096;
+
+  static receive_buffer_pool &instance();
+
+  void set_config(YAML::Node const &settings);
+  // resolves metrics, call once they are registered
+  void start();
+
+  pooled_buffer acquire();
+
+private:
+  friend class pooled_buffer;
+  receive_buffer_pool() = default;
+  ~receive_buffer_pool() = default;
+
+  void release(std::unique_ptr<beast::flat_buffer> &&buffer);
+  void observe(const size_t frame_size);
+
+  std::mutex _lock;
+  std::vector<std::unique_ptr<beast::flat_buffer>> _idle;
+  size_t _idle_limit = DefaultIdleLimit;
+  size_t _bytes_held = 0;
+
+  // frame sizes by power-of-two bucket, bucket N holds sizes < 2^N
+  std::array<uint64_t, 48> _size_counts = {};
+  uint64_t _observed = 0;
+  size_t _reserve = DefaultReserve;
+  size_t _retain_limit = SIZE_MAX;
+
+  prometheus::Counter *_hits = nullptr;
+  prometheus::Counter *_misses = nullptr;
+  prometheus::Gauge *_held = nullptr;
+};
+
+#endif
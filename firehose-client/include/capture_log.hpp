@@ -0,0 +1,97 @@
+#ifndef __capture_log_hpp__
+#define __capture_log_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Raw websocket frames, as received, in memory-mapped segment files. Each
+// record is
+//   uint32_t length, int64_t seq, int64_t received_at (ns since epoch), frame
+// and a zero length marks the end of a segment. Every IndexInterval records,
+// and at the start of each segment, the seq and offset of the record is
+// appended to a small index file alongside the segment. Frames with no seq
+// (e.g. #info) are recorded with seq -1 and never indexed.
+struct captured_frame {
+  int64_t _seq = -1;
+  int64_t _received_at = 0;
+  std::span<const uint8_t> _frame;
+};
+
+class capture_writer {
+public:
+  static constexpr size_t DefaultSegmentMegabytes = 256;
+  static constexpr uint64_t IndexInterval = 1024;
+
+  capture_writer(std::filesystem::path const &directory,
+                 const size_t segment_bytes);
+  ~capture_writer();
+
+  void append(const int64_t seq, std::span<const uint8_t> frame);
+
+private:
+  void open_segment(const size_t minimum_bytes);
+  void close_segment();
+
+  std::filesystem::path _directory;
+  size_t _segment_bytes;
+  uint64_t _segment_number = 0;
+  std::filesystem::path _segment_path;
+  std::unique_ptr<boost::interprocess::mapped_region> _region;
+  size_t _offset = 0;
+  uint64_t _records = 0;
+  uint64_t _unindexed = 0;
+  std::ofstream _index;
+};
+
+class capture_reader {
+public:
+  explicit capture_reader(std::filesystem::path const &directory);
+
+  // position at the first frame with seq >= from_seq, using the index to
+  // skip segments and most of the records ahead of it
+  void seek(const int64_t from_seq);
+  // false once all segments are exhausted. The frame refers into the mapped
+  // segment and is valid until the next call.
+  bool next(captured_frame &frame);
+
+private:
+  struct index_entry {
+    int64_t _seq;
+    uint64_t _offset;
+  };
+  bool open_segment(const size_t segment);
+  std::vector<index_entry> load_index(const size_t segment) const;
+
+  std::vector<std::filesystem::path> _segments;
+  size_t _segment = 0;
+  std::unique_ptr<boost::interprocess::mapped_region> _region;
+  size_t _offset = 0;
+  int64_t _skip_before = -1;
+};
+
+#endif
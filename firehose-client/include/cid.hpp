@@ -0,0 +1,173 @@
+#ifndef __cid_hpp__
+#define __cid_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "dag_cbor.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace base32 {
+
+// RFC 4648 lower case, unpadded, as used by multibase 'b'
+inline constexpr size_t encoded_size(const size_t bytes) {
+  return (bytes * 8 + 4) / 5;
+}
+
+// 5 input bytes to 8 output characters in one 64-bit word: split the 40-bit
+// group into byte lanes of 5 bits, then map each lane to the alphabet with
+// lane-wise arithmetic.
+inline uint64_t encode_group(const uint8_t *group) {
+  uint64_t bits((uint64_t(group[0]) << 32) | (uint64_t(group[1]) << 24) |
+                (uint64_t(group[2]) << 16) | (uint64_t(group[3]) << 8) |
+                uint64_t(group[4]));
+  // 20-bit halves in 32-bit lanes, 10-bit quarters in 16-bit lanes, then
+  // 5-bit indexes in byte lanes, first character in the lowest byte
+  bits = ((bits >> 20) & 0xfffff) | ((bits & 0xfffff) << 32);
+  bits = ((bits >> 10) & 0x000003ff000003ffULL) |
+         ((bits & 0x000003ff000003ffULL) << 16);
+  bits = ((bits >> 5) & 0x001f001f001f001fULL) |
+         ((bits & 0x001f001f001f001fULL) << 8);
+  // 'a' + index for 0-25, '2' + index - 26 for 26-31. No lane carries: the
+  // largest lane sum is 31 + 'a' = 0x80.
+  const uint64_t digits(((bits + 0x6666666666666666ULL) >> 7) &
+                        0x0101010101010101ULL);
+  return bits + 0x6161616161616161ULL - digits * 73;
+}
+
+// writes encoded_size(input.size()) characters
+inline void encode(dag_cbor::bytes_view input, char *output) {
+  const uint8_t *next(input.data());
+  const uint8_t *end(next + input.size());
+  for (; end - next >= 5; next += 5, output += 8) {
+    const uint64_t chars(encode_group(next));
+    if constexpr (std::endian::native == std::endian::little) {
+      std::memcpy(output, &chars, 8);
+    } else {
+      for (size_t lane = 0; lane < 8; ++lane) {
+        output[lane] = static_cast<char>(chars >> (8 * lane));
+      }
+    }
+  }
+  if (next != end) {
+    std::array<uint8_t, 5> group = {};
+    const size_t remaining(static_cast<size_t>(end - next));
+    std::memcpy(group.data(), next, remaining);
+    const uint64_t chars(encode_group(group.data()));
+    for (size_t lane = 0; lane < encoded_size(remaining); ++lane) {
+      output[lane] = static_cast<char>(chars >> (8 * lane));
+    }
+  }
+}
+
+} // namespace base32
+
+namespace atproto {
+
+// Binary CID held by value. Equality and hashing work on the bytes, the
+// platform's text form is only produced by to_string() for output.
+class cid {
+public:
+  // CIDv1 with a sha2-256 multihash. CIDv0 is 34 bytes.
+  static constexpr size_t MaxSize = 36;
+
+  cid() = default;
+  explicit cid(dag_cbor::bytes_view binary) {
+    if (binary.size() < 2 || binary.size() > MaxSize)
+      throw std::invalid_argument("Unsupported CID size " +
+                                  std::to_string(binary.size()));
+    std::memcpy(_bytes.data(), binary.data(), binary.size());
+    _size = static_cast<uint8_t>(binary.size());
+  }
+
+  inline bool empty() const { return _size == 0; }
+  inline dag_cbor::bytes_view bytes() const { return {_bytes.data(), _size}; }
+  // bare sha2-256 multihash
+  inline bool is_v0() const {
+    return _size == 34 && _bytes[0] == 0x12 && _bytes[1] == 0x20;
+  }
+
+  // the digest ends the CID and is already uniformly distributed
+  inline size_t hash() const {
+    uint64_t tail;
+    std::memcpy(&tail, _bytes.data() + std::max<size_t>(_size, 8) - 8, 8);
+    return static_cast<size_t>(tail);
+  }
+
+  // base32 for CIDv1, base58btc for CIDv0
+  std::string to_string() const {
+    if (is_v0())
+      return base58btc();
+    std::string result(1 + base32::encoded_size(_size), 'b');
+    base32::encode(bytes(), result.data() + 1);
+    return result;
+  }
+
+  friend bool operator==(cid const &lhs, cid const &rhs) = default;
+
+private:
+  std::string base58btc() const {
+    static constexpr char Alphabet[] =
+        "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+    const dag_cbor::bytes_view binary(bytes());
+    std::vector<uint8_t> digits; // least significant first
+    for (uint8_t next : binary) {
+      uint32_t carry(next);
+      for (auto &digit : digits) {
+        carry += static_cast<uint32_t>(digit) << 8;
+        digit = static_cast<uint8_t>(carry % 58);
+        carry /= 58;
+      }
+      for (; carry > 0; carry /= 58) {
+        digits.push_back(static_cast<uint8_t>(carry % 58));
+      }
+    }
+    // each leading zero byte is a '1'
+    std::string result(
+        static_cast<size_t>(std::ranges::find_if(binary,
+                                                 [](uint8_t next) {
+                                                   return next != 0;
+                                                 }) -
+                            binary.begin()),
+        '1');
+    for (auto digit = digits.crbegin(); digit != digits.crend(); ++digit) {
+      result.push_back(Alphabet[*digit]);
+    }
+    return result;
+  }
+
+  // unused tail is zero so whole-array comparison is exact
+  std::array<uint8_t, MaxSize> _bytes = {};
+  uint8_t _size = 0;
+};
+
+struct cid_hash {
+  size_t operator()(const cid &value) const { return value.hash(); }
+};
+
+} // namespace atproto
+
+#endif
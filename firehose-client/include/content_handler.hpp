@@ -20,38 +20,72 @@ http://www.fsf.org/licensing/licenses
 >>> END OF LICENSE >>>
 *************************************************************************/
 
+#include "buffer_pool.hpp"
 #include "common/log_wrapper.hpp"
+#include "common/metrics_factory.hpp"
+#include "decode_pool.hpp"
+#include "load_shedder.hpp"
 #include "matcher.hpp"
 #include "moderation/action_router.hpp"
 #include "moderation/embed_checker.hpp"
 #include "post_processor.hpp"
 #include <boost/beast/core.hpp>
+#include <prometheus/counter.h>
+#include <yaml-cpp/yaml.h>
 
 namespace beast = boost::beast; // from <boost/beast.hpp>
 
 template <typename PAYLOAD> class content_handler {
 public:
-  content_handler() = default;
+  content_handler() : _decode_pool(_post_processor) {}
   ~content_handler() = default;
 
-  void handle(beast::flat_buffer const &beast_data) {
-    auto matches(matcher::shared().find_all_matches(beast_data));
+  void set_config(YAML::Node const &settings) { set_overload(settings); }
+
+  // tracks_cursor is false for frames from a relay other than the one whose
+  // cursor is saved
+  void handle(pooled_buffer &&frame, const bool tracks_cursor = true) {
+    if (!admit(frame.bytes(), _post_processor.backlog()))
+      return;
+    auto matches(matcher::shared().find_all_matches(*frame));
     // No match, or all eliminated by contingent match processing
     if (matches.empty()) {
       return;
     }
-    std::string json_msg(boost::beast::buffers_to_string(beast_data.data()));
-
-    _post_processor.wait_enqueue(PAYLOAD(json_msg, matches));
+    _post_processor.wait_enqueue(PAYLOAD(std::move(frame), std::move(matches)));
   }
 
 private:
+  void set_overload(YAML::Node const &settings) {
+    _shedder.set_config(settings);
+    REL_INFO("Overload shedding {}", _shedder.enabled() ? "on" : "off");
+  }
+
+  // frames are only classified once there is a backlog
+  bool admit(std::span<const uint8_t> frame, const size_t backlog) {
+    if (!_shedder.enabled() || !_shedder.under_pressure(backlog) ||
+        _shedder.admit(PAYLOAD::value_of(frame), backlog))
+      return true;
+    if (!_shed) {
+      _shed = &metrics_factory::instance()
+                   .get_counter("shed_frames")
+                   .Get({{"value", "statistics"}});
+    }
+    _shed->Increment();
+    return false;
+  }
+
   post_processor<PAYLOAD> _post_processor;
+  decode_pool<PAYLOAD> _decode_pool;
+  load_shedder _shedder;
+  prometheus::Counter *_shed = nullptr;
 };
 
 class firehose_payload;
 template <>
-void content_handler<firehose_payload>::handle(
-    beast::flat_buffer const &beast_data);
+void content_handler<firehose_payload>::set_config(YAML::Node const &settings);
+template <>
+void content_handler<firehose_payload>::handle(pooled_buffer &&frame,
+                                               const bool tracks_cursor);
 
 #endif
\ No newline at end of file
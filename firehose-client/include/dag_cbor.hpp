@@ -0,0 +1,582 @@
+#ifndef __dag_cbor_hpp__
+#define __dag_cbor_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Streaming DAG-CBOR and CARv1 reader. Values are views over the frame's
+// bytes, nothing is copied or materialized until the caller asks for it.
+// Spec references:
+//   https://ipld.io/specs/codecs/dag-cbor/spec/
+//   https://ipld.io/specs/transport/car/carv1/
+namespace dag_cbor {
+
+typedef std::span<const uint8_t> bytes_view;
+
+class decode_error : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+enum class major_type : uint8_t {
+  unsigned_integer = 0,
+  negative_integer,
+  byte_string,
+  text_string,
+  array,
+  map,
+  tag,
+  simple
+};
+
+// IPLD link, a CID with leading multibase identity prefix
+constexpr uint64_t CidTag = 42;
+constexpr uint8_t SimpleFalse = 20;
+constexpr uint8_t SimpleTrue = 21;
+constexpr uint8_t SimpleNull = 22;
+
+namespace detail {
+struct header {
+  major_type _type;
+  uint8_t _additional;
+  uint64_t _argument;
+  const uint8_t *_payload;
+};
+
+inline header read_header(const uint8_t *current, const uint8_t *limit) {
+  if (current >= limit)
+    throw decode_error("unexpected end of CBOR input");
+  header result;
+  result._type = static_cast<major_type>(*current >> 5);
+  result._additional = *current & 0x1f;
+  ++current;
+  if (result._additional < 24) {
+    result._argument = result._additional;
+  } else if (result._additional <= 27) {
+    const size_t width(size_t(1) << (result._additional - 24));
+    if (static_cast<size_t>(limit - current) < width)
+      throw decode_error("truncated CBOR argument");
+    result._argument = 0;
+    for (size_t byte = 0; byte < width; ++byte) {
+      result._argument = (result._argument << 8) | current[byte];
+    }
+    current += width;
+  } else {
+    // reserved values, and indefinite lengths which DAG-CBOR forbids
+    throw decode_error("unsupported CBOR additional info " +
+                       std::to_string(result._additional));
+  }
+  result._payload = current;
+  return result;
+}
+
+// Skip one complete data item, return the position following it
+inline const uint8_t *skip(const uint8_t *current, const uint8_t *limit) {
+  uint64_t pending(1);
+  while (pending > 0) {
+    --pending;
+    header next(read_header(current, limit));
+    current = next._payload;
+    const uint64_t remaining(static_cast<uint64_t>(limit - current));
+    switch (next._type) {
+    case major_type::byte_string:
+    case major_type::text_string:
+      if (next._argument > remaining)
+        throw decode_error("truncated CBOR string");
+      current += next._argument;
+      break;
+    case major_type::array:
+      // every item needs at least one byte, reject absurd counts
+      if (next._argument > remaining)
+        throw decode_error("truncated CBOR array");
+      pending += next._argument;
+      break;
+    case major_type::map:
+      if (next._argument > remaining / 2)
+        throw decode_error("truncated CBOR map");
+      pending += next._argument * 2;
+      break;
+    case major_type::tag:
+      ++pending;
+      break;
+    default:
+      break;
+    }
+  }
+  return current;
+}
+} // namespace detail
+
+// A view of one decoded data item. Default-constructed values are absent,
+// which is also what lookups of missing keys return.
+class value {
+public:
+  value() = default;
+  // decode the item at the start of the input
+  static inline value decode(const uint8_t *begin, const uint8_t *limit) {
+    value result(decode_header(begin, limit));
+    switch (result._type) {
+    case major_type::byte_string:
+    case major_type::text_string:
+      if (result._argument > static_cast<uint64_t>(limit - result._payload))
+        throw decode_error("truncated CBOR string");
+      result._end = result._payload + result._argument;
+      break;
+    case major_type::array:
+    case major_type::map:
+    case major_type::tag:
+      result._end = detail::skip(begin, limit);
+      break;
+    default:
+      result._end = result._payload;
+      break;
+    }
+    return result;
+  }
+  static inline value decode(bytes_view input) {
+    return decode(input.data(), input.data() + input.size());
+  }
+  // Decode an item known to fill the input exactly, e.g. a CAR block. The
+  // extent is taken from the input so the item is not walked up front.
+  static inline value decode_whole(bytes_view input) {
+    const uint8_t *limit(input.data() + input.size());
+    value result(decode_header(input.data(), limit));
+    switch (result._type) {
+    case major_type::array:
+    case major_type::map:
+    case major_type::tag:
+      result._end = limit;
+      break;
+    default:
+      result._end = decode(input.data(), limit)._end;
+      break;
+    }
+    return result;
+  }
+
+  inline bool is_valid() const { return _begin != nullptr; }
+  inline explicit operator bool() const { return is_valid(); }
+  inline major_type type() const { return _type; }
+
+  inline bool is_text() const {
+    return is_valid() && _type == major_type::text_string;
+  }
+  inline bool is_bytes() const {
+    return is_valid() && _type == major_type::byte_string;
+  }
+  inline bool is_map() const { return is_valid() && _type == major_type::map; }
+  inline bool is_array() const {
+    return is_valid() && _type == major_type::array;
+  }
+  inline bool is_integer() const {
+    return is_valid() && (_type == major_type::unsigned_integer ||
+                          _type == major_type::negative_integer);
+  }
+  inline bool is_null() const {
+    return is_valid() && _type == major_type::simple &&
+           _additional == SimpleNull;
+  }
+  inline bool is_bool() const {
+    return is_valid() && _type == major_type::simple &&
+           (_additional == SimpleFalse || _additional == SimpleTrue);
+  }
+  inline bool is_float() const {
+    return is_valid() && _type == major_type::simple && _additional >= 25 &&
+           _additional <= 27;
+  }
+  inline bool is_tag() const { return is_valid() && _type == major_type::tag; }
+  inline bool is_cid() const { return is_tag() && _argument == CidTag; }
+
+  inline std::string_view as_text() const {
+    if (!is_text())
+      throw decode_error("CBOR value is not a text string");
+    return std::string_view(reinterpret_cast<const char *>(_payload),
+                            static_cast<size_t>(_argument));
+  }
+  inline bytes_view as_bytes() const {
+    if (!is_bytes())
+      throw decode_error("CBOR value is not a byte string");
+    return bytes_view(_payload, static_cast<size_t>(_argument));
+  }
+  inline int64_t as_integer() const {
+    if (!is_integer())
+      throw decode_error("CBOR value is not an integer");
+    if (_type == major_type::unsigned_integer)
+      return static_cast<int64_t>(_argument);
+    return -1 - static_cast<int64_t>(_argument);
+  }
+  inline bool as_bool() const {
+    if (!is_bool())
+      throw decode_error("CBOR value is not a boolean");
+    return _additional == SimpleTrue;
+  }
+  inline double as_double() const {
+    if (!is_float())
+      throw decode_error("CBOR value is not a float");
+    if (_additional == 27) {
+      double result;
+      std::memcpy(&result, &_argument, sizeof(result));
+      return result;
+    }
+    if (_additional == 26) {
+      float result;
+      const uint32_t bits(static_cast<uint32_t>(_argument));
+      std::memcpy(&result, &bits, sizeof(result));
+      return result;
+    }
+    // half-precision is not canonical DAG-CBOR but decode it anyway
+    const uint16_t half(static_cast<uint16_t>(_argument));
+    const int exponent((half >> 10) & 0x1f);
+    const int mantissa(half & 0x3ff);
+    double result(exponent == 0    ? std::ldexp(mantissa, -24)
+                  : exponent != 31 ? std::ldexp(mantissa + 1024, exponent - 25)
+                  : (mantissa == 0 ? INFINITY : NAN));
+    return (half & 0x8000) ? -result : result;
+  }
+  // tagged item, e.g. the byte string inside a CID link
+  inline uint64_t tag() const {
+    if (!is_tag())
+      throw decode_error("CBOR value is not tagged");
+    return _argument;
+  }
+  inline value tagged() const { return decode(_payload, _end); }
+  // binary CID without the multibase identity prefix
+  inline bytes_view as_cid() const {
+    if (!is_cid())
+      throw decode_error("CBOR value is not a CID link");
+    bytes_view encoded(tagged().as_bytes());
+    if (encoded.empty() || encoded.front() != 0)
+      throw decode_error("CID link missing multibase identity prefix");
+    return checked_cid(encoded.subspan(1));
+  }
+
+  // element count for array/map, byte count for strings
+  inline size_t size() const {
+    if (is_array() || is_map() || is_text() || is_bytes())
+      return static_cast<size_t>(_argument);
+    return 0;
+  }
+  inline bool empty() const { return size() == 0; }
+
+  // full encoded extent of the item
+  inline bytes_view raw() const {
+    return bytes_view(_begin, static_cast<size_t>(_end - _begin));
+  }
+  inline const uint8_t *end() const { return _end; }
+
+  // Map lookup by text key. Returns an absent value if not found or not a map.
+  inline value operator[](std::string_view key) const {
+    if (!is_map())
+      return value();
+    const uint8_t *current(_payload);
+    for (uint64_t entry = 0; entry < _argument; ++entry) {
+      value next_key(decode(current, _end));
+      if (next_key._type == major_type::text_string &&
+          next_key.as_text() == key) {
+        return decode(next_key._end, _end);
+      }
+      current = detail::skip(next_key._end, _end);
+    }
+    return value();
+  }
+  inline bool contains(std::string_view key) const {
+    return (*this)[key].is_valid();
+  }
+  // Single pass over a map collecting the values for the given keys into the
+  // matching slots of found. Other entries are skipped without being
+  // decoded. Returns the number of keys found.
+  inline size_t select(std::span<const std::string_view> keys,
+                       std::span<value> found) const {
+    size_t matched(0);
+    if (!is_map() || keys.empty())
+      return matched;
+    const uint8_t *current(_payload);
+    for (uint64_t entry = 0; entry < _argument && matched < keys.size();
+         ++entry) {
+      value next_key(decode(current, _end));
+      current = next_key._end;
+      if (next_key._type == major_type::text_string) {
+        std::string_view key_text(next_key.as_text());
+        for (size_t index = 0; index < keys.size(); ++index) {
+          if (keys[index] == key_text && !found[index].is_valid()) {
+            found[index] = decode(current, _end);
+            ++matched;
+            break;
+          }
+        }
+      }
+      current = detail::skip(current, _end);
+    }
+    return matched;
+  }
+  // Array lookup by index. Returns an absent value if out of range.
+  inline value operator[](size_t index) const {
+    if (!is_array() || index >= _argument)
+      return value();
+    const uint8_t *current(_payload);
+    for (size_t skipped = 0; skipped < index; ++skipped) {
+      current = detail::skip(current, _end);
+    }
+    return decode(current, _end);
+  }
+  // Resolve a JSON pointer e.g. "/embed/images/0/alt"
+  value at_pointer(std::string_view pointer) const;
+
+  // Forward-only iteration over array elements or map entries. Ranges are
+  // empty for the wrong type, mirroring permissive nlohmann iteration.
+  class iterator;
+  struct entry;
+  class entry_iterator;
+  template <typename ITERATOR> struct range {
+    ITERATOR _begin;
+    ITERATOR _end;
+    inline ITERATOR begin() const { return _begin; }
+    inline ITERATOR end() const { return _end; }
+  };
+  range<iterator> items() const;
+  range<entry_iterator> entries() const;
+
+private:
+  static inline value decode_header(const uint8_t *begin,
+                                    const uint8_t *limit) {
+    value result;
+    detail::header next(detail::read_header(begin, limit));
+    result._begin = begin;
+    result._payload = next._payload;
+    result._argument = next._argument;
+    result._type = next._type;
+    result._additional = next._additional;
+    return result;
+  }
+  static bytes_view checked_cid(bytes_view cid);
+
+  const uint8_t *_begin = nullptr;
+  const uint8_t *_payload = nullptr;
+  const uint8_t *_end = nullptr;
+  uint64_t _argument = 0;
+  major_type _type = major_type::simple;
+  uint8_t _additional = 0;
+};
+
+class value::iterator {
+public:
+  iterator() = default;
+  inline iterator(const uint8_t *current, const uint8_t *limit,
+                  uint64_t remaining)
+      : _current(current), _limit(limit), _remaining(remaining) {
+    load();
+  }
+  inline value const &operator*() const { return _value; }
+  inline value const *operator->() const { return &_value; }
+  inline iterator &operator++() {
+    _current = _value._end;
+    --_remaining;
+    load();
+    return *this;
+  }
+  inline bool operator==(iterator const &rhs) const {
+    return _remaining == rhs._remaining;
+  }
+
+private:
+  inline void load() {
+    if (_remaining > 0) {
+      _value = decode(_current, _limit);
+    }
+  }
+  const uint8_t *_current = nullptr;
+  const uint8_t *_limit = nullptr;
+  uint64_t _remaining = 0;
+  value _value;
+};
+
+struct value::entry {
+  value _key;
+  value _value;
+};
+
+class value::entry_iterator {
+public:
+  entry_iterator() = default;
+  inline entry_iterator(const uint8_t *current, const uint8_t *limit,
+                        uint64_t remaining)
+      : _current(current), _limit(limit), _remaining(remaining) {
+    load();
+  }
+  inline entry const &operator*() const { return _entry; }
+  inline entry const *operator->() const { return &_entry; }
+  inline entry_iterator &operator++() {
+    _current = _entry._value._end;
+    --_remaining;
+    load();
+    return *this;
+  }
+  inline bool operator==(entry_iterator const &rhs) const {
+    return _remaining == rhs._remaining;
+  }
+
+private:
+  inline void load() {
+    if (_remaining > 0) {
+      _entry._key = decode(_current, _limit);
+      _entry._value = decode(_entry._key._end, _limit);
+    }
+  }
+  const uint8_t *_current = nullptr;
+  const uint8_t *_limit = nullptr;
+  uint64_t _remaining = 0;
+  entry _entry;
+};
+
+inline value::range<value::iterator> value::items() const {
+  if (!is_array())
+    return {};
+  return {iterator(_payload, _end, _argument), iterator()};
+}
+
+inline value::range<value::entry_iterator> value::entries() const {
+  if (!is_map())
+    return {};
+  return {entry_iterator(_payload, _end, _argument), entry_iterator()};
+}
+
+// unsigned LEB128 as used in CAR framing and CIDs
+inline uint64_t read_varint(const uint8_t *&current, const uint8_t *limit) {
+  uint64_t result(0);
+  for (uint32_t shift = 0; shift < 64; shift += 7) {
+    if (current >= limit)
+      throw decode_error("truncated varint");
+    const uint8_t next(*current++);
+    result |= static_cast<uint64_t>(next & 0x7f) << shift;
+    if (!(next & 0x80))
+      return result;
+  }
+  throw decode_error("varint too long");
+}
+
+// Binary CID extent at the start of the input
+inline bytes_view read_cid(const uint8_t *&current, const uint8_t *limit) {
+  const uint8_t *start(current);
+  if (limit - current >= 2 && current[0] == 0x12 && current[1] == 0x20) {
+    // CIDv0 is a bare sha2-256 multihash
+    current += 2;
+  } else {
+    read_varint(current, limit); // version
+    read_varint(current, limit); // codec
+    read_varint(current, limit); // multihash function
+    uint64_t digest_length(read_varint(current, limit));
+    if (digest_length > static_cast<uint64_t>(limit - current))
+      throw decode_error("truncated CID digest");
+    current += digest_length;
+    return bytes_view(start, static_cast<size_t>(current - start));
+  }
+  if (limit - current < 32)
+    throw decode_error("truncated CIDv0 digest");
+  current += 32;
+  return bytes_view(start, static_cast<size_t>(current - start));
+}
+
+inline bytes_view value::checked_cid(bytes_view cid) {
+  const uint8_t *current(cid.data());
+  const uint8_t *limit(current + cid.size());
+  read_cid(current, limit);
+  if (current != limit)
+    throw decode_error("trailing bytes in CID link");
+  return cid;
+}
+
+// Walks the blocks of a CARv1 file in place
+class car_reader {
+public:
+  static constexpr uint64_t CodecDagCbor = 0x71;
+
+  struct block {
+    bytes_view _cid;
+    bytes_view _data;
+    // decoded on demand, absent if the block is not DAG-CBOR
+    inline value content() const {
+      return is_dag_cbor(_cid) && !_data.empty() ? value::decode_whole(_data)
+                                                 : value();
+    }
+  };
+
+  inline explicit car_reader(bytes_view car)
+      : _current(car.data()), _limit(car.data() + car.size()) {
+    uint64_t header_length(read_varint(_current, _limit));
+    if (header_length > static_cast<uint64_t>(_limit - _current))
+      throw decode_error("truncated CAR header");
+    _header = value::decode(_current, _current + header_length);
+    _current += header_length;
+  }
+
+  inline value const &header() const { return _header; }
+
+  // returns false at end of input
+  inline bool next(block &result) {
+    if (_current >= _limit)
+      return false;
+    uint64_t section_length(read_varint(_current, _limit));
+    if (section_length > static_cast<uint64_t>(_limit - _current))
+      throw decode_error("truncated CAR block");
+    const uint8_t *section_end(_current + section_length);
+    result._cid = read_cid(_current, section_end);
+    result._data =
+        bytes_view(_current, static_cast<size_t>(section_end - _current));
+    _current = section_end;
+    return true;
+  }
+
+  static inline bool is_dag_cbor(bytes_view cid) {
+    if (cid.size() >= 2 && cid[0] == 0x12 && cid[1] == 0x20)
+      return false; // CIDv0 implies DAG-PB
+    const uint8_t *current(cid.data());
+    const uint8_t *limit(current + cid.size());
+    read_varint(current, limit);
+    return read_varint(current, limit) == CodecDagCbor;
+  }
+
+private:
+  const uint8_t *_current;
+  const uint8_t *_limit;
+  value _header;
+};
+
+// A firehose frame is a DAG-CBOR header followed by a DAG-CBOR message
+struct frame {
+  inline explicit frame(bytes_view input) {
+    _header = value::decode(input);
+    _message = value::decode(_header.end(), input.data() + input.size());
+  }
+  value _header;
+  value _message;
+};
+
+// Diagnostic rendering in JSON notation, CIDs are shown as {"$link": ...}
+std::string dump(value const &item);
+
+} // namespace dag_cbor
+
+#endif
@@ -25,18 +25,29 @@ http://www.fsf.org/licensing/licenses
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/websocket/ssl.hpp>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <mutex>
 #include <prometheus/counter.h>
+#include <prometheus/gauge.h>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 
+#include "buffer_pool.hpp"
+#include "capture_log.hpp"
 #include "common/config.hpp"
 #include "common/controller.hpp"
 #include "common/log_wrapper.hpp"
 #include "common/metrics_factory.hpp"
 #include "content_handler.hpp"
 #include "matcher.hpp"
+#include "payload.hpp"
 #include "project_defs.hpp"
+#include "recent_window.hpp"
+#include "zstd_decompressor.hpp"
 
 namespace beast = boost::beast;         // from <boost/beast.hpp>
 namespace http = beast::http;           // from <boost/beast/http.hpp>
@@ -47,7 +58,9 @@ using tcp = boost::asio::ip::tcp;       // from <boost/asio/ip/tcp.hpp>
 
 inline bool is_full(config const &settings) {
   constexpr std::string_view jetstream = "jetstream";
-  return !settings.get_config()[PROJECT_NAME]["datasource"]["hosts"]
+  YAML::Node hosts(settings.get_config()[PROJECT_NAME]["datasource"]["hosts"]);
+  // a list of relays is all one kind
+  return !(hosts.IsSequence() ? hosts[0] : hosts)
               .as<std::string>()
               .contains(jetstream);
 }
@@ -63,16 +76,66 @@ public:
 
   void set_config(std::shared_ptr<config> &settings, const int64_t cursor) {
     _settings = settings;
-    _host = _settings->get_config()[PROJECT_NAME]["datasource"]["hosts"]
-                .as<std::string>();
-    _port = _settings->get_config()[PROJECT_NAME]["datasource"]["port"]
-                .as<std::string>();
+    YAML::Node hosts(
+        _settings->get_config()[PROJECT_NAME]["datasource"]["hosts"]);
+    std::string port(_settings->get_config()[PROJECT_NAME]["datasource"]["port"]
+                         .as<std::string>());
+    if (hosts.IsSequence()) {
+      for (auto const &host : hosts) {
+        _relays.emplace_back(host.as<std::string>(), port);
+      }
+    } else {
+      _relays.emplace_back(hosts.as<std::string>(), port);
+    }
     _subscription =
         _settings->get_config()[PROJECT_NAME]["datasource"]["subscription"]
             .as<std::string>();
-    if (cursor != 0) {
-      _subscription.append(std::format("?cursor={}", cursor));
+    YAML::Node source_settings(
+        _settings->get_config()[PROJECT_NAME]["datasource"]);
+    // Jetstream compresses frames with a published dictionary on request
+    if constexpr (std::is_same_v<PAYLOAD, jetstream_payload>) {
+      YAML::Node dictionary(source_settings["zstd_dictionary"]);
+      if (dictionary) {
+        auto shared(
+            zstd_decompressor::load_dictionary(dictionary.as<std::string>()));
+        for (auto &relay : _relays) {
+          relay._decompressor = std::make_unique<zstd_decompressor>(
+              shared, source_settings["zstd_max_frame_size"].as<size_t>(
+                          zstd_decompressor::DefaultMaxFrameSize));
+        }
+        _subscription = with_query(_subscription, "compress=true");
+      }
+    }
+    // the saved cursor belongs to the first relay, others start live
+    _relays.front()._last_seq = cursor;
+    if (_relays.size() > 1) {
+      _recent = std::make_unique<recent_window>(
+          source_settings["dedup_window"].as<size_t>(
+              recent_window::DefaultWindow));
+    }
+    receive_buffer_pool::instance().set_config(source_settings);
+    _handler.set_config(source_settings);
+
+    // optional raw frame capture, and replay of a capture in place of the
+    // relay
+    YAML::Node capture(source_settings["capture"]);
+    if (capture) {
+      _capture = std::make_unique<capture_writer>(
+          capture["directory"].as<std::string>(),
+          capture["segment_megabytes"].as<size_t>(
+              capture_writer::DefaultSegmentMegabytes) *
+              1024 * 1024);
+    }
+    YAML::Node replay(source_settings["replay"]);
+    if (replay) {
+      _replay_directory = replay["directory"].as<std::string>();
+      _replay_at_recorded_pace =
+          replay["pace"].as<std::string>("fast") == "recorded";
+      _replay_from = replay["from_seq"].as<int64_t>(cursor);
+      _resume_live = replay["resume_live"].as<bool>(false);
     }
+    // plain websocket is only for a local relay stand-in
+    _tls = source_settings["tls"].as<bool>(true);
   }
 
   void start() {
@@ -80,6 +143,31 @@ public:
                                             "Number of inbound messages");
     metrics_factory::instance().add_counter("websocket_inbound_bytes",
                                             "Number of inbound message bytes");
+    metrics_factory::instance().add_counter(
+        "relay_frames", "Commits each relay delivered first or duplicated");
+    metrics_factory::instance().add_gauge(
+        "relay_lag", "Smoothed milliseconds each relay trails the first");
+    metrics_factory::instance().add_counter(
+        "shed_frames", "Low-value frames dropped while the pipeline is behind");
+    for (auto &relay : _relays) {
+      relay._first = &metrics_factory::instance()
+                          .get_counter("relay_frames")
+                          .Get({{"host", relay._name}, {"delivery", "first"}});
+      relay._duplicate =
+          &metrics_factory::instance()
+               .get_counter("relay_frames")
+               .Get({{"host", relay._name}, {"delivery", "duplicate"}});
+      relay._lag = &metrics_factory::instance().get_gauge("relay_lag").Get(
+          {{"host", relay._name}});
+    }
+    metrics_factory::instance().add_counter(
+        "websocket_zstd_bytes",
+        "Compressed and decompressed bytes of zstd inbound messages");
+    metrics_factory::instance().add_counter(
+        "receive_buffers", "Websocket receive buffer pool hits and misses");
+    metrics_factory::instance().add_gauge(
+        "receive_buffers_held", "Idle websocket receive buffer storage");
+    receive_buffer_pool::instance().start();
     metrics_factory::instance().add_counter(
         "message_string_matches",
         "Number of matches within each field of message");
@@ -108,40 +196,26 @@ public:
     metrics_factory::instance()
         .get_histogram("firehose_facets")
         .Add({{"facet", "total"}}, boundaries);
+    metrics_factory::instance().add_histogram(
+        "firehose_ingest_latency",
+        "Milliseconds from relay emit time to post-processing");
     _thread = std::thread([&, this] {
-      REL_INFO("client startup for {}:{} at {}", _host, _port, _subscription);
       try {
-        while (controller::instance().is_active()) {
-          // The io_context is required for all I/O
-          net::io_context ioc;
-
-          // The SSL context is required, and holds certificates
-          ssl::context ctx{ssl::context::tlsv12_client};
-
-          // Launch the asynchronous operation
-          boost::asio::spawn(ioc,
-                             std::bind(&datasource::do_work, this,
-                                       std::ref(ioc), std::ref(ctx),
-                                       std::placeholders::_1),
-                             // on completion, spawn will call this function
-                             [](std::exception_ptr ex) {
-                               // if an exception occurred in the coroutine,
-                               // it's something critical, e.g. out of memory
-                               // we capture normal errors in the ec
-                               // so we just rethrow the exception here,
-                               // which will cause `ioc.run()` to throw
-                               if (ex)
-                                 std::rethrow_exception(ex);
-                             });
-
-          // Run the I/O service. The call will return when
-          // the socket is closed.
-          ioc.run();
-
-          // we should run forever unless killed. Try to reconnect in a little
-          // while.
-          std::this_thread::sleep_for(std::chrono::seconds(10));
+        if (!_replay_directory.empty()) {
+          int64_t last_seq(replay());
+          if (_resume_live && last_seq > 0) {
+            _relays.front()._last_seq = last_seq;
+          } else {
+            // replayed frames drain through the pipeline until stopped
+            while (controller::instance().is_active()) {
+              std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+          }
+        }
+        for (size_t index = 1; index < _relays.size(); ++index) {
+          _relay_threads.emplace_back([this, index] { run_relay(index); });
         }
+        run_relay(0);
       } catch (std::exception const &exc) {
         REL_CRITICAL("datasource exception {}", exc.what());
       }
@@ -149,30 +223,147 @@ public:
     });
   }
 
-  void wait_for_end_thread() { _thread.join(); }
+  void wait_for_end_thread() {
+    _thread.join();
+    for (auto &relay_thread : _relay_threads) {
+      relay_thread.join();
+    }
+  }
 
 private:
-  // TODO support round robin if needed
-  std::string _host;
-  std::string _port;
+  // Every relay streams at once. The first copy of an event is handled and
+  // later copies dropped, so a stalled relay costs nothing while another
+  // keeps up.
+  struct relay {
+    // "host", "host:port" or "[v6 address]:port", the port defaults to the
+    // configured one. A bare v6 address has no port.
+    relay(std::string const &entry, std::string const &port)
+        : _name(entry), _host(entry), _port(port) {
+      if (entry.starts_with('[')) {
+        size_t close(entry.find(']'));
+        if (close == std::string::npos)
+          throw std::invalid_argument("Unterminated address in " + entry);
+        _host = entry.substr(1, close - 1);
+        if (close + 1 < entry.size()) {
+          if (entry[close + 1] != ':')
+            throw std::invalid_argument("Expected :port after " + _host);
+          _port = entry.substr(close + 2);
+        }
+      } else if (size_t colon(entry.find(':'));
+                 colon != std::string::npos &&
+                 entry.find(':', colon + 1) == std::string::npos) {
+        _host = entry.substr(0, colon);
+        _port = entry.substr(colon + 1);
+      }
+    }
+    std::string _name;
+    std::string _host;
+    std::string _port;
+    // a reconnect resumes after the last seq this relay delivered
+    int64_t _last_seq = 0;
+    prometheus::Counter *_first = nullptr;
+    prometheus::Counter *_duplicate = nullptr;
+    prometheus::Gauge *_lag = nullptr;
+    double _smoothed_lag = 0.0;
+    // a context per connection, all sharing one loaded dictionary
+    std::unique_ptr<zstd_decompressor> _decompressor;
+  };
+  // weight of the latest duplicate in the relay_lag average
+  static constexpr double LagSmoothing = 0.01;
+
+  std::vector<relay> _relays;
   std::string _subscription;
+  bool _tls = true;
+  std::mutex _ingest_lock;
+  std::unique_ptr<recent_window> _recent;
   content_handler<PAYLOAD> _handler;
+  std::unique_ptr<capture_writer> _capture;
+  std::string _replay_directory;
+  bool _replay_at_recorded_pace = false;
+  int64_t _replay_from = 0;
+  bool _resume_live = false;
   std::shared_ptr<config> _settings;
   std::thread _thread;
+  std::vector<std::thread> _relay_threads;
   std::unique_ptr<datasource> _instance;
 
-  void do_work(net::io_context &ioc, ssl::context &ctx,
-               net::yield_context yield) {
+  void run_relay(const size_t index) {
+    std::string const &name(_relays[index]._name);
+    try {
+      while (controller::instance().is_active()) {
+        std::string target;
+        {
+          std::lock_guard guard(_ingest_lock);
+          int64_t last_seq(_relays[index]._last_seq);
+          target = last_seq > 0 ? with_query(_subscription,
+                                             std::format("cursor={}", last_seq))
+                                : _subscription;
+        }
+        REL_INFO("client startup for {} at {}", name, target);
+
+        // The io_context is required for all I/O
+        net::io_context ioc;
+
+        // The SSL context is required, and holds certificates
+        ssl::context ctx{ssl::context::tlsv12_client};
+
+        // Launch the asynchronous operation
+        boost::asio::spawn(ioc,
+                           std::bind(&datasource::do_work, this, std::ref(ioc),
+                                     std::ref(ctx), index, std::cref(target),
+                                     std::placeholders::_1),
+                           // on completion, spawn will call this function
+                           [](std::exception_ptr ex) {
+                             // if an exception occurred in the coroutine,
+                             // it's something critical, e.g. out of memory
+                             // we capture normal errors in the ec
+                             // so we just rethrow the exception here,
+                             // which will cause `ioc.run()` to throw
+                             if (ex)
+                               std::rethrow_exception(ex);
+                           });
+
+        // Run the I/O service. The call will return when
+        // the socket is closed.
+        ioc.run();
+
+        // we should run forever unless killed. Try to reconnect in a little
+        // while.
+        std::this_thread::sleep_for(std::chrono::seconds(10));
+      }
+    } catch (std::exception const &exc) {
+      REL_CRITICAL("datasource exception {} for {}", exc.what(), name);
+    }
+  }
+
+  void do_work(net::io_context &ioc, ssl::context &ctx, const size_t index,
+               std::string const &target, net::yield_context yield) {
+    if (_tls) {
+      websocket::stream<ssl::stream<beast::tcp_stream>> ws(ioc, ctx);
+      run_session(ioc, ws, index, target, yield);
+    } else {
+      websocket::stream<beast::tcp_stream> ws(ioc);
+      run_session(ioc, ws, index, target, yield);
+    }
+  }
+
+  template <typename STREAM>
+  void run_session(net::io_context &ioc, STREAM &ws, const size_t index,
+                   std::string const &target, net::yield_context yield) {
+    constexpr bool is_tls =
+        !std::is_same_v<STREAM, websocket::stream<beast::tcp_stream>>;
+    std::string const &relay_host(_relays[index]._host);
+    std::string const &relay_name(_relays[index]._name);
     beast::error_code ec;
 
     // These objects perform our I/O
     tcp::resolver resolver(ioc);
-    websocket::stream<ssl::stream<beast::tcp_stream>> ws(ioc, ctx);
 
     // Look up the domain name
-    auto const results = resolver.async_resolve(_host, _port, yield[ec]);
+    auto const results =
+        resolver.async_resolve(relay_host, _relays[index]._port, yield[ec]);
     if (ec)
-      return fail(ec, "resolve");
+      return fail(relay_name, ec, "resolve");
 
     // Set a timeout on the operation
     beast::get_lowest_layer(ws).expires_after(std::chrono::seconds(30));
@@ -180,20 +371,22 @@ private:
     // Make the connection on the IP address we get from a lookup
     auto ep = beast::get_lowest_layer(ws).async_connect(results, yield[ec]);
     if (ec)
-      return fail(ec, "connect");
-
-    // Set SNI Hostname (many hosts need this to handshake successfully)
-    if (!SSL_set_tlsext_host_name(ws.next_layer().native_handle(),
-                                  _host.c_str())) {
-      ec = beast::error_code(static_cast<int>(::ERR_get_error()),
-                             net::error::get_ssl_category());
-      return fail(ec, "connect");
+      return fail(relay_name, ec, "connect");
+
+    if constexpr (is_tls) {
+      // Set SNI Hostname (many hosts need this to handshake successfully)
+      if (!SSL_set_tlsext_host_name(ws.next_layer().native_handle(),
+                                    relay_host.c_str())) {
+        ec = beast::error_code(static_cast<int>(::ERR_get_error()),
+                               net::error::get_ssl_category());
+        return fail(relay_name, ec, "connect");
+      }
     }
 
     // Update the host string. This will provide the value of the
     // Host HTTP header during the WebSocket handshake.
     // See https://tools.ietf.org/html/rfc7230#section-5.4
-    auto host = _host + ':' + std::to_string(ep.port());
+    auto host = relay_host + ':' + std::to_string(ep.port());
 
     // Set a timeout on the operation
     beast::get_lowest_layer(ws).expires_after(std::chrono::seconds(30));
@@ -206,10 +399,12 @@ private:
                       " websocket-client-coro");
         }));
 
-    // Perform the SSL handshake
-    ws.next_layer().async_handshake(ssl::stream_base::client, yield[ec]);
-    if (ec)
-      return fail(ec, "ssl_handshake");
+    if constexpr (is_tls) {
+      // Perform the SSL handshake
+      ws.next_layer().async_handshake(ssl::stream_base::client, yield[ec]);
+      if (ec)
+        return fail(relay_name, ec, "ssl_handshake");
+    }
 
     // Turn off the timeout on the tcp_stream, because
     // the websocket stream has its own timeout system.
@@ -225,46 +420,172 @@ private:
     ws.set_option(opt);
 
     // Perform the websocket handshake
-    ws.async_handshake(_host, _subscription, yield[ec]);
+    ws.async_handshake(relay_host, target, yield[ec]);
     if (ec)
-      return fail(ec, "handshake");
+      return fail(relay_name, ec, "handshake");
+    // resolve per-host stats once, not per message
+    auto &inbound_messages(metrics_factory::instance()
+                               .get_counter("websocket_inbound_messages")
+                               .Get({{"host", relay_name}}));
+    auto &inbound_bytes(metrics_factory::instance()
+                            .get_counter("websocket_inbound_bytes")
+                            .Get({{"host", relay_name}}));
+    auto &zstd_bytes(
+        metrics_factory::instance().get_counter("websocket_zstd_bytes"));
+    auto &compressed_bytes(
+        zstd_bytes.Get({{"host", relay_name}, {"form", "compressed"}}));
+    auto &decompressed_bytes(
+        zstd_bytes.Get({{"host", relay_name}, {"form", "decompressed"}}));
+    zstd_decompressor *decompressor(_relays[index]._decompressor.get());
     // main processing loop
     while (controller::instance().is_active()) {
-      // This buffer will hold the incoming message
-      beast::flat_buffer buffer;
+      // This buffer will hold the incoming message, it is recycled once the
+      // message has been processed
+      pooled_buffer buffer(receive_buffer_pool::instance().acquire());
 
       // Read a message into our buffer
-      ws.async_read(buffer, yield[ec]);
+      ws.async_read(*buffer, yield[ec]);
       if (ec)
-        return fail(ec, "read");
+        return fail(relay_name, ec, "read");
 
       // update stats
-      metrics_factory::instance()
-          .get_counter("websocket_inbound_messages")
-          .Get({{"host", _host}})
-          .Increment();
-      metrics_factory::instance()
-          .get_counter("websocket_inbound_bytes")
-          .Get({{"host", _host}})
-          .Increment(static_cast<double>(buffer.size()));
-
-      _handler.handle(buffer);
+      inbound_messages.Increment();
+      inbound_bytes.Increment(static_cast<double>(buffer->size()));
+
+      if (decompressor) {
+        compressed_bytes.Increment(static_cast<double>(buffer->size()));
+        try {
+          // the compressed frame goes back to the pool here
+          buffer = decompressor->decompress(buffer.bytes());
+        } catch (std::exception const &exc) {
+          REL_ERROR("datasource decompress error {}", exc.what());
+          continue;
+        }
+        decompressed_bytes.Increment(static_cast<double>(buffer->size()));
+      }
+
+      ingest(index, std::move(buffer));
     }
 
     // Close the WebSocket connection
     ws.async_close(websocket::close_code::normal, yield[ec]);
     if (ec)
-      return fail(ec, "close");
+      return fail(relay_name, ec, "close");
 
     // If we get here then the connection is closed gracefully
     REL_INFO("websocket stopping");
   }
 
+  // Feed the handler from a capture log, returns the last seq replayed
+  int64_t replay() {
+    REL_INFO("replay from {} at seq {}, {} pace", _replay_directory,
+             _replay_from, _replay_at_recorded_pace ? "recorded" : "fast");
+    auto &inbound_messages(metrics_factory::instance()
+                               .get_counter("websocket_inbound_messages")
+                               .Get({{"host", "replay"}}));
+    auto &inbound_bytes(metrics_factory::instance()
+                            .get_counter("websocket_inbound_bytes")
+                            .Get({{"host", "replay"}}));
+    capture_reader reader(_replay_directory);
+    if (_replay_from > 0) {
+      reader.seek(_replay_from);
+    }
+    captured_frame frame;
+    const auto started(std::chrono::steady_clock::now());
+    int64_t first_received(-1);
+    int64_t last_seq(-1);
+    size_t count(0);
+    while (controller::instance().is_active() && reader.next(frame)) {
+      if (_replay_at_recorded_pace) {
+        if (first_received < 0) {
+          first_received = frame._received_at;
+        }
+        std::this_thread::sleep_until(
+            started +
+            std::chrono::nanoseconds(frame._received_at - first_received));
+      }
+      pooled_buffer buffer(receive_buffer_pool::instance().acquire());
+      auto space(buffer->prepare(frame._frame.size()));
+      std::memcpy(space.data(), frame._frame.data(), frame._frame.size());
+      buffer->commit(frame._frame.size());
+
+      inbound_messages.Increment();
+      inbound_bytes.Increment(static_cast<double>(buffer->size()));
+      if (frame._seq >= 0) {
+        last_seq = frame._seq;
+        save_rewind_point(frame._seq, buffer.bytes());
+      }
+      ++count;
+      // unindexed frames were handled from another relay
+      _handler.handle(std::move(buffer), frame._seq >= 0 && !_recent);
+    }
+    REL_INFO("replay complete, {} frames up to seq {}", count, last_seq);
+    return last_seq;
+  }
+
+  // Frames from every relay pass through here one at a time, the handler
+  // expects a single producer
+  void ingest(const size_t index, pooled_buffer &&frame) {
+    std::lock_guard guard(_ingest_lock);
+    relay &source(_relays[index]);
+    int64_t seq(PAYLOAD::sequence_of(frame.bytes()));
+    if (seq > 0) {
+      source._last_seq = seq;
+      if (index == 0) {
+        save_rewind_point(seq, frame.bytes());
+      }
+    }
+    if (_recent) {
+      uint64_t key(PAYLOAD::event_key_of(frame.bytes()));
+      if (key != 0) {
+        int64_t now(std::chrono::steady_clock::now().time_since_epoch() /
+                    std::chrono::nanoseconds(1));
+        auto first(
+            _recent->insert(key, now, static_cast<uint32_t>(index)));
+        // a relay resending its own events after a reconnect is not lag
+        if (!first || first->_source != index) {
+          double lag(first ? static_cast<double>(now - first->_arrived) / 1e6
+                           : 0.0);
+          source._smoothed_lag += LagSmoothing * (lag - source._smoothed_lag);
+          source._lag->Set(source._smoothed_lag);
+        }
+        if (first) {
+          source._duplicate->Increment();
+          return;
+        }
+        source._first->Increment();
+      }
+    }
+    // capture holds frames as handled, replay needs no dictionary. Only the
+    // first relay's seq is indexed, others are not comparable with it.
+    if (_capture) {
+      _capture->append(index == 0 ? seq : -1, frame.bytes());
+    }
+    _handler.handle(std::move(frame), index == 0 && !_recent);
+  }
+
+  // The saved cursor is the first relay's. With one relay it is saved as
+  // frames are processed. With several, the copy of an event that is
+  // handled may be any relay's, so the first relay's seq is saved as its
+  // frames arrive, duplicates included.
+  void save_rewind_point(const int64_t seq, std::span<const uint8_t> frame) {
+    if constexpr (std::is_same_v<PAYLOAD, firehose_payload>) {
+      if (_recent) {
+        PAYLOAD::save_rewind_point(seq, frame);
+      }
+    }
+  }
+
+  static std::string with_query(std::string const &target,
+                                std::string const &parameter) {
+    return target + (target.contains('?') ? '&' : '?') + parameter;
+  }
+
   // Report a failure
-  void fail(beast::error_code ec, char const *what) {
+  void fail(std::string const &host, beast::error_code ec, char const *what) {
     std::ostringstream oss;
     oss << what << ": " << ec.message() << "\n";
-    REL_ERROR("datasource error: {}", oss.str());
+    REL_ERROR("datasource error for {}: {}", host, oss.str());
   }
 };
 #endif
\ No newline at end of file
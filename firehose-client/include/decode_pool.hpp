@@ -0,0 +1,175 @@
+#ifndef __decode_pool_hpp__
+#define __decode_pool_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "common/controller.hpp"
+#include "common/log_wrapper.hpp"
+#include "common/metrics_factory.hpp"
+#include "common/stage_queue.hpp"
+#include "dag_cbor.hpp"
+#include "post_processor.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Decodes payloads on a pool of worker threads, then releases them to the
+// post-processor in arrival order. The relay sends frames in sequence order,
+// so the post-processor still sees a monotonic cursor.
+template <typename T> class decode_pool {
+public:
+  static constexpr size_t QueueLimit = 10000;
+  // decoded payloads that may wait on a slower, earlier one
+  static constexpr uint64_t ReorderLimit = 1000;
+
+  decode_pool(post_processor<T> &processor)
+      : _processor(processor),
+        _queue(QueueLimit, {{"message", "decode_backlog"}}) {}
+  ~decode_pool() { stop(); }
+  decode_pool(decode_pool const &) = delete;
+  decode_pool &operator=(decode_pool const &) = delete;
+
+  void start(const size_t number_of_threads) {
+    _reorder_pending = &metrics_factory::instance()
+                            .get_gauge("process_operation")
+                            .Get({{"message", "reorder_pending"}});
+    _threads.reserve(number_of_threads);
+    for (size_t count = 0; count < number_of_threads; ++count) {
+      _threads.emplace_back([&, this] {
+        try {
+          while (controller::instance().is_active()) {
+            sequenced next;
+            _queue.wait_dequeue(next);
+            if (_stopping)
+              break;
+            std::optional<T> decoded;
+            try {
+              next._payload.decode();
+              decoded = std::move(next._payload);
+            } catch (nlohmann::detail::exception const &exc) {
+              REL_ERROR("decode_pool JSON error {} on payload {}", exc.what(),
+                        next._payload.to_string());
+            } catch (dag_cbor::decode_error const &exc) {
+              REL_ERROR("decode_pool CBOR error {} on payload {}", exc.what(),
+                        next._payload.to_string());
+            } catch (std::exception const &exc) {
+              REL_ERROR("decode_pool error {} on payload {}", exc.what(),
+                        next._payload.to_string());
+            }
+            // failed payloads still release their slot, or every later one
+            // would wait on it
+            release(next._ordinal, std::move(decoded));
+          }
+        } catch (std::exception const &exc) {
+          REL_ERROR("decode_pool exception {}", exc.what());
+          controller::instance().force_stop();
+        }
+        REL_INFO("decode_pool stopping");
+      });
+    }
+  }
+  inline bool is_started() const { return !_threads.empty(); }
+  // Wakes and joins the workers. Payloads not yet released are discarded.
+  void stop() {
+    {
+      std::lock_guard lock(_lock);
+      if (_stopping)
+        return;
+      _stopping = true;
+    }
+    _released.notify_all();
+    for (size_t count = 0; count < _threads.size(); ++count) {
+      _queue.enqueue(sequenced());
+    }
+    for (auto &thread : _threads) {
+      thread.join();
+    }
+    _threads.clear();
+  }
+
+  // single producer, the websocket thread
+  void wait_enqueue(T &&value) {
+    _queue.enqueue(sequenced{_next_ordinal++, std::move(value)});
+  }
+  // waiting for a worker, not counting those decoded but not yet released
+  inline size_t backlog() const { return _queue.size_approx(); }
+
+private:
+  struct sequenced {
+    uint64_t _ordinal = 0;
+    T _payload;
+  };
+  // reorder buffer entry, a failed decode arrives with no payload
+  struct slot {
+    bool _arrived = false;
+    std::optional<T> _payload;
+  };
+
+  void release(const uint64_t ordinal, std::optional<T> &&decoded) {
+    std::unique_lock lock(_lock);
+    // The worker holding the oldest outstanding ordinal never waits here, so
+    // this bounds the reorder buffer without risk of deadlock.
+    _released.wait(lock, [&] {
+      return _stopping || ordinal - _next_release < ReorderLimit;
+    });
+    if (_stopping)
+      return;
+    slot &arrived(_pending[ordinal % ReorderLimit]);
+    arrived._payload = std::move(decoded);
+    arrived._arrived = true;
+    ++_pending_count;
+    bool progressed(false);
+    while (_pending[_next_release % ReorderLimit]._arrived) {
+      slot &ready(_pending[_next_release % ReorderLimit]);
+      if (ready._payload) {
+        // post-processor queue is single-producer, the lock serializes us
+        _processor.wait_enqueue(std::move(*ready._payload));
+        ready._payload.reset();
+      }
+      ready._arrived = false;
+      --_pending_count;
+      ++_next_release;
+      progressed = true;
+    }
+    _reorder_pending->Set(static_cast<double>(_pending_count));
+    if (progressed) {
+      _released.notify_all();
+    }
+  }
+
+  post_processor<T> &_processor;
+  stage_queue<sequenced> _queue;
+  std::vector<std::thread> _threads;
+  uint64_t _next_ordinal = 0;
+  std::atomic<bool> _stopping = false;
+
+  std::mutex _lock;
+  std::condition_variable _released;
+  // ring indexed by ordinal, fixed size so release does not allocate
+  std::vector<slot> _pending = std::vector<slot>(ReorderLimit);
+  size_t _pending_count = 0;
+  uint64_t _next_release = 0;
+  prometheus::Gauge *_reorder_pending = nullptr;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef __filter_automaton_hpp__
+#define __filter_automaton_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Aho-Corasick automaton over UTF-8 for every string a rule set looks for:
+// rule filters and their contingent strings alike. Each keyword carries the
+// patterns that use it, so one pass over a candidate reports every filter
+// hit and every contingent hit. Keywords are in canonical form, text only
+// needs its non-ASCII case-folded (fold_non_ascii) as ASCII is folded by
+// table lookup on each transition.
+// States live in a double array: a transition is two reads from one
+// contiguous array rather than a search of per-state edge lists, and the
+// keywords found in each state are a run of one contiguous array.
+class filter_automaton {
+public:
+  // what a hit on the pattern means for its rule
+  enum class role : uint8_t { primary, required, absent };
+  struct pattern {
+    uint32_t _owner = 0;
+    role _role = role::primary;
+    // hit only counts with no letter either side
+    bool _whole_word = false;
+  };
+
+  // Patterns added after build() are not matched until the next build()
+  void add(std::string const &keyword, pattern const &value);
+  void build();
+  inline bool is_built() const { return _built; }
+  inline bool empty() const { return _keywords.empty(); }
+  // bytes held by the built automaton, for sizing large rule sets
+  size_t footprint() const;
+
+  // Calls on_hit(pattern const &, size_t start) for each pattern occurrence,
+  // in order of where it ends. Whole-word patterns are only reported on a
+  // word boundary. Read-only, safe to call from many threads once built.
+  template <typename ON_HIT>
+  void scan(std::string_view text, ON_HIT &&on_hit) const {
+    if (!_built)
+      return;
+    uint32_t state(Root);
+    for (size_t index = 0; index < text.size(); ++index) {
+      state = next(state, Fold[static_cast<uint8_t>(text[index])]);
+      uint32_t output(_cells[state]._outputs);
+      if (output == None)
+        continue;
+      for (; _outputs[output] != None; ++output) {
+        keyword const &found(_keywords[_outputs[output]]);
+        const size_t start(index + 1 - found._length);
+        bool is_word(!is_letter(text, start - 1) &&
+                     !is_letter(text, index + 1));
+        for (uint32_t entry = found._first; entry < found._last; ++entry) {
+          pattern const &hit(_patterns[entry]);
+          if (!hit._whole_word || is_word) {
+            on_hit(hit, start);
+          }
+        }
+      }
+    }
+  }
+
+private:
+  static constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+  static constexpr uint32_t Root = 0;
+  static constexpr size_t Alphabet = 256;
+  // ASCII upper case to lower case, other bytes unchanged
+  static constexpr std::array<uint8_t, Alphabet> Fold = [] {
+    std::array<uint8_t, Alphabet> fold = {};
+    for (size_t next = 0; next < Alphabet; ++next) {
+      fold[next] = static_cast<uint8_t>(
+          next >= 'A' && next <= 'Z' ? next - 'A' + 'a' : next);
+    }
+    return fold;
+  }();
+
+  // a state, by its slot in the double array. The state's child on a label
+  // is in slot _base + label if that slot's _check is this state.
+  struct cell {
+    uint32_t _base = 0;
+    // parent state, or None for a free slot
+    uint32_t _check = None;
+    uint32_t _failure = Root;
+    // first of the keywords ending here or on the failure chain, longest
+    // first and None-terminated in _outputs, or None if there are none
+    uint32_t _outputs = None;
+  };
+  // trie edge, only while building
+  struct edge {
+    uint8_t _label;
+    uint32_t _target;
+  };
+  struct keyword {
+    uint32_t _length = 0;
+    // this keyword's patterns in _patterns
+    uint32_t _first = 0;
+    uint32_t _last = 0;
+  };
+
+  // word boundary as in aho_corasick's only_whole_words: ASCII letters
+  static inline bool is_letter(std::string_view text, const size_t index) {
+    if (index >= text.size())
+      return false;
+    const char next(text[index]);
+    return (next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z');
+  }
+
+  // every base leaves room for a full alphabet, so no bounds check
+  inline uint32_t child(uint32_t from, const uint8_t label) const {
+    const uint32_t target(_cells[from]._base + label);
+    if (_cells[target]._check == from)
+      return target;
+    return None;
+  }
+
+  inline uint32_t next(uint32_t from, const uint8_t label) const {
+    while (true) {
+      uint32_t target(child(from, label));
+      if (target != None)
+        return target;
+      if (from == Root)
+        return Root;
+      from = _cells[from]._failure;
+    }
+  }
+
+  uint32_t free_base(std::vector<edge> const &edges, size_t &first_free);
+
+  // patterns by keyword text, flattened into _patterns by build()
+  std::unordered_map<std::string, std::vector<pattern>> _pending;
+  std::vector<keyword> _keywords;
+  std::vector<pattern> _patterns;
+  std::vector<cell> _cells;
+  // keyword indexes, see cell::_outputs
+  std::vector<uint32_t> _outputs;
+  bool _built = false;
+};
+
+#endif
@@ -0,0 +1,430 @@
+#ifndef __json_scan_hpp__
+#define __json_scan_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JSON_SCAN_SSE2 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// On-demand reads from a JSON document such as a Jetstream event. Nothing is
+// parsed up front: a lookup walks the members of one object, skipping the
+// values it passes over, and strings are returned as views into the input
+// unless they contain escapes. Skipping is by 16-byte blocks where SSE2 is
+// available.
+namespace json_scan {
+
+class scan_error : public std::runtime_error {
+public:
+  explicit scan_error(std::string const &message)
+      : std::runtime_error(message) {}
+};
+
+namespace detail {
+
+#if JSON_SCAN_SSE2
+inline unsigned first_set(const unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+// first '"' or '\' at or after next, end if there is none
+inline const char *find_quote_or_escape(const char *next, const char *end) {
+#if JSON_SCAN_SSE2
+  const __m128i quote(_mm_set1_epi8('"'));
+  const __m128i escape(_mm_set1_epi8('\\'));
+  for (; end - next >= 16; next += 16) {
+    const __m128i block(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(next)));
+    const unsigned mask(static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                       _mm_cmpeq_epi8(block, escape)))));
+    if (mask != 0)
+      return next + first_set(mask);
+  }
+#endif
+  for (; next != end; ++next) {
+    if (*next == '"' || *next == '\\')
+      return next;
+  }
+  return end;
+}
+
+// first '"', '{', '}', '[' or ']' at or after next, end if there is none
+inline const char *find_structural(const char *next, const char *end) {
+#if JSON_SCAN_SSE2
+  // '[' and ']' differ from '{' and '}' only in bit 5
+  const __m128i fold(_mm_set1_epi8(0x20));
+  const __m128i quote(_mm_set1_epi8('"'));
+  const __m128i open(_mm_set1_epi8('{'));
+  const __m128i close(_mm_set1_epi8('}'));
+  for (; end - next >= 16; next += 16) {
+    const __m128i block(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(next)));
+    const __m128i folded(_mm_or_si128(block, fold));
+    const unsigned mask(static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                     _mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                                  _mm_cmpeq_epi8(folded, close))))));
+    if (mask != 0)
+      return next + first_set(mask);
+  }
+#endif
+  for (; next != end; ++next) {
+    switch (*next) {
+    case '"':
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+      return next;
+    default:
+      break;
+    }
+  }
+  return end;
+}
+
+inline const char *skip_whitespace(const char *next, const char *end) {
+  while (next != end &&
+         (*next == ' ' || *next == '\n' || *next == '\r' || *next == '\t')) {
+    ++next;
+  }
+  return next;
+}
+
+// one past the closing quote of the string that opens at quote
+inline const char *skip_string(const char *quote, const char *end,
+                               bool &escaped) {
+  const char *next(quote + 1);
+  while (true) {
+    next = find_quote_or_escape(next, end);
+    if (next == end)
+      throw scan_error("unterminated JSON string");
+    if (*next == '"')
+      return next + 1;
+    escaped = true;
+    // the escaped character cannot end the string
+    next += 2;
+    if (next > end)
+      throw scan_error("unterminated JSON string");
+  }
+}
+
+// one past the end of the value that starts at next
+inline const char *skip_value(const char *next, const char *end,
+                              bool &escaped) {
+  if (next == end)
+    throw scan_error("missing JSON value");
+  switch (*next) {
+  case '"':
+    return skip_string(next, end, escaped);
+  case '{':
+  case '[': {
+    size_t depth(1);
+    ++next;
+    while (true) {
+      next = find_structural(next, end);
+      if (next == end)
+        throw scan_error("unterminated JSON container");
+      if (*next == '"') {
+        bool ignored(false);
+        next = skip_string(next, end, ignored);
+      } else if (*next == '{' || *next == '[') {
+        ++depth;
+        ++next;
+      } else {
+        ++next;
+        if (--depth == 0)
+          return next;
+      }
+    }
+  }
+  default: {
+    // number, true, false or null
+    const char *start(next);
+    while (next != end && *next != ',' && *next != '}' && *next != ']' &&
+           *next != ' ' && *next != '\n' && *next != '\r' && *next != '\t') {
+      ++next;
+    }
+    if (next == start)
+      throw scan_error("missing JSON value");
+    return next;
+  }
+  }
+}
+
+inline unsigned hex_digit(const char next) {
+  if (next >= '0' && next <= '9')
+    return static_cast<unsigned>(next - '0');
+  if (next >= 'a' && next <= 'f')
+    return static_cast<unsigned>(next - 'a' + 10);
+  if (next >= 'A' && next <= 'F')
+    return static_cast<unsigned>(next - 'A' + 10);
+  throw scan_error("invalid JSON \\u escape");
+}
+
+inline unsigned read_hex4(const char *&next, const char *end) {
+  if (end - next < 4)
+    throw scan_error("truncated JSON \\u escape");
+  unsigned result(0);
+  for (int digit = 0; digit < 4; ++digit) {
+    result = (result << 4) | hex_digit(*next++);
+  }
+  return result;
+}
+
+inline void append_utf8(const uint32_t code_point, std::string &output) {
+  if (code_point < 0x80) {
+    output.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    output.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else if (code_point < 0x10000) {
+    output.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else {
+    output.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+    output.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    output.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  }
+}
+
+// Decode the contents of a string, without its quotes, into output. A lone
+// surrogate becomes U+FFFD.
+inline void unescape(std::string_view escaped, std::string &output) {
+  constexpr uint32_t Replacement = 0xfffd;
+  output.clear();
+  output.reserve(escaped.size());
+  const char *next(escaped.data());
+  const char *end(next + escaped.size());
+  while (next != end) {
+    const char *escape(find_quote_or_escape(next, end));
+    output.append(next, escape);
+    if (escape == end)
+      break;
+    next = escape + 1;
+    if (next == end)
+      throw scan_error("truncated JSON escape");
+    switch (*next++) {
+    case '"':
+      output.push_back('"');
+      break;
+    case '\\':
+      output.push_back('\\');
+      break;
+    case '/':
+      output.push_back('/');
+      break;
+    case 'b':
+      output.push_back('\b');
+      break;
+    case 'f':
+      output.push_back('\f');
+      break;
+    case 'n':
+      output.push_back('\n');
+      break;
+    case 'r':
+      output.push_back('\r');
+      break;
+    case 't':
+      output.push_back('\t');
+      break;
+    case 'u': {
+      uint32_t code_point(read_hex4(next, end));
+      if (code_point >= 0xd800 && code_point < 0xdc00) {
+        if (end - next >= 6 && next[0] == '\\' && next[1] == 'u') {
+          const char *low_start(next + 2);
+          const uint32_t low(read_hex4(low_start, end));
+          if (low >= 0xdc00 && low < 0xe000) {
+            code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                         (low - 0xdc00);
+            next = low_start;
+          } else {
+            code_point = Replacement;
+          }
+        } else {
+          code_point = Replacement;
+        }
+      } else if (code_point >= 0xdc00 && code_point < 0xe000) {
+        code_point = Replacement;
+      }
+      append_utf8(code_point, output);
+      break;
+    }
+    default:
+      throw scan_error("invalid JSON escape");
+    }
+  }
+}
+
+} // namespace detail
+
+class value {
+public:
+  value() = default;
+  // the value at the start of the input, after any whitespace
+  explicit value(std::string_view json) {
+    const char *end(json.data() + json.size());
+    _begin = detail::skip_whitespace(json.data(), end);
+    _end = detail::skip_value(_begin, end, _escaped);
+  }
+
+  inline bool is_valid() const { return _begin != nullptr; }
+  inline explicit operator bool() const { return is_valid(); }
+  inline bool is_object() const { return is_valid() && *_begin == '{'; }
+  inline bool is_array() const { return is_valid() && *_begin == '['; }
+  inline bool is_text() const { return is_valid() && *_begin == '"'; }
+
+  // full JSON text of the value
+  inline std::string_view raw() const {
+    return is_valid() ? std::string_view(_begin, _end) : std::string_view();
+  }
+  // String contents. A view into the input unless there are escapes, then
+  // decoded into scratch and a view of that.
+  inline std::string_view as_text(std::string &scratch) const {
+    if (!is_text())
+      throw scan_error("JSON value is not a string");
+    std::string_view contents(_begin + 1, _end - 1);
+    if (!_escaped)
+      return contents;
+    detail::unescape(contents, scratch);
+    return scratch;
+  }
+  // compares string contents without decoding when there are no escapes
+  inline bool operator==(std::string_view text) const {
+    if (!is_text())
+      return false;
+    if (!_escaped)
+      return std::string_view(_begin + 1, _end - 1) == text;
+    std::string scratch;
+    return as_text(scratch) == text;
+  }
+
+  // Object member by key. Returns an absent value if not found or not an
+  // object.
+  inline value operator[](std::string_view key) const {
+    if (!is_object())
+      return value();
+    const char *next(detail::skip_whitespace(_begin + 1, _end));
+    if (next != _end && *next == '}')
+      return value();
+    while (next != _end) {
+      if (*next != '"')
+        throw scan_error("JSON object key is not a string");
+      value name;
+      name._begin = next;
+      name._end = detail::skip_string(next, _end, name._escaped);
+      next = detail::skip_whitespace(name._end, _end);
+      if (next == _end || *next != ':')
+        throw scan_error("missing ':' in JSON object");
+      value member;
+      member._begin = detail::skip_whitespace(next + 1, _end);
+      member._end = detail::skip_value(member._begin, _end, member._escaped);
+      if (name == key)
+        return member;
+      next = detail::skip_whitespace(member._end, _end);
+      if (next == _end || *next == '}')
+        break;
+      if (*next != ',')
+        throw scan_error("missing ',' in JSON object");
+      next = detail::skip_whitespace(next + 1, _end);
+    }
+    return value();
+  }
+  // Array element by position. Returns an absent value if out of range or
+  // not an array.
+  inline value operator[](const size_t index) const {
+    if (!is_array())
+      return value();
+    const char *next(detail::skip_whitespace(_begin + 1, _end));
+    if (next != _end && *next == ']')
+      return value();
+    for (size_t position = 0; next != _end; ++position) {
+      value element;
+      element._begin = next;
+      element._end = detail::skip_value(next, _end, element._escaped);
+      if (position == index)
+        return element;
+      next = detail::skip_whitespace(element._end, _end);
+      if (next == _end || *next == ']')
+        break;
+      if (*next != ',')
+        throw scan_error("missing ',' in JSON array");
+      next = detail::skip_whitespace(next + 1, _end);
+    }
+    return value();
+  }
+
+  // RFC 6901 pointer such as "/embed/images/0/alt". Array indexes are
+  // decimal; ~0 and ~1 escapes are not used by the configured fields and are
+  // not decoded.
+  inline value at_pointer(std::string_view pointer) const {
+    value current(*this);
+    while (!pointer.empty() && current.is_valid()) {
+      if (pointer.front() != '/')
+        return value();
+      pointer.remove_prefix(1);
+      const std::string_view token(pointer.substr(0, pointer.find('/')));
+      pointer.remove_prefix(token.size());
+      if (current.is_array()) {
+        size_t index(0);
+        auto parsed(std::from_chars(token.data(), token.data() + token.size(),
+                                    index));
+        if (parsed.ec != std::errc() ||
+            parsed.ptr != token.data() + token.size())
+          return value();
+        current = current[index];
+      } else {
+        current = current[token];
+      }
+    }
+    return current;
+  }
+
+private:
+  const char *_begin = nullptr;
+  const char *_end = nullptr;
+  // string with at least one escape
+  bool _escaped = false;
+};
+
+} // namespace json_scan
+
+#endif
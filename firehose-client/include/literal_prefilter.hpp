@@ -0,0 +1,159 @@
+#ifndef __literal_prefilter_hpp__
+#define __literal_prefilter_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LITERAL_PREFILTER_SSE2 1
+#endif
+
+// Cheap rejection of candidate text that cannot contain any filter, ahead of
+// case folding and the automaton. Each ASCII filter contributes one of its
+// trigrams to a bitmap over ASCII-folded text: text containing the filter
+// must contain that trigram. A two-byte filter adds every trigram ending in
+// it and a one-byte filter goes in a set of bytes, so each byte of text
+// costs one bitmap test. Only all-ASCII text is judged. Folding keeps it
+// ASCII, so filters with other characters can never occur in it, while ICU
+// folding of non-ASCII text can produce ASCII, so that text always passes.
+// Text is read 16 bytes at a time where SSE2 is available.
+class literal_prefilter {
+public:
+  // keyword in canonical form
+  void add(std::string_view keyword) {
+    for (const char next : keyword) {
+      if (!is_ascii(next))
+        return;
+    }
+    if (keyword.size() >= 3) {
+      size_t best(0);
+      unsigned best_rarity(0);
+      for (size_t start = 0; start + 3 <= keyword.size(); ++start) {
+        unsigned rarity(rarity_of(keyword[start]) +
+                        rarity_of(keyword[start + 1]) +
+                        rarity_of(keyword[start + 2]));
+        if (rarity > best_rarity) {
+          best = start;
+          best_rarity = rarity;
+        }
+      }
+      set(_trigrams, trigram_index(window_of(0, keyword[best]) << 14 |
+                                   window_of(keyword[best + 1],
+                                             keyword[best + 2])));
+    } else if (keyword.size() == 2) {
+      // the text's first byte may be the second of the filter, windows start
+      // as zero bytes
+      for (uint32_t first = 0; first < 128; ++first) {
+        set(_trigrams, trigram_index(first << 14 |
+                                     window_of(keyword[0], keyword[1])));
+      }
+    } else if (keyword.size() == 1) {
+      set(_bytes, fold(keyword[0]));
+      _has_bytes = true;
+    }
+  }
+
+  // false if no filter can occur in the text
+  bool may_match(std::string_view text) const {
+    const uint8_t *next(reinterpret_cast<const uint8_t *>(text.data()));
+    const uint8_t *end(next + text.size());
+    // last three folded bytes, the oldest highest
+    uint32_t window(0);
+#if LITERAL_PREFILTER_SSE2
+    const __m128i before_upper(_mm_set1_epi8('A' - 1));
+    const __m128i after_upper(_mm_set1_epi8('Z' + 1));
+    const __m128i to_lower(_mm_set1_epi8(0x20));
+    alignas(16) uint8_t folded[16];
+    for (; end - next >= 16; next += 16) {
+      const __m128i block(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(next)));
+      if (_mm_movemask_epi8(block) != 0)
+        return true;
+      const __m128i upper(_mm_and_si128(_mm_cmpgt_epi8(block, before_upper),
+                                        _mm_cmplt_epi8(block, after_upper)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(folded),
+                      _mm_add_epi8(block, _mm_and_si128(upper, to_lower)));
+      for (const uint8_t byte : folded) {
+        if (hit(window, byte))
+          return true;
+      }
+    }
+#endif
+    for (; next != end; ++next) {
+      if (!is_ascii(static_cast<char>(*next)))
+        return true;
+      if (hit(window, fold(static_cast<char>(*next))))
+        return true;
+    }
+    return false;
+  }
+
+private:
+  static inline bool is_ascii(const char next) {
+    return static_cast<uint8_t>(next) < 0x80;
+  }
+  static inline uint8_t fold(const char next) {
+    return next >= 'A' && next <= 'Z' ? static_cast<uint8_t>(next - 'A' + 'a')
+                                      : static_cast<uint8_t>(next);
+  }
+  // English letters by frequency, anything else counts as rarest
+  static inline unsigned rarity_of(const char next) {
+    constexpr std::string_view ByFrequency("etaoinshrdlcumwfgypbvkjxqz");
+    size_t rank(ByFrequency.find(static_cast<char>(fold(next))));
+    return rank == std::string_view::npos ? static_cast<unsigned>(26)
+                                          : static_cast<unsigned>(rank);
+  }
+
+  // two folded bytes as the low 14 bits of a window
+  static inline uint32_t window_of(const char first, const char second) {
+    return static_cast<uint32_t>(fold(first)) << 7 | fold(second);
+  }
+  static constexpr size_t TrigramBits = 16;
+  // 21-bit window hashed to a bit
+  static inline uint32_t trigram_index(const uint32_t window) {
+    return (window * 0x9e3779b1U) >> (32 - TrigramBits);
+  }
+  template <size_t WORDS>
+  static inline void set(std::array<uint64_t, WORDS> &bits,
+                         const uint32_t index) {
+    bits[index >> 6] |= uint64_t(1) << (index & 63);
+  }
+  template <size_t WORDS>
+  static inline bool test(std::array<uint64_t, WORDS> const &bits,
+                          const uint32_t index) {
+    return (bits[index >> 6] >> (index & 63)) & 1;
+  }
+
+  inline bool hit(uint32_t &window, const uint8_t byte) const {
+    window = ((window << 7) | byte) & 0x1fffff;
+    return test(_trigrams, trigram_index(window)) ||
+           (_has_bytes && test(_bytes, byte));
+  }
+
+  std::array<uint64_t, (size_t(1) << TrigramBits) / 64> _trigrams = {};
+  std::array<uint64_t, 128 / 64> _bytes = {};
+  bool _has_bytes = false;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef __load_shedder_hpp__
+#define __load_shedder_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <algorithm>
+#include <cstdint>
+#include <yaml-cpp/yaml.h>
+
+// What a frame is worth to us, decided from its header and op paths before
+// any decode. Posts, profiles and other records we match on, identity and
+// handle updates and account status are essential. Commits that only touch
+// likes, follows and reposts feed statistics.
+enum class frame_value { essential, statistics };
+
+// Admission ahead of the post-processing queues. Below shed_from queued
+// frames everything is admitted. From there statistics frames are sampled,
+// one in sample_every, and from drop_from they are all dropped. Essential
+// frames are always admitted: losing some statistics is better than falling
+// far enough behind that the relay disconnects us.
+class load_shedder {
+public:
+  static constexpr size_t DefaultShedFrom = 5000;
+  static constexpr size_t DefaultDropFrom = 10000;
+  static constexpr size_t DefaultSampleEvery = 10;
+
+  load_shedder(const size_t shed_from = DefaultShedFrom,
+               const size_t drop_from = DefaultDropFrom,
+               const size_t sample_every = DefaultSampleEvery)
+      : _shed_from(shed_from), _drop_from(std::max(shed_from, drop_from)),
+        _sample_every(std::max<size_t>(sample_every, 1)) {}
+
+  // Policy from the datasource settings' overload section, defaults for
+  // anything not given there. A replay is there to reproduce a run, so it is
+  // never shed.
+  void set_config(YAML::Node const &settings) {
+    const YAML::Node overload(settings["overload"]);
+    *this = overload
+                ? load_shedder(
+                      overload["shed_from"].as<size_t>(DefaultShedFrom),
+                      overload["drop_from"].as<size_t>(DefaultDropFrom),
+                      overload["sample_every"].as<size_t>(DefaultSampleEvery))
+                : load_shedder();
+    _enabled = !settings["replay"] &&
+               (!overload || overload["enabled"].as<bool>(true));
+  }
+  inline bool enabled() const { return _enabled; }
+
+  inline bool under_pressure(const size_t backlog) const {
+    return backlog >= _shed_from;
+  }
+
+  // true to handle the frame, false to drop it. Single caller, the ingest
+  // thread.
+  bool admit(const frame_value value, const size_t backlog) {
+    if (value == frame_value::essential || !under_pressure(backlog))
+      return true;
+    if (backlog < _drop_from && ++_sampled % _sample_every == 0)
+      return true;
+    ++_dropped;
+    return false;
+  }
+
+  inline uint64_t dropped() const { return _dropped; }
+
+private:
+  size_t _shed_from;
+  size_t _drop_from;
+  size_t _sample_every;
+  uint64_t _sampled = 0;
+  uint64_t _dropped = 0;
+  bool _enabled = true;
+};
+
+#endif
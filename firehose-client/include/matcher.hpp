@@ -21,9 +21,16 @@ http://www.fsf.org/licensing/licenses
 *************************************************************************/
 #include "common/helpers.hpp"
 #include "common/rest_utils.hpp"
-#include <aho_corasick/aho_corasick.hpp>
+#include "filter_automaton.hpp"
+#include "literal_prefilter.hpp"
+#include "text_skeleton.hpp"
+#include "verdict_cache.hpp"
+#include <atomic>
 #include <boost/beast/core.hpp>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -31,6 +38,9 @@ http://www.fsf.org/licensing/licenses
 #include <yaml-cpp/yaml.h>
 
 namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace prometheus {
+class Counter;
+}
 
 // filter match candidate
 struct candidate {
@@ -48,10 +58,19 @@ struct path_candidates {
 };
 typedef std::vector<path_candidates> path_candidate_list;
 
+class rule_set;
+// index of a rule in the rule_set it was matched against
+typedef uint32_t rule_id;
+
 // Stores context that matched one or more filters, and the matches
 struct match_result {
   candidate _candidate;
-  aho_corasick::wtrie::emit_collection _matches;
+  // one entry per filter match in the candidate
+  std::vector<rule_id> _matches;
+  // rules as they were when matched, a refresh does not change them
+  std::shared_ptr<const rule_set> _rules;
+  // matched filters, quoted, for logging
+  std::string filters() const;
 };
 typedef std::vector<match_result> match_results;
 // Path/cid->match-result association
@@ -84,7 +103,16 @@ public:
   inline bool is_ready() const { return _is_ready; }
   void set_config(const YAML::Node &filter_config);
   void load_filter_file(std::string const &filename);
+  // publishes the replacement's rules in place of ours
   void refresh_rules(matcher &&replacement);
+  // Rules then added are canonicalised as current's are, and those from DB
+  // fields that match a rule current published share it, with its canonical
+  // form, rather than being built again
+  void reuse_rules_from(matcher const &current);
+  inline size_t reused_rules() const { return _reused_rules; }
+  // Rules added since the last publish become visible to matching. Matching
+  // also publishes if needed, this just does it ahead of the first match.
+  void publish();
 
   bool matches_any(std::string const &candidate) const;
   bool matches_any(beast::flat_buffer const &beast_data) const;
@@ -162,7 +190,13 @@ public:
          std::string const &actions, std::string const &contingent,
          std::string const &categories, const int rule_id, const bool track,
          const bool label);
-    rule(rule const &);
+    rule(rule const &) = default;
+    rule(rule &&) = default;
+    // true if built from exactly these DB fields
+    bool has_source(std::string const &filter, std::string const &labels,
+                    std::string const &actions, std::string const &contingent,
+                    std::string const &categories, const int rule_id,
+                    const bool track, const bool label) const;
     inline std::string to_string() const {
       std::ostringstream oss;
       oss << "id=" << _id << '|' << "track=" << (_track ? 'y' : 'n') << '|'
@@ -185,25 +219,124 @@ public:
     int _id = -1;
 
     static constexpr size_t field_count = 7;
-    bool passes_contingent_checks(std::string const &candidate) const;
+    // filter|labels|actions|contingent in a filter file, contingent optional
+    static constexpr size_t file_field_count = 4;
+    // contingent strings in canonical form, at least one of _required and
+    // none of _absent must occur with the filter
+    inline std::vector<std::string> const &required() const {
+      return _required;
+    }
+    inline std::vector<std::string> const &absent() const { return _absent; }
 
   private:
     void store_actions(std::string_view actions);
-    mutable aho_corasick::wtrie _substring_trie;
-    mutable aho_corasick::wtrie _absent_substring_trie;
+    void store_contingent(std::string_view contingent);
+    std::vector<std::string> _required;
+    std::vector<std::string> _absent;
   };
 
-  rule find_rule(std::wstring const &key) const;
+  // rule for the filter, which need not be in canonical form
+  rule find_rule(std::string const &filter) const;
 
 private:
   bool insert_rule(rule &&new_rule);
-  rule find_rule_unchecked(std::wstring const &key) const;
+  bool insert_rule(std::string const &canonical_form,
+                   std::shared_ptr<const rule> new_rule);
+  // rules matched by the candidate, from the cache if it has them
+  std::vector<rule_id> verdict_for(rule_set const &rules,
+                                   candidate const &next) const;
+  // rules as published, publishing any that are staged first
+  std::shared_ptr<const rule_set> snapshot() const;
+  void publish_staged() const;
 
-  mutable std::mutex _lock;
-  bool _is_ready = false;
+  std::atomic<bool> _is_ready = false;
   bool _use_db_for_rules = false;
-  mutable aho_corasick::wtrie _substring_trie;
-  mutable aho_corasick::wtrie _whole_word_trie;
-  std::unordered_map<std::wstring, rule> _rule_lookup;
+  mutable std::atomic<std::shared_ptr<const rule_set>> _rules;
+  // rules added but not yet published, with a copy of the published ones
+  mutable std::mutex _staging_lock;
+  mutable std::unique_ptr<rule_set> _staged;
+  mutable std::atomic<bool> _has_staged = false;
+  // published rules of the matcher being replaced, see reuse_rules_from
+  std::shared_ptr<const rule_set> _reusable;
+  // last stage of canonical form for rule sets built here, if configured
+  std::shared_ptr<const text_skeleton> _skeleton;
+  std::atomic<size_t> _reused_rules = 0;
+  // verdicts for repeated candidates, if configured
+  std::unique_ptr<verdict_cache> _verdicts;
+  prometheus::Counter *_verdict_hits = nullptr;
+  prometheus::Counter *_verdict_misses = nullptr;
+  prometheus::Counter *_prefilter_rejects = nullptr;
+  prometheus::Counter *_prefilter_passes = nullptr;
+};
+
+// Automaton and the rules it maps to. A published rule_set is never
+// changed, matching reads it with no lock held while rule loads and
+// refreshes build a new one and swap it in. Rules are built once and shared
+// by every set that includes them. Filters and contingent strings of every
+// rule are in the one automaton, so a candidate is scanned once whatever
+// the rules.
+class rule_set {
+public:
+  // the skeleton, if any, applies to filters, contingent strings and text
+  explicit rule_set(std::shared_ptr<const text_skeleton> skeleton = nullptr)
+      : _skeleton(std::move(skeleton)) {}
+  inline bool contains(std::string const &canonical_form) const {
+    return _ids.contains(canonical_form);
+  }
+  void insert(std::string const &canonical_form,
+              std::shared_ptr<const matcher::rule> new_rule);
+  // build the automaton for rules inserted so far, matching a published set
+  // is then read-only. Each prepared set has a new generation.
+  void prepare();
+  inline uint64_t generation() const { return _generation; }
+
+  // Candidate text as matched: non-ASCII case-folded, then through the
+  // skeleton if the set has one. May be in either buffer.
+  std::string_view matchable(std::string_view text, std::string &folded,
+                             std::string &mapped) const;
+  // Rules whose filter occurs in the text and whose contingent checks pass,
+  // one entry per filter occurrence. Text is as from matchable.
+  std::vector<rule_id> match(std::string_view text) const;
+  // substring filters only
+  bool matches_substring(std::string_view text) const;
+  // false if the raw text cannot match any rule, see literal_prefilter. Raw
+  // text says nothing once it goes through a skeleton.
+  inline bool may_match(std::string_view text) const {
+    return _skeleton || _prefilter.may_match(text);
+  }
+  // throws if no rule has this filter
+  rule_id id_of(std::string const &canonical_form) const;
+  // rule whose filter was given exactly so, before canonical form
+  inline std::optional<rule_id> find_target(std::string const &target) const {
+    auto found(_targets.find(target));
+    if (found == _targets.cend())
+      return std::nullopt;
+    return found->second;
+  }
+  inline matcher::rule const &rule(const rule_id id) const {
+    return *_entries[id]._rule;
+  }
+  inline std::shared_ptr<const matcher::rule> const &
+  shared_rule(const rule_id id) const {
+    return _entries[id]._rule;
+  }
+  // canonical filter, as used in metric labels
+  inline std::string const &filter(const rule_id id) const {
+    return _entries[id]._filter;
+  }
+
+private:
+  struct entry {
+    std::shared_ptr<const matcher::rule> _rule;
+    std::string _filter;
+  };
+  std::vector<entry> _entries;
+  std::unordered_map<std::string, rule_id> _ids;
+  // by filter as given
+  std::unordered_map<std::string, rule_id> _targets;
+  filter_automaton _automaton;
+  literal_prefilter _prefilter;
+  std::shared_ptr<const text_skeleton> _skeleton;
+  uint64_t _generation = 0;
 };
 #endif
\ No newline at end of file
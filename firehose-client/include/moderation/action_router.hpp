@@ -22,8 +22,8 @@ http://www.fsf.org/licensing/licenses
 #include <thread>
 #include <unordered_set>
 
-#include "blockingconcurrentqueue.h"
 #include "common/helpers.hpp"
+#include "common/stage_queue.hpp"
 #include "matcher.hpp"
 #include "yaml-cpp/yaml.h"
 
@@ -42,7 +42,7 @@ class action_router {
 
   std::thread _thread;
   // Declare queue between match post-processing and HTTP Client
-  moodycamel::BlockingConcurrentQueue<account_filter_matches> _queue;
+  stage_queue<account_filter_matches> _queue;
   std::shared_ptr<matcher> _matcher;
 };
 #endif
\ No newline at end of file
@@ -84,6 +84,8 @@ private:
   bsky::time_stamp _last_rewind_checkpoint;
   std::chrono::steady_clock::time_point _last_rewind_flush;
   std::chrono::steady_clock::time_point _last_match_filter_refresh;
+  // md5 of the match_filters rows last loaded
+  std::string _match_filters_checksum;
   std::chrono::steady_clock::time_point _last_popular_host_refresh;
   std::chrono::steady_clock::time_point _last_blacklisted_accounts_refresh;
   std::chrono::steady_clock::time_point _last_whitelisted_accounts_refresh;
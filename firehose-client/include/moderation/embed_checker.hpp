@@ -19,8 +19,9 @@ A copy of the GNU General Public License is available at
 http://www.fsf.org/licensing/licenses
 >>> END OF LICENSE >>>
 *************************************************************************/
-#include "blockingconcurrentqueue.h"
+#include "cid.hpp"
 #include "common/helpers.hpp"
+#include "common/stage_queue.hpp"
 #include "jwt-cpp/jwt.h"
 #include "matcher.hpp"
 #include "project_defs.hpp"
@@ -39,20 +40,20 @@ struct external {
   std::string _uri;
 };
 struct image {
-  nlohmann::json _cid;
+  atproto::cid _cid;
 };
 struct record {
   std::string _uri;
 };
 struct video {
-  nlohmann::json _cid;
+  atproto::cid _cid;
 };
 typedef std::variant<external, image, record, video> embed_info;
 
 struct embed_info_list {
   std::string _did;
   std::string _path;
-  std::string _cid;
+  atproto::cid _cid;
   std::vector<embed_info> _embeds;
 };
 
@@ -68,9 +69,9 @@ public:
   inline embed_handler(embed_checker &checker,
                        restc_cpp::RestClient &rest_client,
                        std::string const &repo, std::string const &path,
-                       std::string const &cid)
+                       atproto::cid const &cid)
       : _checker(checker), _rest_client(rest_client), _repo(repo), _path(path),
-        _cid(cid) {
+        _cid(cid.empty() ? std::string() : cid.to_string()) {
     if (_repo.empty() || _path.empty() || _cid.empty()) {
       std::ostringstream oss;
       oss << "embed_handler requires repo (" << _repo << "), path (" << _path
@@ -125,7 +126,7 @@ public:
   void wait_enqueue(embed::embed_info_list &&value);
   void refresh_hosts(std::unordered_set<std::string> &&new_hosts);
   void image_seen(std::string const &repo, std::string const &path,
-                  std::string const &cid);
+                  atproto::cid const &cid);
   void record_seen(std::string const &repo, std::string const &path,
                    std::string const &uri);
   bool should_process_uri(std::string const &uri);
@@ -133,7 +134,7 @@ public:
   bool uri_seen(std::string const &repo, std::string const &path,
                 std::string const &uri);
   void video_seen(std::string const &repo, std::string const &path,
-                  std::string const &cid);
+                  atproto::cid const &cid);
   inline bool follow_links() const { return _follow_links; }
 
 private:
@@ -145,13 +146,13 @@ private:
   std::vector<std::thread> _threads;
   std::mutex _lock;
   // Declare queue between match post-processing and HTTP Client
-  moodycamel::BlockingConcurrentQueue<embed::embed_info_list> _queue;
+  stage_queue<embed::embed_info_list> _queue;
   bool _follow_links = false;
   size_t _number_of_threads = DefaultNumberOfThreads;
-  std::unordered_map<std::string, size_t> _checked_images;
+  std::unordered_map<atproto::cid, size_t, atproto::cid_hash> _checked_images;
   std::unordered_map<std::string, size_t> _checked_records;
   std::unordered_map<std::string, size_t> _checked_uris;
-  std::unordered_map<std::string, size_t> _checked_videos;
+  std::unordered_map<atproto::cid, size_t, atproto::cid_hash> _checked_videos;
   std::unordered_set<std::string> _popular_hosts;
 
   // LFU cache of recently-active accounts
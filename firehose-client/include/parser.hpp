@@ -20,14 +20,16 @@ http://www.fsf.org/licensing/licenses
 >>> END OF LICENSE >>>
 *************************************************************************/
 
+#include "cid.hpp"
 #include "common/config.hpp"
 #include "common/helpers.hpp"
 #include "common/log_wrapper.hpp"
+#include "dag_cbor.hpp"
+#include "json_scan.hpp"
 #include "matcher.hpp"
 #include "nlohmann/json.hpp"
 #include <algorithm>
 #include <boost/beast/core.hpp>
-#include <multiformats/cid.hpp>
 #include <string_view>
 #include <tuple>
 #include <unordered_set>
@@ -48,8 +50,14 @@ public:
   candidate_list
   get_candidates_from_flat_buffer(beast::flat_buffer const &beast_data);
   candidate_list get_candidates_from_json(nlohmann::json &full_json) const;
+  // Jetstream event read on demand, only the fields that are matched
+  static candidate_list get_candidates_from_jetstream(std::string_view event);
   static candidate_list
   get_candidates_from_record(nlohmann::json const &record);
+  static candidate_list
+  get_candidates_from_record(dag_cbor::value const &record);
+  static candidate_list
+  get_candidates_from_record(json_scan::value const &record);
 
   template <typename IteratorType>
   bool json_from_cbor(IteratorType first, IteratorType last) {
@@ -141,7 +149,7 @@ public:
       return false;
     }
 
-    // decode CID
+    // decode CID, passed to the callback in binary form
     bool parse_car_cid(const bool get_char = true) {
       uint64_t version(read_u64_leb128(get_char));
       uint64_t codec(read_u64_leb128());
@@ -149,24 +157,29 @@ public:
       if (version == 0x12 && codec == 0x20) {
         // handle v0 CID - digest is always 32 bytes
         digest_length = 32;
-        version = 0;
       } else {
         // arcane knowledge - DAG-PB wrapper on the 32-byte digest
         digest_length = 34;
       }
-      std::vector<uint8_t> digest(digest_length);
-      for (auto next = digest.begin(); next != digest.end(); ++next) {
-        *next = static_cast<uint8_t>(this->get());
+      std::vector<uint8_t> binary;
+      binary.reserve(atproto::cid::MaxSize);
+      append_leb128(binary, version);
+      append_leb128(binary, codec);
+      for (uint64_t count = 0; count < digest_length; ++count) {
+        binary.push_back(static_cast<uint8_t>(this->get()));
       }
-      // Caller needs to process according to context
-      Multiformats::Cid cid({version}, {codec},
-                            {digest.cbegin(), digest.cend()});
       nlohmann::json result(
-          {{"__readable_cid__",
-            cid.to_string(Multiformats::Multibase::Protocol::Base32)}});
+          {{"__binary_cid__", nlohmann::json::binary_t(std::move(binary))}});
       return _callback(0, nlohmann::detail::parse_event_t::result, result);
     }
 
+    static void append_leb128(std::vector<uint8_t> &output, uint64_t value) {
+      for (; value >= 0x80; value >>= 7) {
+        output.push_back(static_cast<uint8_t>(value | 0x80));
+      }
+      output.push_back(static_cast<uint8_t>(value));
+    }
+
     bool parse_car_block(const bool get_char) {
       read_u64_leb128(get_char); // skip block length
       if (!parse_car_cid())
@@ -270,7 +283,7 @@ public:
   static void set_config(std::shared_ptr<config> &settings);
 
   // CAR file in "blocks" contains atproto content indexed by CIDs
-  typedef std::vector<std::pair<std::string, nlohmann::json>> indexed_cbors;
+  typedef std::vector<std::pair<atproto::cid, nlohmann::json>> indexed_cbors;
   const indexed_cbors &other_cbors() const { return _other_cbors; }
   const indexed_cbors &content_cbors() const { return _content_cbors; }
   const indexed_cbors &matchable_cbors() const { return _matchable_cbors; }
@@ -278,15 +291,15 @@ public:
   std::string dump_parse_matched() const;
   std::string dump_parse_other() const;
 
-  inline std::string block_cid() const { return _block_cid; }
+  inline atproto::cid const &block_cid() const { return _block_cid; }
 
 private:
   bool cbor_callback(int depth, nlohmann::json::parse_event_t event,
                      nlohmann::json &parsed);
 
   // CAR file in "blocks" contains atproto content indexed by CIDs
-  std::string _block_cid;
-  std::unordered_set<std::string> _cids;
+  atproto::cid _block_cid;
+  std::unordered_set<atproto::cid, atproto::cid_hash> _cids;
   indexed_cbors _other_cbors;
   indexed_cbors _content_cbors;
   indexed_cbors _matchable_cbors;
@@ -20,49 +20,67 @@ http://www.fsf.org/licensing/licenses
 >>> END OF LICENSE >>>
 *************************************************************************/
 
+#include "buffer_pool.hpp"
+#include "cid.hpp"
 #include "common/activity/event_recorder.hpp"
 #include "common/helpers.hpp"
+#include "dag_cbor.hpp"
+#include "load_shedder.hpp"
 #include "matcher.hpp"
 #include "parser.hpp"
 #include "post_processor.hpp"
-#include <unordered_map>
+#include <boost/beast/core.hpp>
+#include <vector>
 
 class jetstream_payload {
 public:
   jetstream_payload();
-  jetstream_payload(std::string json_msg, match_results matches);
+  jetstream_payload(pooled_buffer &&frame, match_results &&matches);
   void handle(post_processor<jetstream_payload> &processor);
-  inline std::string to_string() const { return _json_msg; }
+  inline std::string to_string() const { return std::string(_frame.text()); }
+  // relay cursor for a raw frame, -1 if it has none
+  static int64_t sequence_of(std::span<const uint8_t> frame);
+  // identifies an event across relays, 0 for one that cannot be told apart
+  static uint64_t event_key_of(std::span<const uint8_t> frame);
+  // cheap classification of a raw frame for load shedding
+  static frame_value value_of(std::span<const uint8_t> frame);
 
 private:
-  std::string _json_msg;
+  pooled_buffer _frame;
   match_results _matches;
 };
 class firehose_payload {
 public:
   firehose_payload();
-  firehose_payload(parser &my_parser);
+  // seq of a frame that tracks_cursor is saved as the rewind point
+  firehose_payload(pooled_buffer &&frame, const bool tracks_cursor = true);
+  // Decode the frame and run matching. Safe to run in parallel with other
+  // payloads, results are held until handle() is called.
+  void decode();
+  // Apply results in message order: recordings, handle updates, matches and
+  // rewind point. Decodes first if that was not already done.
   void handle(post_processor<firehose_payload> &processor);
-  inline std::string to_string() const {
-    auto const &header(_parser.other_cbors().front().second);
-    auto const &message(_parser.other_cbors().back().second);
-    std::ostringstream oss;
-    oss << "header (" << dump_json(header) << ") message ("
-        << dump_json(message) << ')';
-    return oss.str();
-  }
+  std::string to_string() const;
+  // relay cursor for a raw frame, -1 if it has none
+  static int64_t sequence_of(std::span<const uint8_t> frame);
+  // identifies an event across relays, 0 for one that cannot be told apart
+  static uint64_t event_key_of(std::span<const uint8_t> frame);
+  // cheap classification of a raw frame for load shedding
+  static frame_value value_of(std::span<const uint8_t> frame);
+  // save a raw frame's seq as the rewind point without handling the frame
+  static void save_rewind_point(const int64_t seq,
+                                std::span<const uint8_t> frame);
 
 private:
   struct context {
-    inline context(post_processor<firehose_payload> &processor,
-                   nlohmann::json const &content)
-        : _processor(processor), _content(content) {}
+    inline context(firehose_payload &payload, dag_cbor::value const &content)
+        : _payload(payload), _content(content) {}
     std::string _repo;
     std::string _this_path;
     std::string _embed_type_str;
     bsky::tracked_event _event_type = bsky::tracked_event::invalid;
     bool _recorded = false;
-    bsky::embed_type process_embed(nlohmann::json const &content);
+    bsky::embed_type process_embed(dag_cbor::value const &content);
 
     void add_embed(embed::embed_info &&new_embed) {
       _embeds.emplace_back(std::move(new_embed));
@@ -70,20 +88,40 @@ private:
     auto const &get_embeds() const { return _embeds; }
 
   private:
-    post_processor<firehose_payload> &_processor;
-    nlohmann::json const &_content;
+    firehose_payload &_payload;
+    dag_cbor::value const &_content;
     std::vector<embed::embed_info> _embeds;
   };
-  void handle_content(post_processor<firehose_payload> &processor,
-                      std::string const &repo, std::string const &cid,
-                      nlohmann::json const &content);
-  void handle_matchable_content(post_processor<firehose_payload> &processor,
-                                std::string const &repo, std::string const &cid,
-                                nlohmann::json const &content);
+  void handle_content(std::string const &repo, std::string const &path,
+                      atproto::cid const &cid, dag_cbor::value const &content);
+  // social graph records, only subject and creation time are decoded
+  void handle_subject(std::string const &repo, std::string const &path,
+                      const bsky::tracked_event event_type,
+                      dag_cbor::value const &content);
+  void handle_matchable_content(std::string const &repo,
+                                std::string const &path,
+                                atproto::cid const &cid,
+                                dag_cbor::value const &content);
+  inline void record(activity::timed_event &&event) {
+    _recordings.emplace_back(std::move(event));
+  }
 
-  parser _parser;
+  // raw frame, all decoded views refer into this
+  pooled_buffer _frame;
+  bool _tracks_cursor = true;
+  bool _decoded = false;
   path_candidate_list _path_candidates;
-  std::unordered_map<std::string, std::string> _path_by_cid;
+
+  // decode results, applied by handle()
+  std::string _op_type;
+  std::string _repo;
+  std::string _handle;
+  int64_t _seq = -1;
+  std::string _emitted_at;
+  std::vector<activity::timed_event> _recordings;
+  std::vector<embed::embed_info_list> _embed_checks;
+  path_match_results _matches;
+  std::string _match_context;
 };
 
 #endif
\ No newline at end of file
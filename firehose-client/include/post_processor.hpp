@@ -25,10 +25,11 @@ http://www.fsf.org/licensing/licenses
 #include "common/helpers.hpp"
 #include "common/log_wrapper.hpp"
 #include "common/metrics_factory.hpp"
+#include "common/stage_queue.hpp"
+#include "dag_cbor.hpp"
 #include "matcher.hpp"
 #include "moderation/embed_checker.hpp"
 #include "parser.hpp"
-#include "readerwriterqueue.h"
 #include <nlohmann/detail/exceptions.hpp>
 #include <prometheus/counter.h>
 #include <prometheus/gauge.h>
@@ -60,7 +61,7 @@ constexpr std::string_view OpTypeInfo = "#info";
 constexpr std::string_view OpTypeMigrate = "#migrate";
 constexpr std::string_view OpTypeTombstone = "#tombstone";
 
-inline op_type op_type_from_string(std::string const &op_type_str) {
+inline op_type op_type_from_string(std::string_view op_type_str) {
   if (op_type_str == OpTypeAccount) {
     return op_type::account;
   } else if (op_type_str == OpTypeCommit) {
@@ -85,7 +86,7 @@ constexpr std::string_view OpKindCreate = "create";
 constexpr std::string_view OpKindDelete = "delete";
 constexpr std::string_view OpKindUpdate = "update";
 
-inline op_kind op_kind_from_string(std::string const &op_kind_str) {
+inline op_kind op_kind_from_string(std::string_view op_kind_str) {
   if (op_kind_str == OpKindCreate) {
     return op_kind::create;
   } else if (op_kind_str == OpKindDelete) {
@@ -96,28 +97,54 @@ inline op_kind op_kind_from_string(std::string const &op_kind_str) {
   return op_kind::invalid;
 }
 
+// How much of a commit's record block to decode, by collection. Records in
+// collections we do not track are never decoded, and high-volume social
+// graph records only need their subject and creation time.
+enum class field_plan { none, subject, full };
+
+inline field_plan field_plan_for_collection(std::string_view collection) {
+  if (collection == bsky::AppBskyFeedLike ||
+      collection == bsky::AppBskyGraphFollow ||
+      collection == bsky::AppBskyFeedRepost ||
+      collection == bsky::AppBskyGraphBlock) {
+    return field_plan::subject;
+  }
+  if (collection == bsky::AppBskyFeedPost ||
+      collection == bsky::AppBskyActorProfile ||
+      json::TargetFieldNames.contains(collection)) {
+    return field_plan::full;
+  }
+  return field_plan::none;
+}
+
+// Records that only feed statistics, which may be shed under load. Blocks
+// are not: blocking the labeler raises an account report.
+inline bool is_statistics_only(std::string_view collection) {
+  return collection == bsky::AppBskyFeedLike ||
+         collection == bsky::AppBskyGraphFollow ||
+         collection == bsky::AppBskyFeedRepost;
+}
+
 } // namespace firehose
 
 template <typename T> class post_processor {
 public:
   static constexpr size_t QueueLimit = 10000;
 
-  post_processor() : _queue(QueueLimit) {
+  post_processor() : _queue(QueueLimit, {{"message", "backlog"}}) {
     _thread = std::thread([&, this] {
       try {
         while ((controller::instance().is_active())) {
           T my_payload;
           try {
             _queue.wait_dequeue(my_payload);
-            metrics_factory::instance()
-                .get_gauge("process_operation")
-                .Get({{"message", "backlog"}})
-                .Decrement();
-
             my_payload.handle(*this);
           } catch (nlohmann::detail::exception const &exc) {
             REL_ERROR("post_processor JSON error {} on payload {}", exc.what(),
                       my_payload.to_string());
+          } catch (dag_cbor::decode_error const &exc) {
+            REL_ERROR("post_processor CBOR error {} on payload {}", exc.what(),
+                      my_payload.to_string());
           }
         }
       } catch (std::exception const &exc) {
@@ -128,20 +155,18 @@ public:
     });
   }
   ~post_processor() = default;
-  void wait_enqueue(T &&value) {
-    _queue.enqueue(value);
-    metrics_factory::instance()
-        .get_gauge("process_operation")
-        .Get({{"message", "backlog"}})
-        .Increment();
-  }
+  void wait_enqueue(T &&value) { _queue.enqueue(std::move(value)); }
+  inline size_t backlog() const { return _queue.size_approx(); }
   inline void request_recording(activity::timed_event &&event) {
     activity::event_recorder::instance().wait_enqueue(std::move(event));
   }
+  inline void request_recordings(std::span<activity::timed_event> events) {
+    activity::event_recorder::instance().wait_enqueue_bulk(events);
+  }
 
 private:
   // Declare queue between websocket and match post-processing
-  moodycamel::BlockingReaderWriterQueue<T> _queue;
+  stage_queue<T, moodycamel::BlockingReaderWriterQueue<T>> _queue;
   std::thread _thread;
 };
 
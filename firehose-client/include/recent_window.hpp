@@ -0,0 +1,107 @@
+#ifndef __recent_window_hpp__
+#define __recent_window_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Recently seen event keys in fixed memory, for dropping the copy of an
+// event that a second relay delivers. Each key keeps its first arrival time
+// and source. Two open-addressed tables alternate:
+// inserts go to the current one, and once it holds `window` keys the older
+// table is cleared and becomes current. Lookups check both, so at least the
+// last `window` keys and at most twice that are remembered.
+class recent_window {
+public:
+  static constexpr size_t DefaultWindow = 65536;
+
+  explicit recent_window(const size_t window = DefaultWindow)
+      : _window(std::max<size_t>(window, 16)),
+        _mask(std::bit_ceil(2 * _window) - 1),
+        _tables{std::vector<slot>(_mask + 1), std::vector<slot>(_mask + 1)} {}
+
+  // 64-bit FNV-1a of the fields, for example event type, repo and rev.
+  // Never 0.
+  static uint64_t key_of(std::initializer_list<std::string_view> fields) {
+    uint64_t hash(0xcbf29ce484222325ULL);
+    for (std::string_view field : fields) {
+      for (char next : field) {
+        hash = (hash ^ static_cast<uint8_t>(next)) * 0x100000001b3ULL;
+      }
+      // a separator no UTF-8 text contains
+      hash = (hash ^ 0xff) * 0x100000001b3ULL;
+    }
+    return hash == 0 ? 1 : hash;
+  }
+
+  struct arrival {
+    int64_t _arrived = 0;
+    uint32_t _source = 0;
+  };
+
+  // Records a new key and returns nullopt, or returns the key's first arrival
+  std::optional<arrival> insert(const uint64_t key, const int64_t arrived,
+                                const uint32_t source) {
+    for (auto const &table : _tables) {
+      slot const &found(table[probe(table, key)]);
+      if (found._key == key)
+        return found._first;
+    }
+    if (_count == _window) {
+      _current ^= 1;
+      std::ranges::fill(_tables[_current], slot());
+      _count = 0;
+    }
+    auto &table(_tables[_current]);
+    table[probe(table, key)] = {key, {arrived, source}};
+    ++_count;
+    return std::nullopt;
+  }
+
+private:
+  struct slot {
+    uint64_t _key = 0;
+    arrival _first;
+  };
+
+  // index of key, or of the empty slot where it belongs. Tables are at most
+  // half full so the probe ends.
+  size_t probe(std::vector<slot> const &table, const uint64_t key) const {
+    size_t index(key & _mask);
+    while (table[index]._key != 0 && table[index]._key != key) {
+      index = (index + 1) & _mask;
+    }
+    return index;
+  }
+
+  size_t _window;
+  size_t _mask;
+  std::vector<slot> _tables[2];
+  size_t _current = 0;
+  size_t _count = 0;
+};
+
+#endif
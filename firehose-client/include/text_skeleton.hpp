@@ -0,0 +1,79 @@
+#ifndef __text_skeleton_hpp__
+#define __text_skeleton_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Optional last stage of canonical form, so that one filter catches its
+// look-alike spellings. Text as from fold_non_ascii maps code point by code
+// point, with ASCII upper case as its lower case. Zero-width and other
+// default-ignorable characters are dropped, configured folds such as digits
+// used for letters map to their letters, and confusables map to their
+// prototype from ICU's confusables data (UTS #39 skeleton). Mappings are
+// worked out once into flat tables, so the stage is one pass with a table
+// lookup per code point. Rules and candidates both go through it.
+class text_skeleton {
+public:
+  // folds: single character in case-folded form to the text it stands for,
+  // for example "4" to "a". Throws std::invalid_argument for a fold that is
+  // not a single character, std::runtime_error if ICU fails.
+  text_skeleton(const bool confusables,
+                std::map<std::string, std::string> const &folds);
+
+  // The input itself if nothing in it maps, else the mapped text in scratch
+  std::string_view apply(std::string_view text, std::string &scratch) const;
+  // code points with a mapping
+  inline size_t size() const { return _mapped; }
+
+private:
+  static constexpr uint32_t NotMapped = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t BlockBits = 8;
+  static constexpr size_t BlockSize = size_t(1) << BlockBits;
+  static constexpr uint32_t CodePoints = 0x110000;
+
+  // replacement in _replacements, _length NotMapped for none
+  struct mapping {
+    uint32_t _offset = 0;
+    uint32_t _length = NotMapped;
+  };
+  typedef std::array<mapping, BlockSize> block;
+
+  inline mapping const &lookup(const uint32_t code_point) const {
+    return _blocks[_pages[code_point >> BlockBits]][code_point &
+                                                    (BlockSize - 1)];
+  }
+  void set(const uint32_t code_point, std::string_view replacement);
+
+  // block for each run of BlockSize code points, block 0 maps nothing and
+  // is shared by every run without a mapping
+  std::vector<uint16_t> _pages;
+  std::vector<block> _blocks;
+  std::string _replacements;
+  size_t _mapped = 0;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef __verdict_cache_hpp__
+#define __verdict_cache_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Match verdicts for recently seen candidates, so that the copies of a spam
+// wave's post text, link URL or handle skip folding and the automaton. Slots
+// are direct-mapped by key, in shards with a lock each: memory is fixed and
+// a new verdict replaces whatever held its slot. A verdict belongs to one
+// generation of published rules and is a miss for any other, so publishing
+// rules invalidates the whole cache at once. Verdicts are held inline, so a
+// hit does not allocate; one with more than MaxRules ids is not cached.
+class verdict_cache {
+public:
+  static constexpr size_t DefaultCapacity = 65536;
+  // keeps a slot within a cache line
+  static constexpr size_t MaxRules = 7;
+  // rule ids, empty for no match
+  struct verdict {
+    typedef uint32_t value_type;
+    typedef uint32_t const *const_iterator;
+    inline const_iterator begin() const { return _ids.data(); }
+    inline const_iterator end() const { return _ids.data() + _count; }
+    inline size_t size() const { return _count; }
+    inline bool empty() const { return _count == 0; }
+
+    uint32_t _count = 0;
+    std::array<uint32_t, MaxRules> _ids;
+  };
+
+  explicit verdict_cache(const size_t capacity = DefaultCapacity)
+      : _mask(std::bit_ceil(std::max(capacity, ShardCount)) / ShardCount - 1),
+        _shards(std::make_unique<shard[]>(ShardCount)) {
+    for (size_t index = 0; index < ShardCount; ++index) {
+      _shards[index]._slots.resize(_mask + 1);
+    }
+  }
+
+  // 64-bit hash of the candidate's type, field and raw text
+  static uint64_t key_of(std::string_view type, std::string_view field,
+                         std::string_view text) {
+    std::hash<std::string_view> hasher;
+    uint64_t key(hasher(text));
+    key = (key ^ hasher(type)) * 0x9e3779b97f4a7c15ULL;
+    key = (key ^ hasher(field)) * 0xff51afd7ed558ccdULL;
+    return key ^ (key >> 32);
+  }
+
+  // true, with the verdict, if the key has one for this generation
+  bool find(const uint64_t key, const uint64_t generation,
+            verdict &found) const {
+    shard &owner(shard_of(key));
+    std::lock_guard lock(owner._lock);
+    slot const &held(owner._slots[index_of(key)]);
+    if (held._generation != generation || held._key != key)
+      return false;
+    found = held._verdict;
+    return true;
+  }
+
+  // false if the verdict has too many ids to cache
+  bool store(const uint64_t key, const uint64_t generation,
+             std::vector<uint32_t> const &result) {
+    if (result.size() > MaxRules)
+      return false;
+    shard &owner(shard_of(key));
+    std::lock_guard lock(owner._lock);
+    slot &held(owner._slots[index_of(key)]);
+    held._key = key;
+    held._generation = generation;
+    held._verdict._count = static_cast<uint32_t>(result.size());
+    std::copy(result.cbegin(), result.cend(), held._verdict._ids.begin());
+    return true;
+  }
+
+  inline size_t capacity() const { return (_mask + 1) * ShardCount; }
+
+private:
+  static constexpr size_t ShardBits = 6;
+  static constexpr size_t ShardCount = size_t(1) << ShardBits;
+
+  struct slot {
+    uint64_t _key = 0;
+    // generations start at 1, so an empty slot never matches
+    uint64_t _generation = 0;
+    verdict _verdict;
+  };
+  // a cache line each so shard locks do not contend through false sharing
+  struct alignas(64) shard {
+    std::mutex _lock;
+    std::vector<slot> _slots;
+  };
+
+  inline shard &shard_of(const uint64_t key) const {
+    return _shards[key & (ShardCount - 1)];
+  }
+  inline size_t index_of(const uint64_t key) const {
+    return (key >> ShardBits) & _mask;
+  }
+
+  size_t _mask;
+  std::unique_ptr<shard[]> _shards;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef __zstd_decompressor_hpp__
+#define __zstd_decompressor_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "buffer_pool.hpp"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <zstd.h>
+
+// Decompresses Jetstream's zstd frames. The relay compresses with a
+// published dictionary, which is loaded once into a ZSTD_DDict and shared by
+// every connection, and output goes to a receive buffer from the pool. One
+// instance per connection, it is not thread-safe.
+class zstd_decompressor {
+public:
+  // well above any Jetstream event, a frame claiming more is not trusted
+  static constexpr size_t DefaultMaxFrameSize = 4 * 1024 * 1024;
+
+  typedef std::shared_ptr<const ZSTD_DDict> dictionary;
+
+  // dictionary as published with Jetstream, raw content dictionaries work too
+  static dictionary load_dictionary(std::string const &dictionary_file);
+
+  explicit zstd_decompressor(
+      dictionary shared_dictionary,
+      const size_t max_frame_size = DefaultMaxFrameSize);
+  explicit zstd_decompressor(
+      std::string const &dictionary_file,
+      const size_t max_frame_size = DefaultMaxFrameSize)
+      : zstd_decompressor(load_dictionary(dictionary_file), max_frame_size) {}
+  ~zstd_decompressor() = default;
+  zstd_decompressor(zstd_decompressor const &) = delete;
+  zstd_decompressor &operator=(zstd_decompressor const &) = delete;
+
+  // throws std::runtime_error if the frame is not valid for the dictionary or
+  // decompresses to more than the maximum frame size
+  pooled_buffer decompress(std::span<const uint8_t> compressed);
+
+private:
+  struct free_context {
+    void operator()(ZSTD_DCtx *context) const { ZSTD_freeDCtx(context); }
+  };
+
+  dictionary _dictionary;
+  std::unique_ptr<ZSTD_DCtx, free_context> _context;
+  size_t _max_frame_size;
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+#include "buffer_pool.hpp"
+#include "common/log_wrapper.hpp"
+#include "common/metrics_factory.hpp"
+#include <algorithm>
+#include <bit>
+
+void pooled_buffer::reset() {
+  if (_buffer) {
+    receive_buffer_pool::instance().release(std::move(_buffer));
+  }
+}
+
+receive_buffer_pool &receive_buffer_pool::instance() {
+  static receive_buffer_pool my_instance;
+  return my_instance;
+}
+
+void receive_buffer_pool::set_config(YAML::Node const &settings) {
+  std::lock_guard guard(_lock);
+  _idle_limit = settings["idle_receive_buffers"].as<size_t>(DefaultIdleLimit);
+  _idle.reserve(_idle_limit);
+  REL_INFO("Receive buffer pool idle limit {}", _idle_limit);
+}
+
+void receive_buffer_pool::start() {
+  std::lock_guard guard(_lock);
+  auto &buffers(metrics_factory::instance().get_counter("receive_buffers"));
+  _hits = &buffers.Get({{"pool", "hit"}});
+  _misses = &buffers.Get({{"pool", "miss"}});
+  _held = &metrics_factory::instance()
+               .get_gauge("receive_buffers_held")
+               .Get({{"pool", "bytes"}});
+}
+
+pooled_buffer receive_buffer_pool::acquire() {
+  std::unique_lock guard(_lock);
+  if (!_idle.empty()) {
+    std::unique_ptr<beast::flat_buffer> buffer(std::move(_idle.back()));
+    _idle.pop_back();
+    _bytes_held -= buffer->capacity();
+    if (_hits) {
+      _hits->Increment();
+      _held->Set(static_cast<double>(_bytes_held));
+    }
+    return pooled_buffer(std::move(buffer));
+  }
+  size_t reserve(_reserve);
+  if (_misses) {
+    _misses->Increment();
+  }
+  guard.unlock();
+  auto buffer(std::make_unique<beast::flat_buffer>());
+  buffer->reserve(reserve);
+  return pooled_buffer(std::move(buffer));
+}
+
+void receive_buffer_pool::release(
+    std::unique_ptr<beast::flat_buffer> &&buffer) {
+  std::unique_ptr<beast::flat_buffer> discard;
+  {
+    std::lock_guard guard(_lock);
+    observe(buffer->size());
+    // flat_buffer keeps its storage when cleared
+    buffer->clear();
+    if (_idle.size() < _idle_limit && buffer->capacity() <= _retain_limit) {
+      _bytes_held += buffer->capacity();
+      _idle.emplace_back(std::move(buffer));
+      if (_held) {
+        _held->Set(static_cast<double>(_bytes_held));
+      }
+    } else {
+      discard = std::move(buffer);
+    }
+  }
+  // storage, if any, freed outside the lock
+}
+
+void receive_buffer_pool::observe(const size_t frame_size) {
+  ++_size_counts[std::min<size_t>(std::bit_width(frame_size),
+                                  _size_counts.size() - 1)];
+  if (++_observed < SampleWindow)
+    return;
+  uint64_t total(0);
+  for (auto count : _size_counts) {
+    total += count;
+  }
+  uint64_t cumulative(0);
+  bool have_p99(false);
+  for (size_t bucket = 0; bucket < _size_counts.size(); ++bucket) {
+    cumulative += _size_counts[bucket];
+    if (!have_p99 && cumulative * 100 >= total * 99) {
+      _reserve = size_t(1) << bucket;
+      have_p99 = true;
+    }
+    if (cumulative * 1000 >= total * 999) {
+      // flat_buffer may grow to twice the frame it had to fit
+      _retain_limit = size_t(2) << bucket;
+      break;
+    }
+  }
+  // halve the history so the percentiles follow changes in traffic
+  for (auto &count : _size_counts) {
+    count /= 2;
+  }
+  _observed = 0;
+}
@@ -0,0 +1,240 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+#include "capture_log.hpp"
+#include "common/log_wrapper.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace bip = boost::interprocess;
+
+namespace {
+constexpr std::string_view SegmentExtension = ".seg";
+constexpr std::string_view IndexExtension = ".idx";
+constexpr size_t RecordHeaderBytes =
+    sizeof(uint32_t) + sizeof(int64_t) + sizeof(int64_t);
+// zero length that terminates a segment
+constexpr size_t EndMarkerBytes = sizeof(uint32_t);
+
+std::filesystem::path segment_path(std::filesystem::path const &directory,
+                                   const uint64_t segment_number) {
+  return directory / std::format("{:010}{}", segment_number, SegmentExtension);
+}
+
+// segments in write order, file names sort by segment number
+std::vector<std::filesystem::path>
+list_segments(std::filesystem::path const &directory) {
+  std::vector<std::filesystem::path> segments;
+  if (std::filesystem::is_directory(directory)) {
+    for (auto const &entry : std::filesystem::directory_iterator(directory)) {
+      if (entry.is_regular_file() &&
+          entry.path().extension() == SegmentExtension) {
+        segments.push_back(entry.path());
+      }
+    }
+  }
+  std::ranges::sort(segments);
+  return segments;
+}
+} // namespace
+
+capture_writer::capture_writer(std::filesystem::path const &directory,
+                               const size_t segment_bytes)
+    : _directory(directory), _segment_bytes(segment_bytes) {
+  std::filesystem::create_directories(_directory);
+  // never append to an earlier run's segments
+  auto existing(list_segments(_directory));
+  if (!existing.empty()) {
+    _segment_number = std::stoull(existing.back().stem().string()) + 1;
+  }
+  REL_INFO("Capturing frames to {} from segment {}", _directory.string(),
+           _segment_number);
+}
+
+capture_writer::~capture_writer() {
+  try {
+    close_segment();
+  } catch (std::exception const &exc) {
+    REL_ERROR("capture_writer close error {}", exc.what());
+  }
+}
+
+void capture_writer::append(const int64_t seq,
+                            std::span<const uint8_t> frame) {
+  const size_t needed(RecordHeaderBytes + frame.size() + EndMarkerBytes);
+  if (!_region || _offset + needed > _region->get_size()) {
+    close_segment();
+    open_segment(needed);
+  }
+  const uint32_t length(static_cast<uint32_t>(frame.size()));
+  const int64_t received_at(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+  if (seq >= 0 && _unindexed >= IndexInterval) {
+    _index.write(reinterpret_cast<const char *>(&seq), sizeof(seq));
+    const uint64_t offset(_offset);
+    _index.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    _unindexed = 0;
+  }
+  ++_unindexed;
+  uint8_t *output(static_cast<uint8_t *>(_region->get_address()) + _offset);
+  std::memcpy(output + sizeof(length), &seq, sizeof(seq));
+  std::memcpy(output + sizeof(length) + sizeof(seq), &received_at,
+              sizeof(received_at));
+  std::memcpy(output + RecordHeaderBytes, frame.data(), frame.size());
+  // length last, a reader never sees a partly written record
+  std::memcpy(output, &length, sizeof(length));
+  _offset += RecordHeaderBytes + frame.size();
+  ++_records;
+}
+
+void capture_writer::open_segment(const size_t minimum_bytes) {
+  _segment_path = segment_path(_directory, _segment_number++);
+  const size_t size(std::max(_segment_bytes, minimum_bytes));
+  {
+    // sparse, zero-filled
+    std::ofstream create(_segment_path, std::ios::binary | std::ios::trunc);
+  }
+  std::filesystem::resize_file(_segment_path, size);
+  bip::file_mapping mapping(_segment_path.c_str(), bip::read_write);
+  _region = std::make_unique<bip::mapped_region>(mapping, bip::read_write, 0,
+                                                 size);
+  _region->advise(bip::mapped_region::advice_sequential);
+  _offset = 0;
+  _records = 0;
+  // first frame with a seq is always indexed
+  _unindexed = IndexInterval;
+  auto index_path(_segment_path);
+  index_path.replace_extension(IndexExtension);
+  _index.open(index_path, std::ios::binary | std::ios::trunc);
+  if (!_index.is_open()) {
+    throw std::runtime_error("cannot open capture index " +
+                             index_path.string());
+  }
+}
+
+void capture_writer::close_segment() {
+  if (!_region)
+    return;
+  _region->flush(0, _offset + EndMarkerBytes);
+  _region.reset();
+  _index.close();
+  // drop the unused tail, keeping the end marker
+  std::filesystem::resize_file(_segment_path, _offset + EndMarkerBytes);
+  REL_INFO("Closed capture segment {}, {} frames, {} bytes",
+           _segment_path.string(), _records, _offset);
+}
+
+capture_reader::capture_reader(std::filesystem::path const &directory)
+    : _segments(list_segments(directory)) {
+  if (_segments.empty()) {
+    throw std::runtime_error("no capture segments in " + directory.string());
+  }
+  open_segment(0);
+}
+
+std::vector<capture_reader::index_entry>
+capture_reader::load_index(const size_t segment) const {
+  std::vector<index_entry> entries;
+  auto index_path(_segments[segment]);
+  index_path.replace_extension(IndexExtension);
+  std::ifstream index(index_path, std::ios::binary);
+  index_entry entry;
+  // a truncated trailing entry, from a writer that did not close, is ignored
+  while (
+      index.read(reinterpret_cast<char *>(&entry._seq), sizeof(entry._seq)) &&
+      index.read(reinterpret_cast<char *>(&entry._offset),
+                 sizeof(entry._offset))) {
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+void capture_reader::seek(const int64_t from_seq) {
+  _skip_before = from_seq;
+  // last segment starting at or before the target
+  size_t segment(0);
+  std::vector<index_entry> entries;
+  for (size_t candidate = 0; candidate < _segments.size(); ++candidate) {
+    auto candidate_entries(load_index(candidate));
+    if (candidate_entries.empty())
+      continue;
+    if (candidate_entries.front()._seq > from_seq)
+      break;
+    segment = candidate;
+    entries = std::move(candidate_entries);
+  }
+  if (!open_segment(segment))
+    return;
+  auto after(std::ranges::upper_bound(entries, from_seq, {},
+                                      &index_entry::_seq));
+  if (after != entries.cbegin() &&
+      std::prev(after)->_offset < _region->get_size()) {
+    _offset = std::prev(after)->_offset;
+  }
+}
+
+bool capture_reader::next(captured_frame &frame) {
+  while (_region) {
+    const uint8_t *input(static_cast<const uint8_t *>(_region->get_address()) +
+                         _offset);
+    const size_t available(_region->get_size() - _offset);
+    uint32_t length(0);
+    if (available >= RecordHeaderBytes) {
+      std::memcpy(&length, input, sizeof(length));
+    }
+    if (length == 0 || RecordHeaderBytes + length > available) {
+      // end of this segment
+      if (!open_segment(_segment + 1))
+        return false;
+      continue;
+    }
+    std::memcpy(&frame._seq, input + sizeof(length), sizeof(frame._seq));
+    std::memcpy(&frame._received_at, input + sizeof(length) + sizeof(int64_t),
+                sizeof(frame._received_at));
+    frame._frame = {input + RecordHeaderBytes, length};
+    _offset += RecordHeaderBytes + length;
+    if (_skip_before >= 0) {
+      if (frame._seq < _skip_before)
+        continue;
+      _skip_before = -1;
+    }
+    return true;
+  }
+  return false;
+}
+
+bool capture_reader::open_segment(const size_t segment) {
+  _region.reset();
+  _offset = 0;
+  _segment = segment;
+  if (_segment >= _segments.size())
+    return false;
+  auto const size(std::filesystem::file_size(_segments[_segment]));
+  if (size == 0)
+    return open_segment(_segment + 1);
+  bip::file_mapping mapping(_segments[_segment].c_str(), bip::read_only);
+  _region = std::make_unique<bip::mapped_region>(mapping, bip::read_only);
+  _region->advise(bip::mapped_region::advice_sequential);
+  return true;
+}
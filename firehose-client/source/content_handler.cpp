@@ -21,10 +21,31 @@ http://www.fsf.org/licensing/licenses
 #include "content_handler.hpp"
 #include "payload.hpp"
 
+// Frames are decoded on a worker pool by default, zero threads decodes on the
+// post-processor thread
+constexpr size_t DefaultDecodeThreads = 4;
+
+template <>
+void content_handler<firehose_payload>::set_config(YAML::Node const &settings) {
+  size_t decode_threads(
+      settings["decode_threads"].as<size_t>(DefaultDecodeThreads));
+  REL_INFO("Firehose decode threads {}", decode_threads);
+  _decode_pool.start(decode_threads);
+  set_overload(settings);
+}
+
 template <>
-void content_handler<firehose_payload>::handle(
-    beast::flat_buffer const &beast_data) {
-  parser my_parser;
-  my_parser.get_candidates_from_flat_buffer(beast_data);
-  _post_processor.wait_enqueue(firehose_payload(my_parser));
+void content_handler<firehose_payload>::handle(pooled_buffer &&frame,
+                                               const bool tracks_cursor) {
+  if (!admit(frame.bytes(),
+             _decode_pool.backlog() + _post_processor.backlog()))
+    return;
+  // frame buffer moves downstream, decode happens there
+  if (_decode_pool.is_started()) {
+    _decode_pool.wait_enqueue(
+        firehose_payload(std::move(frame), tracks_cursor));
+  } else {
+    _post_processor.wait_enqueue(
+        firehose_payload(std::move(frame), tracks_cursor));
+  }
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+#include "dag_cbor.hpp"
+#include "cid.hpp"
+#include <charconv>
+#include <cstdio>
+#include <sstream>
+
+namespace dag_cbor {
+
+value value::at_pointer(std::string_view pointer) const {
+  value current(*this);
+  while (!pointer.empty() && current.is_valid()) {
+    if (pointer.front() != '/')
+      throw decode_error("malformed JSON pointer");
+    pointer.remove_prefix(1);
+    size_t separator(pointer.find('/'));
+    std::string_view token(pointer.substr(0, separator));
+    pointer.remove_prefix(separator == std::string_view::npos ? pointer.size()
+                                                              : separator);
+    if (current.is_array()) {
+      size_t index(0);
+      auto result(
+          std::from_chars(token.data(), token.data() + token.size(), index));
+      if (result.ec != std::errc() || result.ptr != token.data() + token.size())
+        return value();
+      current = current[index];
+    } else {
+      // field names in the lexicon never need ~0 or ~1 escapes
+      current = current[token];
+    }
+  }
+  return current;
+}
+
+namespace {
+void append_text(std::string &output, std::string_view text) {
+  output.push_back('"');
+  for (char next : text) {
+    switch (next) {
+    case '"':
+      output.append("\\\"");
+      break;
+    case '\\':
+      output.append("\\\\");
+      break;
+    case '\b':
+      output.append("\\b");
+      break;
+    case '\f':
+      output.append("\\f");
+      break;
+    case '\n':
+      output.append("\\n");
+      break;
+    case '\r':
+      output.append("\\r");
+      break;
+    case '\t':
+      output.append("\\t");
+      break;
+    default:
+      if (static_cast<unsigned char>(next) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                      static_cast<unsigned>(next));
+        output.append(escaped);
+      } else {
+        output.push_back(next);
+      }
+      break;
+    }
+  }
+  output.push_back('"');
+}
+
+void append_value(std::string &output, value const &item) {
+  switch (item.type()) {
+  case major_type::unsigned_integer:
+  case major_type::negative_integer:
+    output.append(std::to_string(item.as_integer()));
+    break;
+  case major_type::byte_string:
+    output.append("{\"bytes\":");
+    output.append(std::to_string(item.size()));
+    output.push_back('}');
+    break;
+  case major_type::text_string:
+    append_text(output, item.as_text());
+    break;
+  case major_type::array: {
+    output.push_back('[');
+    bool first(true);
+    for (auto const &element : item.items()) {
+      if (!first)
+        output.push_back(',');
+      first = false;
+      append_value(output, element);
+    }
+    output.push_back(']');
+  } break;
+  case major_type::map: {
+    output.push_back('{');
+    bool first(true);
+    for (auto const &entry : item.entries()) {
+      if (!first)
+        output.push_back(',');
+      first = false;
+      append_value(output, entry._key);
+      output.push_back(':');
+      append_value(output, entry._value);
+    }
+    output.push_back('}');
+  } break;
+  case major_type::tag:
+    if (item.is_cid()) {
+      output.append("{\"$link\":\"");
+      output.append(atproto::cid(item.as_cid()).to_string());
+      output.append("\"}");
+    } else {
+      output.append("{\"tag\":");
+      output.append(std::to_string(item.tag()));
+      output.append(",\"value\":");
+      append_value(output, item.tagged());
+      output.push_back('}');
+    }
+    break;
+  case major_type::simple:
+    if (item.is_null()) {
+      output.append("null");
+    } else if (item.is_bool()) {
+      output.append(item.as_bool() ? "true" : "false");
+    } else if (item.is_float()) {
+      std::ostringstream oss;
+      oss << item.as_double();
+      output.append(oss.str());
+    } else {
+      output.append("undefined");
+    }
+    break;
+  }
+}
+} // namespace
+
+std::string dump(value const &item) {
+  std::string output;
+  if (item.is_valid()) {
+    append_value(output, item);
+  }
+  return output;
+}
+
+} // namespace dag_cbor
@@ -0,0 +1,169 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "filter_automaton.hpp"
+
+#include <algorithm>
+
+void filter_automaton::add(std::string const &keyword,
+                           pattern const &value) {
+  if (keyword.empty())
+    return;
+  _pending[keyword].push_back(value);
+  _built = false;
+}
+
+// Goto function as a trie of the keywords, laid out breadth first in the
+// double array, then failure links and output runs in the same order.
+// Rebuilt from scratch, rule sets are built once per refresh.
+void filter_automaton::build() {
+  _keywords.clear();
+  _patterns.clear();
+  _cells.clear();
+  _outputs.clear();
+
+  // keywords in a fixed order so rebuilds give the same automaton
+  std::vector<std::string const *> keywords;
+  keywords.reserve(_pending.size());
+  for (auto const &entry : _pending) {
+    keywords.push_back(&entry.first);
+  }
+  std::ranges::sort(keywords, [](auto lhs, auto rhs) { return *lhs < *rhs; });
+
+  // edges sorted by label, and the keyword ending at each node or None
+  std::vector<std::vector<edge>> trie(1);
+  std::vector<uint32_t> trie_keyword(1, None);
+  for (auto text : keywords) {
+    auto const &patterns(_pending.find(*text)->second);
+    keyword next;
+    next._length = static_cast<uint32_t>(text->size());
+    next._first = static_cast<uint32_t>(_patterns.size());
+    _patterns.insert(_patterns.end(), patterns.cbegin(), patterns.cend());
+    next._last = static_cast<uint32_t>(_patterns.size());
+
+    uint32_t current(Root);
+    for (const char next_byte : *text) {
+      const uint8_t label(Fold[static_cast<uint8_t>(next_byte)]);
+      auto &edges(trie[current]);
+      auto position(std::ranges::lower_bound(edges, label, {}, &edge::_label));
+      if (position != edges.end() && position->_label == label) {
+        current = position->_target;
+        continue;
+      }
+      uint32_t target(static_cast<uint32_t>(trie.size()));
+      edges.insert(position, edge{label, target});
+      trie.emplace_back();
+      trie_keyword.push_back(None);
+      current = target;
+    }
+    trie_keyword[current] = static_cast<uint32_t>(_keywords.size());
+    _keywords.push_back(next);
+  }
+
+  // breadth first, giving each node with children the lowest base whose
+  // child slots are all free
+  std::vector<uint32_t> slot_of(trie.size(), None);
+  std::vector<uint32_t> order;
+  order.reserve(trie.size());
+  _cells.resize(Alphabet);
+  _cells[Root]._check = Root;
+  slot_of[Root] = Root;
+  order.push_back(Root);
+  size_t first_free(1);
+  for (size_t index = 0; index < order.size(); ++index) {
+    const uint32_t node(order[index]);
+    auto const &edges(trie[node]);
+    if (edges.empty())
+      continue;
+    const uint32_t base(free_base(edges, first_free));
+    _cells[slot_of[node]]._base = base;
+    for (auto const &child_edge : edges) {
+      const uint32_t slot(base + child_edge._label);
+      _cells[slot]._check = slot_of[node];
+      slot_of[child_edge._target] = slot;
+      order.push_back(child_edge._target);
+    }
+  }
+
+  // a node's failure target is shallower, so its links and outputs are
+  // already final. Children of the root fail to the root.
+  for (const uint32_t node : order) {
+    const uint32_t slot(slot_of[node]);
+    const uint32_t fallback(_cells[_cells[slot]._failure]._outputs);
+    if (trie_keyword[node] == None) {
+      _cells[slot]._outputs = fallback;
+    } else {
+      _cells[slot]._outputs = static_cast<uint32_t>(_outputs.size());
+      _outputs.push_back(trie_keyword[node]);
+      for (uint32_t entry = fallback; entry != None && _outputs[entry] != None;
+           ++entry) {
+        _outputs.push_back(_outputs[entry]);
+      }
+      _outputs.push_back(None);
+    }
+    for (auto const &child_edge : trie[node]) {
+      _cells[slot_of[child_edge._target]]._failure =
+          node == Root ? Root : next(_cells[slot]._failure, child_edge._label);
+    }
+  }
+  // held for the life of the rule set
+  _cells.shrink_to_fit();
+  _outputs.shrink_to_fit();
+  _built = true;
+}
+
+// Tries each free slot from first_free as the first child's. Free slots no
+// child can reach, such as those below the first letter when every filter
+// is letters, would otherwise be passed over by every later search, so
+// first_free moves on once the slots searched are nearly all taken. Grows
+// the array so the base has a full alphabet of slots after it.
+uint32_t filter_automaton::free_base(std::vector<edge> const &edges,
+                                     size_t &first_free) {
+  const size_t lowest(edges.front()._label);
+  size_t taken(0);
+  for (size_t slot = first_free;; ++slot) {
+    if (_cells.size() < slot + Alphabet) {
+      _cells.resize(slot + Alphabet);
+    }
+    if (_cells[slot]._check != None) {
+      ++taken;
+      continue;
+    }
+    // base 0 is for states with no children
+    if (slot <= lowest)
+      continue;
+    const size_t base(slot - lowest);
+    if (std::ranges::all_of(edges, [&](edge const &child_edge) {
+          return _cells[base + child_edge._label]._check == None;
+        })) {
+      if (taken * 20 >= (slot - first_free + 1) * 19) {
+        first_free = slot;
+      }
+      return static_cast<uint32_t>(base);
+    }
+  }
+}
+
+size_t filter_automaton::footprint() const {
+  return _cells.capacity() * sizeof(cell) +
+         _outputs.capacity() * sizeof(uint32_t) +
+         _keywords.capacity() * sizeof(keyword) +
+         _patterns.capacity() * sizeof(pattern);
+}
@@ -134,6 +134,11 @@ int main(int argc, char **argv) {
           "realtime_alerts", "Alerts generated for possibly suspect activity");
       metrics_factory::instance().add_gauge(
           "process_operation", "Statistics about process internals");
+      metrics_factory::instance().add_counter(
+          "match_prefilter",
+          "Candidates rejected by the prefilter or passed on");
+      metrics_factory::instance().add_counter(
+          "match_cache", "Candidate match verdicts found in the cache or not");
 
       // seed database monitors before we start post-processing firehose
       // messages
@@ -20,6 +20,7 @@ http://www.fsf.org/licensing/licenses
 
 #include "matcher.hpp"
 
+#include <algorithm>
 #include <exception>
 #include <fstream>
 #include <ranges>
@@ -32,10 +33,41 @@ http://www.fsf.org/licensing/licenses
 #include "common/moderation/report_agent.hpp"
 #include "parser.hpp"
 
-matcher::matcher() { _whole_word_trie.only_whole_words(); }
+matcher::matcher() {}
 
 // load from file, or wait for DB to load
 void matcher::set_config(const YAML::Node &filter_config) {
+  _prefilter_rejects = &metrics_factory::instance()
+                            .get_counter("match_prefilter")
+                            .Get({{"result", "rejected"}});
+  _prefilter_passes = &metrics_factory::instance()
+                           .get_counter("match_prefilter")
+                           .Get({{"result", "passed"}});
+  // on at the default size unless configured otherwise
+  const YAML::Node cache(filter_config["cache"]);
+  if (!cache || cache["enabled"].as<bool>(true)) {
+    _verdicts = std::make_unique<verdict_cache>(
+        cache ? cache["entries"].as<size_t>(verdict_cache::DefaultCapacity)
+              : verdict_cache::DefaultCapacity);
+    _verdict_hits = &metrics_factory::instance()
+                         .get_counter("match_cache")
+                         .Get({{"result", "hit"}});
+    _verdict_misses = &metrics_factory::instance()
+                           .get_counter("match_cache")
+                           .Get({{"result", "miss"}});
+    REL_INFO("Match verdict cache of {} entries", _verdicts->capacity());
+  }
+  const YAML::Node skeleton(filter_config["skeleton"]);
+  if (skeleton && skeleton["enabled"].as<bool>(false)) {
+    std::map<std::string, std::string> folds;
+    for (auto const &fold : skeleton["folds"]) {
+      folds.insert(
+          {fold.first.as<std::string>(), fold.second.as<std::string>()});
+    }
+    _skeleton = std::make_shared<const text_skeleton>(
+        skeleton["confusables"].as<bool>(true), folds);
+    REL_INFO("Match skeleton maps {} characters", _skeleton->size());
+  }
   _use_db_for_rules = filter_config["use_db"].as<bool>();
   if (!_use_db_for_rules) {
     load_filter_file(filter_config["filename"].as<std::string>());
@@ -68,16 +100,38 @@ void matcher::load_filter_file(std::string const &filename) {
       REL_INFO("Stored rule at line {}: '{}'", line, str);
     }
   }
+  publish();
 }
 
 void matcher::refresh_rules(matcher &&replacement) {
-  std::lock_guard log(_lock);
-  _rule_lookup.swap(replacement._rule_lookup);
-  _substring_trie = std::move(replacement._substring_trie);
-  _whole_word_trie = std::move(replacement._whole_word_trie);
+  _rules.store(replacement.snapshot(), std::memory_order_release);
   _is_ready = true;
 }
 
+void matcher::reuse_rules_from(matcher const &current) {
+  _reusable = current.snapshot();
+  _skeleton = current._skeleton;
+}
+
+void matcher::publish() { publish_staged(); }
+
+void matcher::publish_staged() const {
+  std::lock_guard lock(_staging_lock);
+  if (!_staged)
+    return;
+  _staged->prepare();
+  _rules.store(std::shared_ptr<const rule_set>(std::move(_staged)),
+               std::memory_order_release);
+  _has_staged.store(false, std::memory_order_release);
+}
+
+std::shared_ptr<const rule_set> matcher::snapshot() const {
+  if (_has_staged.load(std::memory_order_acquire)) {
+    publish_staged();
+  }
+  return _rules.load(std::memory_order_acquire);
+}
+
 bool matcher::add_rule(std::string const &match_rule) {
   return insert_rule(rule(match_rule));
 }
@@ -87,6 +141,15 @@ bool matcher::add_rule(std::string const &filter, std::string const &labels,
                        std::string const &contingent,
                        std::string const &categories, const int rule_id,
                        const bool track, const bool label) {
+  if (_reusable) {
+    auto id(_reusable->find_target(filter));
+    if (id && _reusable->rule(*id).has_source(filter, labels, actions,
+                                              contingent, categories, rule_id,
+                                              track, label)) {
+      ++_reused_rules;
+      return insert_rule(_reusable->filter(*id), _reusable->shared_rule(*id));
+    }
+  }
   return insert_rule(rule(filter, labels, actions, contingent, categories,
                           rule_id, track, label));
 }
@@ -98,22 +161,33 @@ bool matcher::insert_rule(rule &&new_rule) {
     REL_WARNING("Skipped rule '{}'", new_rule.to_string());
     return false;
   }
+  // use ICU canonical form for multilanguage support
+  std::string canonical_form(to_canonical_utf8(new_rule._target));
+  return insert_rule(canonical_form,
+                     std::make_shared<const rule>(std::move(new_rule)));
+}
+
+bool matcher::insert_rule(std::string const &canonical_form,
+                          std::shared_ptr<const rule> new_rule) {
   // TODO handle this for refresh case
-  if (!new_rule._block_list_name.empty()) {
-    list_manager::instance().register_block_reason(new_rule._block_list_name,
-                                                   new_rule._target);
+  if (!new_rule->_block_list_name.empty()) {
+    list_manager::instance().register_block_reason(new_rule->_block_list_name,
+                                                   new_rule->_target);
   }
-  std::wstring canonical_form(to_canonical(new_rule._target));
-  // use ICU canonical form for multilanguage support
-  if (new_rule._match_type == rule::match_type::substring)
-    _substring_trie.insert(canonical_form);
-  else if (new_rule._match_type == rule::match_type::whole_word)
-    _whole_word_trie.insert(canonical_form);
-  if (_rule_lookup.insert({canonical_form, new_rule}).second) {
-    REL_INFO("Stored rule '{}'", new_rule.to_string());
+  std::lock_guard lock(_staging_lock);
+  if (!_staged) {
+    // further rules for a published set go in a copy of it
+    auto published(_rules.load(std::memory_order_acquire));
+    _staged = published ? std::make_unique<rule_set>(*published)
+                        : std::make_unique<rule_set>(_skeleton);
+  }
+  if (_staged->contains(canonical_form)) {
+    REL_WARNING("Duplicate rule '{}'", new_rule->to_string());
   } else {
-    REL_WARNING("Duplicate rule '{}'", new_rule.to_string());
+    REL_INFO("Stored rule '{}'", new_rule->to_string());
+    _staged->insert(canonical_form, std::move(new_rule));
   }
+  _has_staged.store(true, std::memory_order_release);
   return true;
 }
 
@@ -128,12 +202,15 @@ bool matcher::matches_any(beast::flat_buffer const &beast_data) const {
 }
 
 bool matcher::check_candidates(candidate_list const &candidates) const {
-  std::lock_guard lock(_lock);
+  auto rules(snapshot());
+  if (!rules) return false;
+  thread_local std::string folded;
+  thread_local std::string mapped;
   for (auto &next : candidates) {
-    if (next._value.empty()) continue;
-    // use ICU canonical form for multilanguage support
-    auto result = _substring_trie.parse_text(to_canonical(next._value));
-    if (!result.empty()) return true;
+    if (next._value.empty() || !rules->may_match(next._value)) continue;
+    if (rules->matches_substring(
+            rules->matchable(next._value, folded, mapped)))
+      return true;
   }
   return false;
 }
@@ -146,42 +223,48 @@ match_results matcher::find_all_matches(
 
 match_results matcher::all_matches_for_candidates(
     candidate_list const &candidates) const {
-  std::lock_guard lock(_lock);
+  auto rules(snapshot());
   match_results results;
+  if (!rules) return results;
   for (auto &next : candidates) {
     if (next._value.empty()) continue;
-    // use ICU canonical form for multilanguage support
-    std::wstring canonical_form(to_canonical(next._value));
-    aho_corasick::basic_trie<wchar_t>::emit_collection all_matches(
-        _substring_trie.parse_text(canonical_form));
-    aho_corasick::basic_trie<wchar_t>::emit_collection whole_words(
-        _whole_word_trie.parse_text(canonical_form));
-    if (!whole_words.empty())
-      all_matches.insert(all_matches.end(), whole_words.cbegin(),
-                         whole_words.cend());
-    if (!all_matches.empty()) {
-      results.emplace_back(next, all_matches);
+    std::vector<rule_id> matched(verdict_for(*rules, next));
+    if (!matched.empty()) {
+      results.emplace_back(next, std::move(matched), rules);
     }
   }
+  return results;
+}
 
-  // strip out matches which do not pass contingent string matching in rule
-  for (auto next_match = results.begin(); next_match != results.end();) {
-    for (auto rule_key = next_match->_matches.begin();
-         rule_key != next_match->_matches.end();) {
-      matcher::rule this_rule = find_rule_unchecked(rule_key->get_keyword());
-      if (!this_rule.passes_contingent_checks(next_match->_candidate._value)) {
-        rule_key = next_match->_matches.erase(rule_key);
-      } else {
-        ++rule_key;
-      }
+std::vector<rule_id> matcher::verdict_for(rule_set const &rules,
+                                          candidate const &next) const {
+  std::vector<rule_id> matched;
+  if (!rules.may_match(next._value)) {
+    if (_prefilter_rejects) {
+      _prefilter_rejects->Increment();
     }
-    if (next_match->_matches.empty()) {
-      next_match = results.erase(next_match);
-    } else {
-      ++next_match;
+    return matched;
+  }
+  if (_prefilter_passes) {
+    _prefilter_passes->Increment();
+  }
+  uint64_t key(0);
+  if (_verdicts) {
+    key = verdict_cache::key_of(next._type, next._field, next._value);
+    verdict_cache::verdict cached;
+    if (_verdicts->find(key, rules.generation(), cached)) {
+      _verdict_hits->Increment();
+      return std::vector<rule_id>(cached.begin(), cached.end());
     }
+    _verdict_misses->Increment();
   }
-  return results;
+  thread_local std::string folded;
+  thread_local std::string mapped;
+  matched = rules.match(rules.matchable(next._value, folded, mapped));
+  if (_verdicts) {
+    _verdicts->store(key, rules.generation(), matched);
+  }
+  return matched;
 }
 
 path_match_results matcher::all_matches_for_path_candidates(
@@ -210,8 +293,8 @@ void matcher::report_if_needed(account_filter_matches &matches) {
     std::string cid(result._cid);
     std::vector<std::string> filters;
     for (auto const &next_match : result._matches) {
-      for (auto const &match : next_match._matches) {
-        matcher::rule matched_rule(find_rule(match.get_keyword()));
+      for (const rule_id match : next_match._matches) {
+        rule const &matched_rule(next_match._rules->rule(match));
         rule::report_scope scope(matched_rule._report);
         if ((scope == rule::report_scope::none) && !matched_rule._label) {
           // auto-moderation not requested for this rule
@@ -294,29 +377,20 @@ matcher::rule::rule(std::string const &rule_string) {
         break;
       case 3:
         if (field.empty()) continue;
-        _contingent = field;
-        // make a trie of 'contingent strings' to confirm rule_string context
-        for (const auto subtoken : std::views::split(_contingent, ',')) {
-          std::string next(subtoken.cbegin(), subtoken.cend());
-          if (starts_with(next, "!")) {
-            next = next.substr(1);
-            _absent_substring_trie.insert(
-                to_canonical(std::string_view(subtoken)));
-          } else {
-            _substring_trie.insert(to_canonical(std::string_view(subtoken)));
-          }
-        }
+        store_contingent(field);
         break;
       default:
-        throw std::invalid_argument("More than " + std::to_string(field_count) +
+        throw std::invalid_argument("More than " +
+                                    std::to_string(file_field_count) +
                                     " fields in filter rule " + rule_string);
         break;
     }
     ++count;
   }
-  // final field, contingent strings to match, is currently optional
-  if (count < field_count - 1)
-    throw std::invalid_argument("Less than " + std::to_string(field_count) +
+  // final field, contingent strings to match, is optional
+  if (count < file_field_count - 1)
+    throw std::invalid_argument("Less than " +
+                                std::to_string(file_field_count - 1) +
                                 " fields in filter rule " + rule_string);
 }
 
@@ -341,17 +415,7 @@ matcher::rule::rule(std::string const &filter, std::string const &labels,
     _report = report_scope::content;
   }
   if (!contingent.empty()) {
-    _contingent = contingent;
-    // make a trie of 'contingent strings' to confirm rule_string context
-    for (const auto subtoken : std::views::split(_contingent, ',')) {
-      std::string next(subtoken.cbegin(), subtoken.cend());
-      if (starts_with(next, "!")) {
-        next = next.substr(1);
-        _absent_substring_trie.insert(to_canonical(std::string_view(subtoken)));
-      } else {
-        _substring_trie.insert(to_canonical(std::string_view(subtoken)));
-      }
-    }
+    store_contingent(contingent);
   }
   if (categories.empty()) throw std::invalid_argument("Blank categories");
   for (const auto subtoken : std::views::split(std::string(categories), ',')) {
@@ -359,6 +423,29 @@ matcher::rule::rule(std::string const &filter, std::string const &labels,
   }
 }
 
+bool matcher::rule::has_source(std::string const &filter,
+                               std::string const &labels,
+                               std::string const &actions,
+                               std::string const &contingent,
+                               std::string const &categories,
+                               const int rule_id, const bool track,
+                               const bool label) const {
+  // lists were split on ',' with nothing dropped
+  auto joined = [](std::vector<std::string> const &items) {
+    std::string result;
+    for (size_t index = 0; index < items.size(); ++index) {
+      if (index > 0)
+        result.push_back(',');
+      result.append(items[index]);
+    }
+    return result;
+  };
+  return _id == rule_id && _track == track && _label == label &&
+         _target == filter && _raw_actions == actions &&
+         _contingent == contingent && joined(_labels) == labels &&
+         joined(_categories) == categories;
+}
+
 void matcher::rule::store_actions(std::string_view actions) {
   _raw_actions = actions;
   // with string_view's C++23 range constructor:
@@ -374,8 +461,9 @@ void matcher::rule::store_actions(std::string_view actions) {
       throw std::invalid_argument("Invalid rule action " + field +
                                   ", blank value");
     }
+    // rules from DB take these from their own columns instead
     if (starts_with(field, "track=")) {
-      // legacy data, no-op
+      _track = value == "true";
       continue;
     }
     if (starts_with(field, "report=")) {
@@ -383,7 +471,7 @@ void matcher::rule::store_actions(std::string_view actions) {
       continue;
     }
     if (starts_with(field, "label=")) {
-      // legacy data, no-op
+      _label = value == "true";
       continue;
     }
     if (starts_with(field, "scope=")) {
@@ -408,51 +496,128 @@ void matcher::rule::store_actions(std::string_view actions) {
   }
 }
 
-matcher::rule::rule(matcher::rule const &rhs)
-    : _target(rhs._target),
-      _labels(rhs._labels),
-      _id(rhs._id),
-      _track(rhs._track),
-      _report(rhs._report),
-      _label(rhs._label),
-      _content_scope(rhs._content_scope),
-      _block_list_name(rhs._block_list_name),
-      _match_type(rhs._match_type),
-      _contingent(rhs._contingent) {
-  // make a trie that is used to confirm the rule match
+// 'contingent strings' confirm the rule match, a leading '!' marks a string
+// that must be absent
+void matcher::rule::store_contingent(std::string_view contingent) {
+  _contingent = contingent;
   for (const auto subtoken : std::views::split(_contingent, ',')) {
-    std::string next(subtoken.cbegin(), subtoken.cend());
-    if (starts_with(next, "!")) {
-      next = next.substr(1);
-      _absent_substring_trie.insert(to_canonical(std::string_view(subtoken)));
+    std::string_view next(subtoken.begin(), subtoken.end());
+    if (next.starts_with('!')) {
+      _absent.push_back(to_canonical_utf8(next.substr(1)));
     } else {
-      _substring_trie.insert(to_canonical(std::string_view(subtoken)));
+      _required.push_back(to_canonical_utf8(next));
     }
   }
 }
 
-bool matcher::rule::passes_contingent_checks(
-    std::string const &candidate) const {
-  if (_contingent.empty()) return true;
-  // use ICU canonical form for multilanguage support
-  auto normalized(to_canonical(candidate));
-  auto required = _substring_trie.parse_text(normalized);  // at least one match
-  auto disallowed =
-      _absent_substring_trie.parse_text(normalized);  // zero matches
+matcher::rule matcher::find_rule(std::string const &filter) const {
+  auto rules(snapshot());
+  if (!rules) {
+    std::ostringstream oss;
+    oss << "Rule lookup failed for key " << filter;
+    throw std::runtime_error(oss.str());
+  }
+  return rules->rule(rules->id_of(to_canonical_utf8(filter)));
+}
+
+std::string match_result::filters() const {
+  std::ostringstream oss;
+  bool first(true);
+  for (const rule_id match : _matches) {
+    if (!first)
+      oss << ',';
+    else
+      first = false;
+    oss << '\'' << _rules->filter(match) << '\'';
+  }
+  return oss.str();
+}
 
-  return !required.empty() && disallowed.empty();
+void rule_set::insert(std::string const &canonical_form,
+                      std::shared_ptr<const matcher::rule> new_rule) {
+  const rule_id id(static_cast<rule_id>(_entries.size()));
+  filter_automaton::pattern pattern;
+  pattern._owner = id;
+  pattern._whole_word =
+      new_rule->_match_type == matcher::rule::match_type::whole_word;
+  // the automaton has what matchable makes of text
+  std::string mapped;
+  auto keyword = [&](std::string const &text) {
+    return _skeleton ? std::string(_skeleton->apply(text, mapped)) : text;
+  };
+  _automaton.add(keyword(canonical_form), pattern);
+  _prefilter.add(canonical_form);
+  pattern._whole_word = false;
+  pattern._role = filter_automaton::role::required;
+  for (auto const &required : new_rule->required()) {
+    _automaton.add(keyword(required), pattern);
+  }
+  pattern._role = filter_automaton::role::absent;
+  for (auto const &absent : new_rule->absent()) {
+    _automaton.add(keyword(absent), pattern);
+  }
+  _targets.insert({new_rule->_target, id});
+  _entries.emplace_back(std::move(new_rule), canonical_form);
+  _ids.insert({canonical_form, id});
+}
+
+std::string_view rule_set::matchable(std::string_view text,
+                                     std::string &folded,
+                                     std::string &mapped) const {
+  // ICU case folding for multilanguage support, ASCII is folded as matched
+  std::string_view result(fold_non_ascii(text, folded));
+  return _skeleton ? _skeleton->apply(result, mapped) : result;
+}
+
+void rule_set::prepare() {
+  static std::atomic<uint64_t> generations(0);
+  if (!_automaton.is_built()) {
+    _automaton.build();
+  }
+  _generation = ++generations;
+}
+
+std::vector<rule_id> rule_set::match(std::string_view text) const {
+  std::vector<rule_id> matched;
+  // contingent hits are rare, a list of them beats per-rule state
+  std::vector<std::pair<rule_id, filter_automaton::role>> contingent;
+  _automaton.scan(text,
+                  [&](filter_automaton::pattern const &hit, size_t) {
+                    if (hit._role == filter_automaton::role::primary) {
+                      matched.push_back(hit._owner);
+                    } else {
+                      contingent.emplace_back(hit._owner, hit._role);
+                    }
+                  });
+  // strip out matches which do not pass contingent string matching in rule
+  std::erase_if(matched, [&](const rule_id id) {
+    if (_entries[id]._rule->_contingent.empty()) return false;
+    bool required(false);
+    for (auto const &[owner, role] : contingent) {
+      if (owner != id) continue;
+      if (role == filter_automaton::role::absent) return true;
+      required = true;
+    }
+    return !required;
+  });
+  return matched;
 }
 
-matcher::rule matcher::find_rule(std::wstring const &key) const {
-  std::lock_guard lock(_lock);
-  return find_rule_unchecked(key);
+bool rule_set::matches_substring(std::string_view text) const {
+  bool found(false);
+  _automaton.scan(text,
+                  [&](filter_automaton::pattern const &hit, size_t) {
+                    found |= hit._role == filter_automaton::role::primary &&
+                             !hit._whole_word;
+                  });
+  return found;
 }
 
-matcher::rule matcher::find_rule_unchecked(std::wstring const &key) const {
-  auto result(_rule_lookup.find(key));
-  if (result != _rule_lookup.cend()) return result->second;
+rule_id rule_set::id_of(std::string const &canonical_form) const {
+  auto result(_ids.find(canonical_form));
+  if (result != _ids.cend()) return result->second;
 
   std::ostringstream oss;
-  oss << "Rule lookup failed for key " << wstring_to_utf8(key);
+  oss << "Rule lookup failed for key " << canonical_form;
   throw std::runtime_error(oss.str());
 }
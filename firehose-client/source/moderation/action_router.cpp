@@ -31,7 +31,8 @@ action_router &action_router::instance() {
   return my_instance;
 }
 
-action_router::action_router() : _queue(QueueLimit) {}
+action_router::action_router()
+    : _queue(QueueLimit, {{"action_router", "backlog"}}) {}
 
 void action_router::start() {
   _thread = std::thread([&, this] {
@@ -39,10 +40,6 @@ void action_router::start() {
       account_filter_matches matches;
       _queue.wait_dequeue(matches);
       // process the item
-      metrics_factory::instance()
-          .get_gauge("process_operation")
-          .Get({{"action_router", "backlog"}})
-          .Decrement();
       matcher::shared().report_if_needed(matches);
     }
     REL_INFO("action_router stopping");
@@ -50,9 +47,5 @@ void action_router::start() {
 }
 
 void action_router::wait_enqueue(account_filter_matches &&value) {
-  _queue.enqueue(value);
-  metrics_factory::instance()
-      .get_gauge("process_operation")
-      .Get({{"action_router", "backlog"}})
-      .Increment();
+  _queue.enqueue(std::move(value));
 }
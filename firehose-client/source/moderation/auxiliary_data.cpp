@@ -149,15 +149,30 @@ void auxiliary_data::check_rewind_point() {
   }
 }
 
-// Don't refresh until interval has elapsed
+// Don't refresh until interval has elapsed, nor if the table is unchanged.
+// Rows that are unchanged keep their rule as published, the new rule set is
+// built on this thread and swapped in.
 void auxiliary_data::update_match_filters() {
   if (!matcher::shared().use_db_for_rules()) return;
   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
   if (std::chrono::duration_cast<std::chrono::minutes>(
           now - _last_match_filter_refresh) > MatchFiltersRefreshInterval) {
     pqxx::work tx(*_cx);
+    // The rows are read by a later statement and may be newer than this.
+    // Then the next checksum differs and they are read again, a change is
+    // never missed.
+    std::string checksum(tx.query_value<std::string>(
+        "SELECT coalesce(md5(string_agg(row(filter, labels, actions, "
+        "contingent, categories, rule_id, track, label)::text, E'\\n' "
+        "ORDER BY rule_id, filter)), '') FROM match_filters;"));
+    if (matcher::shared().is_ready() && checksum == _match_filters_checksum) {
+      REL_TRACE("match_filters unchanged, checksum {}", checksum);
+      _last_match_filter_refresh = std::chrono::steady_clock::now();
+      return;
+    }
     bool load_failed(false);
     matcher replacement;
+    replacement.reuse_rules_from(matcher::shared());
     for (auto [filter, labels, actions, contingent, categories, rule_id, track,
                label] :
          tx.query<std::string, std::string, std::string,
@@ -179,9 +194,14 @@ void auxiliary_data::update_match_filters() {
     }
 
     if (!load_failed) {
+      // automaton built before taking the lock
+      replacement.publish();
+      REL_INFO("match_filters refreshed, {} rules reused, checksum {}",
+               replacement.reused_rules(), checksum);
       // switch replacement rules into the main matcher
       std::lock_guard guard(_lock);
       matcher::shared().refresh_rules(std::move(replacement));
+      _match_filters_checksum = checksum;
       _last_match_filter_refresh = std::chrono::steady_clock::now();
     }
   }
@@ -215,10 +235,10 @@ void auxiliary_data::update_blacklisted_accounts() {
       BlacklistedAccountsRefreshInterval) {
     pqxx::work tx(*_cx);
     bool load_failed(false);
-    std::unordered_set<std::string> new_blacklist;
+    std::unordered_set<bsky::did> new_blacklist;
     for (auto [did] :
          tx.query<std::string>("SELECT did FROM blacklisted_accounts;")) {
-      new_blacklist.insert(did);
+      new_blacklist.emplace(did);
     }
 
     if (!load_failed) {
@@ -236,10 +256,10 @@ void auxiliary_data::update_whitelisted_accounts() {
       WhitelistedAccountsRefreshInterval) {
     pqxx::work tx(*_cx);
     bool load_failed(false);
-    std::unordered_set<std::string> new_whitelist;
+    std::unordered_set<bsky::did> new_whitelist;
     for (auto [did] :
          tx.query<std::string>("SELECT did FROM whitelisted_accounts;")) {
-      new_whitelist.insert(did);
+      new_whitelist.emplace(did);
     }
 
     if (!load_failed) {
@@ -257,10 +277,10 @@ void auxiliary_data::update_ignored_accounts() {
       IgnoredAccountsRefreshInterval) {
     pqxx::work tx(*_cx);
     bool load_failed(false);
-    std::unordered_set<std::string> new_ignored;
+    std::unordered_set<bsky::did> new_ignored;
     for (auto [did] :
          tx.query<std::string>("SELECT did FROM ignored_accounts;")) {
-      new_ignored.insert(did);
+      new_ignored.emplace(did);
     }
 
     if (!load_failed) {
@@ -39,7 +39,8 @@ embed_checker &embed_checker::instance() {
 }
 
 embed_checker::embed_checker()
-    : _queue(QueueLimit), _observed_hosts(MaxHosts) {}
+    : _queue(QueueLimit, {{"embed_checker", "backlog"}}),
+      _observed_hosts(MaxHosts) {}
 
 void embed_checker::set_config(YAML::Node const &settings) {
   _follow_links = settings["follow_links"].as<bool>();
@@ -83,11 +84,6 @@ void embed_checker::start() {
           embed::embed_info_list embed_list;
           _queue.wait_dequeue(embed_list);
           // process the item
-          metrics_factory::instance()
-              .get_gauge("process_operation")
-              .Get({{"embed_checker", "backlog"}})
-              .Decrement();
-
           // TODO the work
           // add LFU cache of URL/did/rate-limit pairs
           // add LFU cache of content-cid/did/rate-limit
@@ -114,11 +110,7 @@ void embed_checker::start() {
 }
 
 void embed_checker::wait_enqueue(embed::embed_info_list &&value) {
-  _queue.enqueue(value);
-  metrics_factory::instance()
-      .get_gauge("process_operation")
-      .Get({{"embed_checker", "backlog"}})
-      .Increment();
+  _queue.enqueue(std::move(value));
 }
 
 void embed_checker::refresh_hosts(std::unordered_set<std::string> &&new_hosts) {
@@ -145,7 +137,7 @@ void embed_checker::refresh_hosts(std::unordered_set<std::string> &&new_hosts) {
 }
 
 void embed_checker::image_seen(std::string const &repo, std::string const &path,
-                               std::string const &cid) {
+                               atproto::cid const &cid) {
   // return true if insert fails, we already know this one
   metrics_factory::instance()
       .get_counter("embedded_content")
@@ -156,7 +148,7 @@ void embed_checker::image_seen(std::string const &repo, std::string const &path,
   if (!inserted.second) {
     if (alert_needed(++(inserted.first->second), ImageFactor)) {
       REL_INFO("Image repetition count {:6} {} at {}/{}",
-               inserted.first->second, cid, repo, path);
+               inserted.first->second, cid.to_string(), repo, path);
       metrics_factory::instance()
           .get_counter("embedded_content")
           .Get({{"images", "repetition"}})
@@ -409,7 +401,7 @@ bool embed_handler::on_url_redirect(int code, std::string &url,
 }
 
 void embed_checker::video_seen(std::string const &repo, std::string const &path,
-                               std::string const &cid) {
+                               atproto::cid const &cid) {
   // return true if insert fails, we already know this one
   metrics_factory::instance()
       .get_counter("embedded_content")
@@ -420,7 +412,7 @@ void embed_checker::video_seen(std::string const &repo, std::string const &path,
   if (!inserted.second) {
     if (alert_needed(++(inserted.first->second), VideoFactor)) {
       REL_INFO("Video repetition count {:6} {} at {}/{}",
-               inserted.first->second, cid, repo, path);
+               inserted.first->second, cid.to_string(), repo, path);
       metrics_factory::instance()
           .get_counter("embedded_content")
           .Get({{"videos", "repetition"}})
@@ -27,12 +27,29 @@ http://www.fsf.org/licensing/licenses
 
 std::shared_ptr<config> parser::_settings;
 
+namespace {
+// JSON pointer strings are resolved once, lookup is then in-situ
+std::map<std::string_view, std::vector<std::string>> const &field_pointers() {
+  static const std::map<std::string_view, std::vector<std::string>> pointers(
+      [] {
+        std::map<std::string_view, std::vector<std::string>> result;
+        for (auto const &record_fields : json::TargetFieldNames) {
+          auto &fields(result[record_fields.first]);
+          for (auto const &field_name : record_fields.second) {
+            fields.emplace_back(field_name.to_string());
+          }
+        }
+        return result;
+      }());
+  return pointers;
+}
+} // namespace
+
 // Extract UTF-8 string containing the material to be checked,  which is
 // context-dependent
 candidate_list
 parser::get_candidates_from_string(std::string const &full_content) const {
-  nlohmann::json full_json(nlohmann::json::parse(full_content));
-  return get_candidates_from_json(full_json);
+  return get_candidates_from_jetstream(full_content);
 }
 
 candidate_list
@@ -45,12 +62,14 @@ parser::get_candidates_from_flat_buffer(beast::flat_buffer const &beast_data) {
     }
     return {};
   } else {
-    nlohmann::json full_json(
-        nlohmann::json::parse(buffers_begin(buffer), buffers_end(buffer)));
-    return get_candidates_from_json(full_json);
+    return get_candidates_from_jetstream(std::string_view(
+        static_cast<const char *>(buffer.data()), buffer.size()));
   }
 }
 
+// String fields are passed on as their contents, other values as JSON text.
+// Every overload does the same, so a record matches alike however it was
+// read.
 candidate_list
 parser::get_candidates_from_record(nlohmann::json const &record) {
   auto record_type(record["$type"].template get<std::string>());
@@ -58,9 +77,32 @@ parser::get_candidates_from_record(nlohmann::json const &record) {
   candidate_list results;
   if (record_fields != json::TargetFieldNames.cend()) {
     for (auto &field_name : record_fields->second) {
-      if (record.contains(field_name)) {
-        results.emplace_back(record_type, field_name.to_string(),
-                             nlohmann::to_string(record[field_name]));
+      if (!record.contains(field_name))
+        continue;
+      nlohmann::json const &field(record[field_name]);
+      results.emplace_back(record_type, field_name.to_string(),
+                           field.is_string() ? field.get<std::string>()
+                                             : nlohmann::to_string(field));
+    }
+  }
+
+  return results;
+}
+
+candidate_list
+parser::get_candidates_from_record(dag_cbor::value const &record) {
+  std::string_view record_type(record["$type"].as_text());
+  auto const record_fields(field_pointers().find(record_type));
+  candidate_list results;
+  if (record_fields != field_pointers().cend()) {
+    for (auto const &field_name : record_fields->second) {
+      dag_cbor::value field(record.at_pointer(field_name));
+      if (field.is_text()) {
+        results.emplace_back(std::string(record_type), field_name,
+                             std::string(field.as_text()));
+      } else if (field.is_valid()) {
+        results.emplace_back(std::string(record_type), field_name,
+                             dag_cbor::dump(field));
       }
     }
   }
@@ -68,7 +110,62 @@ parser::get_candidates_from_record(nlohmann::json const &record) {
   return results;
 }
 
-// TODO Could use SAX parsing down the line
+candidate_list
+parser::get_candidates_from_record(json_scan::value const &record) {
+  std::string type_scratch;
+  std::string_view record_type(record["$type"].as_text(type_scratch));
+  std::string scratch;
+  auto const record_fields(field_pointers().find(record_type));
+  candidate_list results;
+  if (record_fields != field_pointers().cend()) {
+    for (auto const &field_name : record_fields->second) {
+      json_scan::value field(record.at_pointer(field_name));
+      if (field.is_text()) {
+        results.emplace_back(std::string(record_type), field_name,
+                             std::string(field.as_text(scratch)));
+      } else if (field.is_valid()) {
+        results.emplace_back(std::string(record_type), field_name,
+                             std::string(field.raw()));
+      }
+    }
+  }
+  return results;
+}
+
+candidate_list parser::get_candidates_from_jetstream(std::string_view event) {
+  try {
+    json_scan::value message(event);
+    json_scan::value kind(message["kind"]);
+    // handle updates
+    if (kind == "identity") {
+      json_scan::value handle(message["identity"]["handle"]);
+      if (handle.is_text()) {
+        std::string scratch;
+        return {{"identity", "handle", std::string(handle.as_text(scratch))}};
+      }
+      return {};
+    }
+
+    // other than handles, only interested in commits
+    if (kind != "commit")
+      return {};
+
+    json_scan::value commit(message["commit"]);
+    // Skip deletions
+    if (commit["operation"] == "delete")
+      return {};
+
+    json_scan::value record(commit["record"]);
+    if (!record.is_object())
+      return {};
+    return get_candidates_from_record(record);
+  } catch (std::exception const &exc) {
+    REL_ERROR("Error {} processing JSON\n{}", exc.what(), event);
+  }
+  return {};
+}
+
+// DOM for callers that already hold one
 candidate_list
 parser::get_candidates_from_json(nlohmann::json &full_json) const {
   // Handle exceptions as they come up.
@@ -108,9 +205,11 @@ inline bool parser::cbor_callback(int /* depth */,
     // Check for "roots" and decode embedded CIDs is found
     if (parsed.contains("roots")) {
       DBG_TRACE("JSON roots  {}", parsed.dump());
-    } else if (parsed.contains("__readable_cid__")) {
+    } else if (parsed.contains("__binary_cid__")) {
       // DBG_TRACE("JSON block cid {}", parsed.dump());
-      _block_cid = parsed["__readable_cid__"].template get<std::string>();
+      auto const &binary(parsed["__binary_cid__"]
+                             .template get_ref<nlohmann::json::binary_t &>());
+      _block_cid = atproto::cid(binary);
     } else {
       DBG_TRACE("JSON Result  {}", parsed.dump());
       if (parsed.contains("$type")) {
@@ -126,7 +225,7 @@ inline bool parser::cbor_callback(int /* depth */,
           // block may contains string-matching content
           if (!_cids.insert(_block_cid).second) {
             REL_ERROR("Matchable Block CID {} already stored, block={}",
-                      _block_cid, parsed.dump());
+                      _block_cid.to_string(), parsed.dump());
             return false;
           }
           _matchable_cbors.emplace_back(_block_cid, std::move(parsed));
@@ -134,7 +233,7 @@ inline bool parser::cbor_callback(int /* depth */,
           // Also store other typed CBORs.
           if (!_cids.insert(_block_cid).second) {
             REL_ERROR("Content Block CID {} already stored, block={}",
-                      _block_cid, parsed.dump());
+                      _block_cid.to_string(), parsed.dump());
             return false;
           }
           _content_cbors.emplace_back(_block_cid, std::move(parsed));
@@ -20,8 +20,6 @@ http://www.fsf.org/licensing/licenses
 
 #include "payload.hpp"
 
-#include <multiformats/cid.hpp>
-
 #include "common/activity/account_events.hpp"
 #include "common/activity/event_recorder.hpp"
 #include "common/moderation/ozone_adapter.hpp"
@@ -29,12 +27,75 @@ http://www.fsf.org/licensing/licenses
 #include "moderation/auxiliary_data.hpp"
 #include "moderation/embed_checker.hpp"
 #include "parser.hpp"
-#include "payload.hpp"
+#include "recent_window.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <iterator>
 
 jetstream_payload::jetstream_payload() {}
-jetstream_payload::jetstream_payload(std::string json_msg,
-                                     match_results matches)
-    : _json_msg(json_msg), _matches(matches) {}
+jetstream_payload::jetstream_payload(pooled_buffer &&frame,
+                                     match_results &&matches)
+    : _frame(std::move(frame)), _matches(std::move(matches)) {}
+
+int64_t jetstream_payload::sequence_of(std::span<const uint8_t> frame) {
+  // jetstream cursor is the event's time_us, a top-level field
+  constexpr std::string_view TimeField = "\"time_us\":";
+  std::string_view json(reinterpret_cast<const char *>(frame.data()),
+                        frame.size());
+  size_t found(json.find(TimeField));
+  if (found == std::string_view::npos)
+    return -1;
+  int64_t time_us(-1);
+  const char *start(json.data() + found + TimeField.size());
+  std::from_chars(start, json.data() + json.size(), time_us);
+  return time_us;
+}
+
+uint64_t jetstream_payload::event_key_of(std::span<const uint8_t> frame) {
+  // A commit is its repo's rev. Identity and account events carry the time
+  // the repo's host emitted them, the same from every relay.
+  try {
+    json_scan::value event(std::string_view(
+        reinterpret_cast<const char *>(frame.data()), frame.size()));
+    json_scan::value kind(event["kind"]);
+    json_scan::value did(event["did"]);
+    if (!kind.is_text() || !did.is_text())
+      return 0;
+    std::string kind_scratch;
+    std::string_view kind_text(kind.as_text(kind_scratch));
+    json_scan::value order(kind == "commit"
+                               ? event["commit"]["rev"]
+                               : event[kind_text]["time"]);
+    if (!order.is_text())
+      return 0;
+    std::string did_scratch;
+    std::string order_scratch;
+    return recent_window::key_of({kind_text, did.as_text(did_scratch),
+                                  order.as_text(order_scratch)});
+  } catch (json_scan::scan_error const &) {
+    // handled regardless, parsing reports the error
+  }
+  return 0;
+}
+
+frame_value jetstream_payload::value_of(std::span<const uint8_t> frame) {
+  try {
+    json_scan::value event(std::string_view(
+        reinterpret_cast<const char *>(frame.data()), frame.size()));
+    if (event["kind"] != "commit")
+      return frame_value::essential;
+    json_scan::value collection(event["commit"]["collection"]);
+    std::string scratch;
+    if (collection.is_text() &&
+        firehose::is_statistics_only(collection.as_text(scratch))) {
+      return frame_value::statistics;
+    }
+  } catch (json_scan::scan_error const &) {
+    // handled regardless, parsing reports the error
+  }
+  return frame_value::essential;
+}
 
 void jetstream_payload::handle(post_processor<jetstream_payload> &) {
   // TODO almost identical to jetstream_payload::handle
@@ -44,12 +105,11 @@ void jetstream_payload::handle(post_processor<jetstream_payload> &) {
     // desired strings
     REL_INFO("Candidate {}|{}|{}\nmatches {}\non message:{}",
              result._candidate._type, result._candidate._field,
-             result._candidate._value, result._matches, _json_msg);
-    for (auto const &match : result._matches) {
-      prometheus::Labels labels(
-          {{"type", result._candidate._type},
-           {"field", result._candidate._field},
-           {"filter", wstring_to_utf8(match.get_keyword())}});
+             result._candidate._value, result.filters(), _frame.text());
+    for (const rule_id match : result._matches) {
+      prometheus::Labels labels({{"type", result._candidate._type},
+                                 {"field", result._candidate._field},
+                                 {"filter", result._rules->filter(match)}});
       metrics_factory::instance()
           .get_counter("message_string_matches")
           .Get(labels)
@@ -58,25 +118,166 @@ void jetstream_payload::handle(post_processor<jetstream_payload> &) {
   }
 }
 
+namespace {
+inline std::string text_of(dag_cbor::value const &item) {
+  return std::string(item.as_text());
+}
+
+inline bool same_cid(atproto::cid const &lhs, dag_cbor::bytes_view rhs) {
+  return std::ranges::equal(lhs.bytes(), rhs);
+}
+
+// repo path for an op that created or updated a record
+struct op_path {
+  atproto::cid _cid;
+  std::string _path;
+  firehose::field_plan _plan;
+  bsky::tracked_event _event_type;
+  bool _decoded;
+};
+
+// fully decoded record from the CAR blocks
+struct record_block {
+  atproto::cid _cid;
+  dag_cbor::value _content;
+  std::string const *_path;
+  bool _matchable;
+};
+
+std::string dump_records(std::vector<record_block> const &records,
+                         const bool matchable) {
+  bool first(true);
+  std::ostringstream oss;
+  for (auto const &record : records) {
+    if (record._matchable != matchable)
+      continue;
+    if (!first) {
+      oss << '\n';
+    }
+    first = false;
+    oss << dag_cbor::dump(record._content);
+  }
+  return oss.str();
+}
+} // namespace
+
 firehose_payload::firehose_payload() {}
-firehose_payload::firehose_payload(parser &my_parser)
-    : _parser(std::move(my_parser)) {}
+firehose_payload::firehose_payload(pooled_buffer &&frame,
+                                   const bool tracks_cursor)
+    : _frame(std::move(frame)), _tracks_cursor(tracks_cursor) {}
 
-void firehose_payload::handle(post_processor<firehose_payload> &processor) {
-  auto const &other_cbors(_parser.other_cbors());
-  if (other_cbors.size() != 2) {
+std::string firehose_payload::to_string() const {
+  try {
+    dag_cbor::frame frame{_frame.bytes()};
+    std::ostringstream oss;
+    oss << "header (" << dag_cbor::dump(frame._header) << ") message ("
+        << dag_cbor::dump(frame._message) << ')';
+    return oss.str();
+  } catch (dag_cbor::decode_error const &exc) {
     std::ostringstream oss;
-    for (auto const &cbor : _parser.other_cbors()) {
-      oss << cbor.second.dump();
+    oss << "undecodable frame (" << exc.what() << ") " << std::hex;
+    auto os_iter = std::ostream_iterator<int>(oss);
+    std::ranges::copy(_frame.bytes(), os_iter);
+    return oss.str();
+  }
+}
+
+int64_t firehose_payload::sequence_of(std::span<const uint8_t> frame) {
+  try {
+    dag_cbor::frame decoded{frame};
+    dag_cbor::value seq(decoded._message["seq"]);
+    if (decoded._header["op"].is_integer() &&
+        decoded._header["op"].as_integer() ==
+            static_cast<int>(firehose::op::message) &&
+        seq.is_integer()) {
+      return seq.as_integer();
     }
-    REL_ERROR("Malformed firehose message {}", oss.str());
+  } catch (dag_cbor::decode_error const &) {
+    // recorded regardless, it just cannot be indexed
+  }
+  return -1;
+}
+
+void firehose_payload::save_rewind_point(const int64_t seq,
+                                         std::span<const uint8_t> frame) {
+  std::string emitted_at;
+  try {
+    dag_cbor::frame decoded{frame};
+    emitted_at = text_of(decoded._message["time"]);
+  } catch (dag_cbor::decode_error const &) {
+    // the seq is still good, checkpoints wait for a frame with a time
+  }
+  bsky::moderation::auxiliary_data::instance().update_rewind_point(
+      seq, emitted_at);
+}
+
+uint64_t firehose_payload::event_key_of(std::span<const uint8_t> frame) {
+  // A commit or sync is its repo's rev. Identity, account and the older
+  // event types carry the time the repo's host emitted them, the same from
+  // every relay. #info has no repo and is not keyed.
+  try {
+    dag_cbor::frame decoded{frame};
+    dag_cbor::value op_type(decoded._header["t"]);
+    if (!op_type.is_text())
+      return 0;
+    dag_cbor::value did(decoded._message["repo"]);
+    if (!did.is_text()) {
+      did = decoded._message["did"];
+    }
+    dag_cbor::value order(decoded._message["rev"]);
+    if (!order.is_text()) {
+      order = decoded._message["time"];
+    }
+    if (did.is_text() && order.is_text()) {
+      return recent_window::key_of(
+          {op_type.as_text(), did.as_text(), order.as_text()});
+    }
+  } catch (dag_cbor::decode_error const &) {
+    // handled regardless, decode reports the error
+  }
+  return 0;
+}
+
+frame_value firehose_payload::value_of(std::span<const uint8_t> frame) {
+  try {
+    dag_cbor::frame decoded{frame};
+    dag_cbor::value op_type(decoded._header["t"]);
+    if (!op_type.is_text() || op_type.as_text() != firehose::OpTypeCommit)
+      return frame_value::essential;
+    // a commit is worth what its most valuable op is
+    bool has_ops(false);
+    for (auto const &oper : decoded._message["ops"].items()) {
+      dag_cbor::value path(oper["path"]);
+      if (!path.is_text())
+        return frame_value::essential;
+      std::string_view collection(path.as_text());
+      collection = collection.substr(0, collection.find('/'));
+      if (!firehose::is_statistics_only(collection))
+        return frame_value::essential;
+      has_ops = true;
+    }
+    if (has_ops)
+      return frame_value::statistics;
+  } catch (dag_cbor::decode_error const &) {
+    // handled regardless, decode reports the error
+  }
+  return frame_value::essential;
+}
+
+void firehose_payload::decode() {
+  _decoded = true;
+  dag_cbor::bytes_view raw(_frame.bytes());
+  dag_cbor::frame frame{raw};
+  auto const &header(frame._header);
+  auto const &message(frame._message);
+  if (!header.is_map() || !message.is_map() ||
+      message.end() != raw.data() + raw.size()) {
+    REL_ERROR("Malformed firehose message {}", to_string());
     return;
   }
-  auto const &header(other_cbors.front().second);
-  auto const &message(other_cbors.back().second);
-  REL_DEBUG("Firehose header:  {}", dump_json(header));
-  REL_DEBUG("         message: {}", dump_json(message));
-  int op(header["op"].template get<int>());
+  REL_DEBUG("Firehose header:  {}", dag_cbor::dump(header));
+  REL_DEBUG("         message: {}", dag_cbor::dump(message));
+  int64_t op(header["op"].as_integer());
   if (op == static_cast<int>(firehose::op::error)) {
     metrics_factory::instance()
         .get_counter("firehose_content")
@@ -87,32 +288,25 @@ void firehose_payload::handle(post_processor<firehose_payload> &processor) {
         .get_counter("firehose_content")
         .Get({{"op", "message"}})
         .Increment();
-    std::string op_type(header["t"].template get<std::string>());
+    _op_type = text_of(header["t"]);
+    std::string const &op_type(_op_type);
     metrics_factory::instance()
         .get_counter("firehose_content")
         .Get({{"op", "message"}, {"type", op_type}})
         .Increment();
-    std::string repo;
-    parser block_parser;
+    std::string &repo(_repo);
+    std::vector<record_block> records;
     if (op_type == firehose::OpTypeCommit) {
-      repo = message["repo"].template get<std::string>();
-      if (message.contains("blocks")) {
-        // CAR file - nested in-situ parse to extract as JSON
-        auto blocks(message["blocks"].template get<nlohmann::json::binary_t>());
-        bool parsed(block_parser.json_from_car(blocks.cbegin(), blocks.cend()));
-        if (parsed) {
-          DBG_DEBUG("Commit content blocks: {}",
-                    block_parser.dump_parse_content());
-          DBG_DEBUG("Commit other blocks: {}", block_parser.dump_parse_other());
-        } else {
-          // TODO error handling
-        }
-      }
-      for (auto const &oper : message["ops"]) {
+      repo = text_of(message["repo"]);
+      // ops come first, they determine which blocks need decoding
+      std::vector<op_path> paths;
+      for (auto const &oper : message["ops"].items()) {
         size_t count = 0;
-        auto path(oper["path"].template get<std::string>());
-        auto kind(oper["action"].template get<std::string>());
+        std::string path(text_of(oper["path"]));
+        std::string kind(text_of(oper["action"]));
         firehose::op_kind oper_kind(firehose::op_kind_from_string(kind));
+        firehose::field_plan plan(firehose::field_plan::none);
+        bsky::tracked_event event_type(bsky::tracked_event::invalid);
         for (const auto token : std::views::split(path, '/')) {
           // with string_view's C++23 range constructor:
           std::string field(token.cbegin(), token.cend());
@@ -128,6 +322,8 @@ void firehose_payload::handle(post_processor<firehose_payload> &processor) {
                         {"collection", field},
                         {"kind", kind}})
                   .Increment();
+              plan = firehose::field_plan_for_collection(field);
+              event_type = bsky::event_type_from_collection(field);
               break;
             case 1:
               if (field.empty())
@@ -138,67 +334,100 @@ void firehose_payload::handle(post_processor<firehose_payload> &processor) {
         }
         // track deletions
         if (oper_kind == firehose::op_kind::delete_) {
-          processor.request_recording(
-              {repo,
-               bsky::time_stamp_from_iso_8601(
-                   message["time"].template get<std::string>()),
+          record(
+              {repo, bsky::time_stamp_from_iso_8601(message["time"].as_text()),
                activity::deleted(path)});
-        } else if (oper.contains("cid") && !oper["cid"].is_null()) {
-          auto cid(oper["cid"].template get<nlohmann::json::binary_t>());
+        } else if (oper["cid"].is_cid()) {
           try {
-            // nlhomann parser gives us a leading zero
-            atproto::cid_decoder decoder(cid.cbegin() + 1, cid.cend());
-            std::string friendly_cid(decoder.as_string());
-            auto insertion(_path_by_cid.insert({friendly_cid, path}));
-            if (!insertion.second) {
+            atproto::cid cid(oper["cid"].as_cid());
+            auto existing(
+                std::ranges::find_if(paths, [&](op_path const &prior) {
+                  return prior._cid == cid;
+                }));
+            if (existing != paths.cend()) {
               // We see this for Block operations very rarely. Log to try to
               // track it down
               REL_ERROR(
                   "Duplicate cid {} at op.path {}, already used for path {}",
-                  friendly_cid, path, insertion.first->second);
-              REL_ERROR("Firehose header:  {}", dump_json(header));
-              REL_ERROR("         message: {}", dump_json(message));
-              REL_ERROR("Content CBORs:  {}",
-                        block_parser.dump_parse_content());
-              REL_ERROR("Matched CBORs:  {}",
-                        block_parser.dump_parse_matched());
-              REL_ERROR("Other CBORs:    {}", block_parser.dump_parse_other());
+                  cid.to_string(), path, existing->_path);
+              REL_ERROR("Firehose header:  {}", dag_cbor::dump(header));
+              REL_ERROR("         message: {}", dag_cbor::dump(message));
+            } else {
+              paths.emplace_back(cid, path, plan, event_type, false);
             }
           } catch (std::exception const &exc) {
             REL_ERROR("CID parse error {} in message {}", exc.what(),
-                      dump_json(message));
+                      dag_cbor::dump(message));
           }
         }
       }
-      // handle all the CBORs with content, metrics, checking
-      for (auto const &content_cbor : block_parser.content_cbors()) {
-        handle_content(processor, repo, content_cbor.first,
-                       content_cbor.second);
+      dag_cbor::value blocks(message["blocks"]);
+      if (blocks.is_bytes() && !paths.empty()) {
+        // CAR file - walk the blocks in-situ. MST nodes, the signed commit
+        // and records we do not track are skipped without decoding.
+        dag_cbor::car_reader car(blocks.as_bytes());
+        dag_cbor::car_reader::block block;
+        while (car.next(block)) {
+          auto op(std::ranges::find_if(paths, [&](op_path const &candidate) {
+            return same_cid(candidate._cid, block._cid);
+          }));
+          if (op == paths.end() || op->_plan == firehose::field_plan::none)
+            continue;
+          if (op->_decoded) {
+            REL_ERROR("Record block CID {} already stored, path={}",
+                      op->_cid.to_string(), op->_path);
+            continue;
+          }
+          op->_decoded = true;
+          dag_cbor::value content(block.content());
+          if (op->_plan == firehose::field_plan::subject) {
+            handle_subject(repo, op->_path, op->_event_type, content);
+            continue;
+          }
+          dag_cbor::value record_type(content["$type"]);
+          if (!record_type.is_text()) {
+            REL_ERROR("Untyped record at {}, block={}", op->_path,
+                      dag_cbor::dump(content));
+            continue;
+          }
+          // record may contain string-matching content
+          records.emplace_back(
+              op->_cid, content, &op->_path,
+              json::TargetFieldNames.contains(record_type.as_text()));
+        }
+        DBG_DEBUG("Commit content blocks: {}", dump_records(records, false));
+        DBG_DEBUG("Commit matchable blocks: {}", dump_records(records, true));
+      }
+      // handle all the records with content, metrics, checking
+      for (auto const &record : records) {
+        if (!record._matchable) {
+          handle_content(repo, *record._path, record._cid, record._content);
+        }
       }
-      for (auto const &matchable_cbor : block_parser.matchable_cbors()) {
-        handle_matchable_content(processor, repo, matchable_cbor.first,
-                                 matchable_cbor.second);
+      for (auto const &record : records) {
+        if (record._matchable) {
+          handle_matchable_content(repo, *record._path, record._cid,
+                                   record._content);
+        }
       }
     } else if (op_type == firehose::OpTypeIdentity ||
                op_type == firehose::OpTypeHandle) {
-      repo = message["did"].template get<std::string>();
-      if (message.contains("handle")) {
-        std::string handle(message["handle"].template get<std::string>());
+      repo = text_of(message["did"]);
+      if (message["handle"].is_text()) {
+        std::string handle(text_of(message["handle"]));
         _path_candidates.emplace_back(path_candidates{
             std::string(matcher::HandleSentinel),  // path
             std::string(matcher::HandleSentinel),  // cid
             {{op_type, std::string(matcher::HandleSentinel), handle}}});
-        processor.request_recording(
-            {repo,
-             bsky::time_stamp_from_iso_8601(
-                 message["time"].template get<std::string>()),
+        record(
+            {repo, bsky::time_stamp_from_iso_8601(message["time"].as_text()),
              activity::handle(handle)});
-        activity::event_recorder::instance().update_handle(repo, handle);
+        _handle = handle;
       }
-      REL_INFO("{} {}", op_type.c_str(), dump_json(message));
+      REL_INFO("{} {}", op_type.c_str(), dag_cbor::dump(message));
     } else if (op_type == firehose::OpTypeAccount) {
-      repo = message["did"].template get<std::string>();
-      bool active(message["active"].template get<bool>());
+      repo = text_of(message["did"]);
+      bool active(message["active"].as_bool());
       metrics_factory::instance()
           .get_counter("firehose_content")
           .Get({{"op", "message"},
@@ -206,101 +435,122 @@ void firehose_payload::handle(post_processor<firehose_payload> &processor) {
                 {"status", active ? "active" : "inactive"}})
           .Increment();
       if (active) {
-        processor.request_recording(
-            {repo,
-             bsky::time_stamp_from_iso_8601(
-                 message["time"].template get<std::string>()),
+        record(
+            {repo, bsky::time_stamp_from_iso_8601(message["time"].as_text()),
              activity::active()});
-      } else if (message.contains("status")) {
-        processor.request_recording(
-            {repo,
-             bsky::time_stamp_from_iso_8601(
-                 message["time"].template get<std::string>()),
-             activity::inactive(bsky::down_reason_from_string(
-                 message["status"].template get<std::string>()))});
+      } else if (message["status"].is_text()) {
+        record(
+            {repo, bsky::time_stamp_from_iso_8601(message["time"].as_text()),
+             activity::inactive(
+                 bsky::down_reason_from_string(text_of(message["status"])))});
       } else {
-        processor.request_recording(
-            {repo,
-             bsky::time_stamp_from_iso_8601(
-                 message["time"].template get<std::string>()),
+        record(
+            {repo, bsky::time_stamp_from_iso_8601(message["time"].as_text()),
              activity::inactive(bsky::down_reason::unknown)});
       }
-      REL_INFO("{} {}", op_type.c_str(), dump_json(message));
+      REL_INFO("{} {}", op_type.c_str(), dag_cbor::dump(message));
     } else if (op_type == firehose::OpTypeTombstone) {
-      repo = message["did"].template get<std::string>();
-      processor.request_recording(
-          {repo,
-           bsky::time_stamp_from_iso_8601(
-               message["time"].template get<std::string>()),
+      repo = text_of(message["did"]);
+      record(
+          {repo, bsky::time_stamp_from_iso_8601(message["time"].as_text()),
            activity::inactive(bsky::down_reason::tombstone)});
-      REL_INFO("{} {}", op_type.c_str(), dump_json(message));
+      REL_INFO("{} {}", op_type.c_str(), dag_cbor::dump(message));
     } else if (op_type == firehose::OpTypeMigrate ||
                op_type == firehose::OpTypeInfo) {
       // no-op
     }
-    REL_TRACE("{} {}", header.dump(), message.dump());
+    REL_TRACE("{} {}", dag_cbor::dump(header), dag_cbor::dump(message));
     if (!_path_candidates.empty()) {
-      auto matches(
-          matcher::shared().all_matches_for_path_candidates(_path_candidates));
-      if (!matches.empty()) {
-        // track/retrieve account info
-        auto handle(activity::event_recorder::instance().ensure_loaded(repo));
-        // Publish metrics for matches
-        size_t count(0);
-        for (auto const &result : matches) {
-          for (auto const &next_match : result._matches) {
-            // this is the substring of the full JSON that matched one or more
-            // desired strings
-            // start tracking this account if not already
-            REL_INFO("{}/{}/{} matched candidate {}|{}|{}", next_match._matches,
-                     repo, handle, next_match._candidate._type,
-                     next_match._candidate._field,
-                     next_match._candidate._value);
-            count += next_match._matches.size();
-            for (auto const &match : next_match._matches) {
-              prometheus::Labels labels(
-                  {{"type", next_match._candidate._type},
-                   {"field", next_match._candidate._field},
-                   {"filter", wstring_to_utf8(match.get_keyword())}});
-              metrics_factory::instance()
-                  .get_counter("message_string_matches")
-                  .Get(labels)
-                  .Increment();
-            }
-          }
-        }
-        // only log message once - might be interleaved with other thread output
-        if (op_type == firehose::OpTypeCommit) {
-          // curate a smaller version of the full message for correlation
-          REL_INFO("in message: {} {} {}", repo, dump_json(message["ops"]),
-                   block_parser.dump_parse_content());
-        } else {
-          REL_INFO("in message: {} {}", repo, dump_json(message));
-        }
-        // record suspect activity as a special-case event
-        processor.request_recording(
-            {repo, bsky::current_time(), activity::matches(count)});
-
-        // forward account and its matched records for possible auto-moderation
-        action_router::instance().wait_enqueue({repo, std::move(matches)});
+      _matches =
+          matcher::shared().all_matches_for_path_candidates(_path_candidates);
+      if (!_matches.empty()) {
+        // curate a smaller version of the full message for correlation
+        _match_context = op_type == firehose::OpTypeCommit
+                             ? dag_cbor::dump(message["ops"]) + ' ' +
+                                   dump_records(records, false)
+                             : dag_cbor::dump(message);
       }
     }
-    // update last-seen sequence number
     if (op_type != firehose::OpTypeInfo) {
-      int64_t seq(message["seq"].template get<int64_t>());
-      std::string emitted_at(message["time"].template get<std::string>());
+      _seq = message["seq"].as_integer();
+      _emitted_at = text_of(message["time"]);
+    }
+  }
+}
+
+void firehose_payload::handle(post_processor<firehose_payload> &processor) {
+  if (!_decoded) {
+    decode();
+  }
+  // Side effects that depend on message order happen here, on the
+  // post-processor thread, after any parallel decode
+  if (!_handle.empty()) {
+    activity::event_recorder::instance().update_handle(_repo, _handle);
+  }
+  processor.request_recordings(_recordings);
+  for (auto &embeds : _embed_checks) {
+    bsky::moderation::embed_checker::instance().wait_enqueue(
+        std::move(embeds));
+  }
+  if (!_matches.empty()) {
+    // track/retrieve account info
+    auto handle(activity::event_recorder::instance().ensure_loaded(_repo));
+    // Publish metrics for matches
+    size_t count(0);
+    for (auto const &result : _matches) {
+      for (auto const &next_match : result._matches) {
+        // this is the substring of the full JSON that matched one or more
+        // desired strings
+        // start tracking this account if not already
+        REL_INFO("{}/{}/{} matched candidate {}|{}|{}", next_match.filters(),
+                 _repo, handle, next_match._candidate._type,
+                 next_match._candidate._field, next_match._candidate._value);
+        count += next_match._matches.size();
+        for (const rule_id match : next_match._matches) {
+          prometheus::Labels labels(
+              {{"type", next_match._candidate._type},
+               {"field", next_match._candidate._field},
+               {"filter", next_match._rules->filter(match)}});
+          metrics_factory::instance()
+              .get_counter("message_string_matches")
+              .Get(labels)
+              .Increment();
+        }
+      }
+    }
+    // only log message once - might be interleaved with other thread output
+    REL_INFO("in message: {} {}", _repo, _match_context);
+    // record suspect activity as a special-case event
+    processor.request_recording(
+        {_repo, bsky::current_time(), activity::matches(count)});
+
+    // forward account and its matched records for possible auto-moderation
+    action_router::instance().wait_enqueue({_repo, std::move(_matches)});
+  }
+  // update last-seen sequence number, seq is only comparable within a relay
+  if (_seq >= 0) {
+    if (_tracks_cursor) {
       bsky::moderation::auxiliary_data::instance().update_rewind_point(
-          seq, emitted_at);
+          _seq, _emitted_at);
     }
+    // time in the client, plus any relay lag or clock skew
+    static prometheus::Histogram &ingest_latency(
+        metrics_factory::instance()
+            .get_histogram("firehose_ingest_latency")
+            .Add({{"stage", "post_processor"}},
+                 prometheus::Histogram::BucketBoundaries{
+                     1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 500.0,
+                     1000.0, 2000.0, 5000.0, 10000.0, 30000.0, 60000.0}));
+    ingest_latency.Observe(static_cast<double>(
+        (bsky::current_time() - bsky::time_stamp_from_iso_8601(_emitted_at))
+            .count()));
   }
 }
 
-bsky::embed_type firehose_payload::context::process_embed(
-    nlohmann::json const &embed) {
+bsky::embed_type
+firehose_payload::context::process_embed(dag_cbor::value const &embed) {
   // TODO pass along the embeds for checking
   std::string uri;
-  std::string cid;
-  nlohmann::json::binary_t encoded_cid;
   bsky::embed_type embed_type = bsky::embed_type_from_string(_embed_type_str);
   switch (embed_type) {
     case bsky::embed_type::record:
@@ -309,13 +559,12 @@ bsky::embed_type firehose_payload::context::process_embed(
       _event_type = bsky::tracked_event::quote;
       _recorded = true;
       uri = embed_type == bsky::embed_type::record
-                ? embed["record"]["uri"].template get<std::string>()
-                : embed["record"]["record"]["uri"].template get<std::string>();
-      _processor.request_recording(
-          {_repo,
-           bsky::time_stamp_from_iso_8601(
-               _content["createdAt"].template get<std::string>()),
-           activity::quote(_this_path, uri)});
+                ? text_of(embed["record"]["uri"])
+                : text_of(embed["record"]["record"]["uri"]);
+      _payload.record({_repo,
+                       bsky::time_stamp_from_iso_8601(
+                           _content["createdAt"].as_text()),
+                       activity::quote(_this_path, uri)});
       // nested media must be checked
       if (embed_type == bsky::embed_type::record_with_media) {
         // TODO fix recursive checking
@@ -324,38 +573,20 @@ bsky::embed_type firehose_payload::context::process_embed(
       }
       break;
     case bsky::embed_type::external:
-      add_embed(embed::external(
-          embed["external"]["uri"].template get<std::string>()));
+      add_embed(embed::external(text_of(embed["external"]["uri"])));
       if (embed["external"].contains("thumb")) {
-        encoded_cid = embed["external"]["thumb"]["ref"]
-                          .template get<nlohmann::json::binary_t>();
-        // nlohmann parser leaves a leading zero byte
-        cid = atproto::cid_decoder<nlohmann::json::binary_t::const_iterator>(
-                  encoded_cid.cbegin() + 1, encoded_cid.cend())
-                  .as_string();
-        add_embed(embed::image(cid));
+        add_embed(embed::image(
+            atproto::cid(embed["external"]["thumb"]["ref"].as_cid())));
       }
       break;
     case bsky::embed_type::images:
       // pass along the CID in each image
-      for (auto const &image : embed["images"]) {
-        encoded_cid =
-            image["image"]["ref"].template get<nlohmann::json::binary_t>();
-        // nlohmann parser leaves a leading zero byte
-        cid = atproto::cid_decoder<nlohmann::json::binary_t::const_iterator>(
-                  encoded_cid.cbegin() + 1, encoded_cid.cend())
-                  .as_string();
-        add_embed(embed::image(cid));
+      for (auto const &image : embed["images"].items()) {
+        add_embed(embed::image(atproto::cid(image["image"]["ref"].as_cid())));
       }
       break;
     case bsky::embed_type::video:
-      encoded_cid =
-          embed["video"]["ref"].template get<nlohmann::json::binary_t>();
-      // nlohmann parser leaves a leading zero byte
-      cid = atproto::cid_decoder<nlohmann::json::binary_t::const_iterator>(
-                encoded_cid.cbegin() + 1, encoded_cid.cend())
-                .as_string();
-      add_embed(embed::video(cid));
+      add_embed(embed::video(atproto::cid(embed["video"]["ref"].as_cid())));
       break;
     default:
       break;
@@ -363,18 +594,14 @@ bsky::embed_type firehose_payload::context::process_embed(
   return embed_type;
 }
 
-void firehose_payload::handle_content(
-    post_processor<firehose_payload> &processor, std::string const &repo,
-    std::string const &cid, nlohmann::json const &content) {
-  context this_context(processor, content);
+void firehose_payload::handle_content(std::string const &repo,
+                                      std::string const &path,
+                                      atproto::cid const &cid,
+                                      dag_cbor::value const &content) {
+  context this_context(*this, content);
   this_context._repo = repo;
-  if (_path_by_cid.contains(cid)) {
-    this_context._this_path = _path_by_cid[cid];
-  } else {
-    REL_ERROR("cannot get URI for cid at {}", dump_json(content));
-    return;
-  }
-  auto collection(content["$type"].template get<std::string>());
+  this_context._this_path = path;
+  auto collection(text_of(content["$type"]));
   this_context._event_type = bsky::event_type_from_collection(collection);
   if (this_context._event_type == bsky::tracked_event::post) {
     bool recorded(false);
@@ -382,27 +609,21 @@ void firehose_payload::handle_content(
     if (content.contains("reply")) {
       this_context._event_type = bsky::tracked_event::reply;
       recorded = true;
-      processor.request_recording(
-          {repo,
-           bsky::time_stamp_from_iso_8601(
-               content["createdAt"].template get<std::string>()),
-           activity::reply(
-               this_context._this_path,
-               content["reply"]["root"]["uri"].template get<std::string>(),
-               content["reply"]["parent"]["uri"].template get<std::string>())});
+      record(
+          {repo, bsky::time_stamp_from_iso_8601(content["createdAt"].as_text()),
+           activity::reply(this_context._this_path,
+                           content["reply"]["root"]["uri"].as_text(),
+                           content["reply"]["parent"]["uri"].as_text())});
     }
     // Check facets
     // 1. look for Matryoshka post - embed video/images, multiple facet
     // mentions/tags
     // https://github.com/SteveTownsend/pef-forum-moderation/issues/68
     // 2. check URIs for toxic content
-    size_t tags(0);
-    if (content.contains("tags")) {
-      tags = content["tags"].size();
-    }
+    size_t tags(content["tags"].size());
     if (content.contains("embed")) {
-      auto const &embed(content["embed"]);
-      this_context._embed_type_str = embed["$type"].template get<std::string>();
+      dag_cbor::value embed(content["embed"]);
+      this_context._embed_type_str = text_of(embed["$type"]);
       bsky::embed_type embed_type = this_context.process_embed(embed);
 
       if (content.contains("facets")) {
@@ -410,34 +631,34 @@ void firehose_payload::handle_content(
         size_t links(0);
         if (embed_type == bsky::embed_type::video && embed.contains("langs")) {
           // count languages in video
-          auto langs(embed["langs"].template get<std::vector<std::string>>());
-          for (auto const &lang : langs) {
+          for (auto const &lang : embed["langs"].items()) {
             metrics_factory::instance()
                 .get_counter("firehose_content")
                 .Get({{"embed", this_context._embed_type_str},
-                      {"language", lang}})
+                      {"language", text_of(lang)}})
                 .Increment();
           }
         }
         bool has_facets(false);
-        for (auto const &facet : content["facets"]) {
+        // text form only for matches and recorded facets
+        const std::string cid_text(cid.to_string());
+        for (auto const &facet : content["facets"].items()) {
           has_facets = true;
-          for (auto const &feature : facet["features"]) {
-            auto const &facet_type(
-                feature["$type"].template get<std::string>());
+          for (auto const &feature : facet["features"].items()) {
+            std::string_view facet_type(feature["$type"].as_text());
             if (facet_type == bsky::AppBskyRichtextFacetMention) {
               ++mentions;
             } else if (facet_type == bsky::AppBskyRichtextFacetTag) {
               ++tags;
               // }
             } else if (facet_type == bsky::AppBskyRichtextFacetLink) {
+              std::string uri(text_of(feature["uri"]));
               _path_candidates.emplace_back(path_candidates{
                   this_context._this_path,
-                  cid,
+                  cid_text,
                   {{collection, std::string(bsky::AppBskyRichtextFacetLink),
-                    feature["uri"].template get<std::string>()}}});
-              this_context.add_embed(
-                  embed::external(feature["uri"].template get<std::string>()));
+                    uri}}});
+              this_context.add_embed(embed::external(uri));
               ++links;
             }
           }
@@ -468,21 +689,19 @@ void firehose_payload::handle_content(
               .get_histogram("firehose_facets")
               .GetAt({{"facet", "total"}})
               .Observe(static_cast<double>(total));
-          processor.request_recording(
+          record(
               {repo,
-               bsky::time_stamp_from_iso_8601(
-                   content["createdAt"].template get<std::string>()),
-               activity::facets(this_context._this_path, cid,
+               bsky::time_stamp_from_iso_8601(content["createdAt"].as_text()),
+               activity::facets(this_context._this_path, cid_text,
                                 static_cast<unsigned short>(tags),
                                 static_cast<unsigned short>(mentions),
                                 static_cast<unsigned short>(links))});
         }
         if (content.contains("langs")) {
-          auto langs(content["langs"].template get<std::vector<std::string>>());
-          for (auto const &lang : langs) {
+          for (auto const &lang : content["langs"].items()) {
             metrics_factory::instance()
                 .get_counter("firehose_content")
-                .Get({{"collection", collection}, {"language", lang}})
+                .Get({{"collection", collection}, {"language", text_of(lang)}})
                 .Increment();
           }
         }
@@ -490,76 +709,73 @@ void firehose_payload::handle_content(
     }
     if (!recorded) {
       // plain old post, not a reply or quote
-      processor.request_recording(
-          {repo,
-           bsky::time_stamp_from_iso_8601(
-               content["createdAt"].template get<std::string>()),
+      record(
+          {repo, bsky::time_stamp_from_iso_8601(content["createdAt"].as_text()),
            activity::post(this_context._this_path)});
     }
-  } else if (this_context._event_type == bsky::tracked_event::block) {
-    processor.request_recording(
-        {repo,
-         bsky::time_stamp_from_iso_8601(
-             content["createdAt"].template get<std::string>()),
-         activity::block(this_context._this_path,
-                         content["subject"].template get<std::string>())});
-  } else if (this_context._event_type == bsky::tracked_event::follow) {
-    processor.request_recording(
-        {repo,
-         bsky::time_stamp_from_iso_8601(
-             content["createdAt"].template get<std::string>()),
-         activity::follow(this_context._this_path,
-                          content["subject"].template get<std::string>())});
-  } else if (this_context._event_type == bsky::tracked_event::like) {
-    processor.request_recording(
-        {repo,
-         bsky::time_stamp_from_iso_8601(
-             content["createdAt"].template get<std::string>()),
-         activity::like(
-             this_context._this_path,
-             content["subject"]["uri"].template get<std::string>())});
   } else if (this_context._event_type == bsky::tracked_event::profile) {
-    processor.request_recording(
+    record(
         {repo,
-         (content.contains("createdAt")
-              ? bsky::time_stamp_from_iso_8601(
-                    content["createdAt"].template get<std::string>())
+         (content["createdAt"].is_text()
+              ? bsky::time_stamp_from_iso_8601(content["createdAt"].as_text())
               : bsky::current_time()),
          activity::profile(this_context._this_path)});
-  } else if (this_context._event_type == bsky::tracked_event::repost) {
-    processor.request_recording(
-        {repo,
-         bsky::time_stamp_from_iso_8601(
-             content["createdAt"].template get<std::string>()),
-         activity::repost(
-             this_context._this_path,
-             content["subject"]["uri"].template get<std::string>())});
+  } else {
+    handle_subject(repo, path, this_context._event_type, content);
   }
   // pass along embeds for analysis
   if (!this_context.get_embeds().empty()) {
-    bsky::moderation::embed_checker::instance().wait_enqueue(
-        {repo, this_context._this_path, cid, this_context.get_embeds()});
+    _embed_checks.emplace_back(embed::embed_info_list{
+        repo, this_context._this_path, cid, this_context.get_embeds()});
+  }
+}
+
+void firehose_payload::handle_subject(std::string const &repo,
+                                      std::string const &path,
+                                      const bsky::tracked_event event_type,
+                                      dag_cbor::value const &content) {
+  static constexpr std::array<std::string_view, 2> Fields = {"subject",
+                                                             "createdAt"};
+  std::array<dag_cbor::value, Fields.size()> found;
+  content.select(Fields, found);
+  dag_cbor::value const &subject(found[0]);
+  dag_cbor::value const &created_at(found[1]);
+  switch (event_type) {
+    case bsky::tracked_event::block:
+      record(
+          {repo, bsky::time_stamp_from_iso_8601(created_at.as_text()),
+           activity::block(path, text_of(subject))});
+      break;
+    case bsky::tracked_event::follow:
+      record(
+          {repo, bsky::time_stamp_from_iso_8601(created_at.as_text()),
+           activity::follow(path, text_of(subject))});
+      break;
+    case bsky::tracked_event::like:
+      record(
+          {repo, bsky::time_stamp_from_iso_8601(created_at.as_text()),
+           activity::like(path, subject["uri"].as_text())});
+      break;
+    case bsky::tracked_event::repost:
+      record(
+          {repo, bsky::time_stamp_from_iso_8601(created_at.as_text()),
+           activity::repost(path, subject["uri"].as_text())});
+      break;
+    default:
+      break;
   }
 }
 
 void firehose_payload::handle_matchable_content(
-    post_processor<firehose_payload> &processor, std::string const &repo,
-    std::string const &cid, nlohmann::json const &content) {
+    std::string const &repo, std::string const &path, atproto::cid const &cid,
+    dag_cbor::value const &content) {
   // common processing
-  handle_content(processor, repo, cid, content);
+  handle_content(repo, path, cid, content);
 
   // check for matches
-  std::string this_path;
-  if (_path_by_cid.contains(cid)) {
-    this_path = _path_by_cid[cid];
-  } else {
-    REL_ERROR("cannot get URI for cid at {}", dump_json(content));
-    return;
-  }
   auto candidates(parser::get_candidates_from_record(content));
   if (!candidates.empty()) {
-    _path_candidates.insert(
-        _path_candidates.end(),
-        {std::string(this_path), cid, std::move(candidates)});
+    _path_candidates.insert(_path_candidates.end(),
+                            {path, cid.to_string(), std::move(candidates)});
   }
 }
@@ -0,0 +1,180 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "text_skeleton.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <unicode/errorcode.h>
+#include <unicode/uchar.h>
+#include <unicode/uspoof.h>
+#include <unicode/utf8.h>
+
+namespace {
+// confusables outside these planes are CJK ideographs and the like, not
+// worth the table
+constexpr UChar32 ConfusablesLimit = 0x20000;
+
+std::string utf8_of(const UChar32 code_point) {
+  // never a surrogate, so always well-formed
+  char bytes[U8_MAX_LENGTH];
+  int32_t length(0);
+  U8_APPEND_UNSAFE(bytes, length, code_point);
+  return std::string(bytes, static_cast<size_t>(length));
+}
+} // namespace
+
+// Tables are filled in order of precedence, a later mapping replaces an
+// earlier one: confusables, ASCII upper case, default-ignorables, then
+// configured folds.
+text_skeleton::text_skeleton(const bool confusables,
+                             std::map<std::string, std::string> const &folds)
+    : _pages(CodePoints >> BlockBits, 0), _blocks(1) {
+  if (confusables) {
+    icu::ErrorCode error_code;
+    std::unique_ptr<USpoofChecker, decltype(&uspoof_close)> checker(
+        uspoof_open((UErrorCode *)error_code), &uspoof_close);
+    if (error_code.isFailure()) {
+      throw std::runtime_error(std::string("uspoof_open error ") +
+                               error_code.errorName());
+    }
+    std::string skeleton;
+    for (UChar32 code_point = 0; code_point < ConfusablesLimit; ++code_point) {
+      if (U_IS_SURROGATE(code_point))
+        continue;
+      const std::string input(utf8_of(code_point));
+      skeleton.resize(64);
+      int32_t length(uspoof_getSkeletonUTF8(
+          checker.get(), 0, input.data(), static_cast<int32_t>(input.size()),
+          skeleton.data(), static_cast<int32_t>(skeleton.size()),
+          (UErrorCode *)error_code));
+      if (error_code.get() == U_BUFFER_OVERFLOW_ERROR) {
+        error_code.reset();
+        skeleton.resize(static_cast<size_t>(length));
+        length = uspoof_getSkeletonUTF8(
+            checker.get(), 0, input.data(), static_cast<int32_t>(input.size()),
+            skeleton.data(), static_cast<int32_t>(skeleton.size()),
+            (UErrorCode *)error_code);
+      }
+      if (error_code.isFailure()) {
+        throw std::runtime_error(std::string("uspoof_getSkeleton error ") +
+                                 error_code.errorName());
+      }
+      skeleton.resize(static_cast<size_t>(length));
+      if (skeleton != input) {
+        set(static_cast<uint32_t>(code_point), skeleton);
+      }
+    }
+  }
+
+  // text is case-folded apart from ASCII, which the automaton folds after
+  // this stage, so upper case maps as its lower case does
+  std::string scratch;
+  for (char upper = 'A'; upper <= 'Z'; ++upper) {
+    const std::string lower(1, static_cast<char>(upper - 'A' + 'a'));
+    set(static_cast<uint32_t>(upper), apply(lower, scratch));
+  }
+
+  for (UChar32 code_point = 0; code_point < static_cast<UChar32>(CodePoints);
+       ++code_point) {
+    if (u_hasBinaryProperty(code_point, UCHAR_DEFAULT_IGNORABLE_CODE_POINT)) {
+      set(static_cast<uint32_t>(code_point), "");
+    }
+  }
+
+  // a fold's letters map as they would in text, worked out before any fold
+  // is set so that folds do not chain
+  std::vector<std::pair<uint32_t, std::string>> mapped_folds;
+  for (auto const &[from, to] : folds) {
+    int32_t index(0);
+    UChar32 code_point(0);
+    if (!from.empty()) {
+      U8_NEXT(from.data(), index, static_cast<int32_t>(from.size()),
+              code_point);
+    }
+    if (from.empty() || code_point < 0 ||
+        static_cast<size_t>(index) != from.size()) {
+      throw std::invalid_argument("Skeleton fold '" + from +
+                                  "' is not a single character");
+    }
+    mapped_folds.emplace_back(static_cast<uint32_t>(code_point),
+                              std::string(apply(to, scratch)));
+  }
+  for (auto const &[code_point, replacement] : mapped_folds) {
+    set(code_point, replacement);
+  }
+}
+
+// Unmapped text is copied a run at a time, and only once something maps
+std::string_view text_skeleton::apply(std::string_view text,
+                                      std::string &scratch) const {
+  block const &ascii(_blocks[_pages[0]]);
+  const int32_t length(static_cast<int32_t>(text.size()));
+  bool copying(false);
+  int32_t unmapped(0);
+  int32_t index(0);
+  while (index < length) {
+    const int32_t start(index);
+    mapping const *found(nullptr);
+    const uint8_t lead(static_cast<uint8_t>(text[static_cast<size_t>(index)]));
+    if (lead < 0x80) {
+      found = &ascii[lead];
+      ++index;
+    } else {
+      UChar32 code_point;
+      U8_NEXT(text.data(), index, length, code_point);
+      // ill-formed bytes are kept as they are
+      if (code_point >= 0) {
+        found = &lookup(static_cast<uint32_t>(code_point));
+      }
+    }
+    if (!found || found->_length == NotMapped)
+      continue;
+    if (!copying) {
+      scratch.clear();
+      copying = true;
+    }
+    scratch.append(text.data() + unmapped,
+                   static_cast<size_t>(start - unmapped));
+    scratch.append(_replacements, found->_offset, found->_length);
+    unmapped = index;
+  }
+  if (!copying)
+    return text;
+  scratch.append(text.data() + unmapped,
+                 static_cast<size_t>(length - unmapped));
+  return scratch;
+}
+
+void text_skeleton::set(const uint32_t code_point,
+                        std::string_view replacement) {
+  uint16_t &page(_pages[code_point >> BlockBits]);
+  if (page == 0) {
+    page = static_cast<uint16_t>(_blocks.size());
+    _blocks.emplace_back();
+  }
+  mapping &entry(_blocks[page][code_point & (BlockSize - 1)]);
+  if (entry._length == NotMapped) {
+    ++_mapped;
+  }
+  entry._offset = static_cast<uint32_t>(_replacements.size());
+  entry._length = static_cast<uint32_t>(replacement.size());
+  _replacements.append(replacement);
+}
@@ -0,0 +1,107 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+#include "zstd_decompressor.hpp"
+#include "common/log_wrapper.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+zstd_decompressor::dictionary
+zstd_decompressor::load_dictionary(std::string const &dictionary_file) {
+  std::ifstream file(dictionary_file, std::ios::binary);
+  if (!file.is_open())
+    throw std::invalid_argument("Cannot open " + dictionary_file);
+  std::vector<char> content((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  dictionary loaded(ZSTD_createDDict(content.data(), content.size()),
+                    [](const ZSTD_DDict *dictionary) {
+                      ZSTD_freeDDict(const_cast<ZSTD_DDict *>(dictionary));
+                    });
+  if (!loaded)
+    throw std::invalid_argument("Cannot load zstd dictionary " +
+                                dictionary_file);
+  REL_INFO("zstd dictionary {} loaded, {} bytes, id {}", dictionary_file,
+           content.size(), ZSTD_getDictID_fromDDict(loaded.get()));
+  return loaded;
+}
+
+zstd_decompressor::zstd_decompressor(dictionary shared_dictionary,
+                                     const size_t max_frame_size)
+    : _dictionary(std::move(shared_dictionary)),
+      _context(ZSTD_createDCtx()), _max_frame_size(max_frame_size) {
+  if (!_dictionary || !_context)
+    throw std::invalid_argument("Cannot create zstd context");
+  size_t result(ZSTD_DCtx_refDDict(_context.get(), _dictionary.get()));
+  if (ZSTD_isError(result))
+    throw std::invalid_argument(std::string("zstd dictionary error ") +
+                                ZSTD_getErrorName(result));
+}
+
+pooled_buffer
+zstd_decompressor::decompress(std::span<const uint8_t> compressed) {
+  pooled_buffer output(receive_buffer_pool::instance().acquire());
+  unsigned long long content_size(
+      ZSTD_getFrameContentSize(compressed.data(), compressed.size()));
+  if (content_size == ZSTD_CONTENTSIZE_ERROR)
+    throw std::runtime_error("not a zstd frame");
+  if (content_size != ZSTD_CONTENTSIZE_UNKNOWN) {
+    // the header is as untrusted as the rest of the frame
+    if (content_size > _max_frame_size)
+      throw std::runtime_error("zstd frame content size " +
+                               std::to_string(content_size) +
+                               " exceeds limit");
+    // the usual case, one pass into an exact-size buffer
+    auto space(output->prepare(static_cast<size_t>(content_size)));
+    size_t result(ZSTD_decompress_usingDDict(
+        _context.get(), space.data(), space.size(), compressed.data(),
+        compressed.size(), _dictionary.get()));
+    if (ZSTD_isError(result))
+      throw std::runtime_error(std::string("zstd error ") +
+                               ZSTD_getErrorName(result));
+    output->commit(result);
+    return output;
+  }
+
+  // no size in the frame header, stream into the buffer as it grows
+  ZSTD_DCtx_reset(_context.get(), ZSTD_reset_session_only);
+  ZSTD_inBuffer input{compressed.data(), compressed.size(), 0};
+  size_t result(0);
+  bool output_full(false);
+  do {
+    auto space(output->prepare(
+        std::max(ZSTD_DStreamOutSize(), 2 * compressed.size())));
+    ZSTD_outBuffer chunk{space.data(), space.size(), 0};
+    result = ZSTD_decompressStream(_context.get(), &chunk, &input);
+    if (ZSTD_isError(result))
+      throw std::runtime_error(std::string("zstd error ") +
+                               ZSTD_getErrorName(result));
+    output->commit(chunk.pos);
+    if (output->size() > _max_frame_size)
+      throw std::runtime_error("zstd frame exceeds size limit");
+    output_full = chunk.pos == chunk.size;
+  } while (result != 0 && (input.pos < input.size || output_full));
+  if (result != 0)
+    throw std::runtime_error("truncated zstd frame");
+  return output;
+}
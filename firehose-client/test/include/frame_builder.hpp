@@ -0,0 +1,106 @@
+#pragma once
+#include "nlohmann/json.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Recorded firehose messages are stored as JSON, with binary fields rendered
+// by nlohmann as {"bytes": [...], "subtype": N}. Restore those so the message
+// can be re-encoded as the DAG-CBOR the relay sent.
+inline nlohmann::json restore_binary(nlohmann::json const &recorded) {
+  if (recorded.is_object()) {
+    if (recorded.size() == 2 && recorded.contains("bytes") &&
+        recorded.contains("subtype")) {
+      auto bytes(recorded["bytes"].template get<std::vector<std::uint8_t>>());
+      if (recorded["subtype"].is_null()) {
+        return nlohmann::json::binary(std::move(bytes));
+      }
+      return nlohmann::json::binary(
+          std::move(bytes), recorded["subtype"].template get<std::uint8_t>());
+    }
+    nlohmann::json result(nlohmann::json::object());
+    for (auto const &[key, value] : recorded.items()) {
+      result[key] = restore_binary(value);
+    }
+    return result;
+  }
+  if (recorded.is_array()) {
+    nlohmann::json result(nlohmann::json::array());
+    for (auto const &value : recorded) {
+      result.push_back(restore_binary(value));
+    }
+    return result;
+  }
+  return recorded;
+}
+
+// header + message, as delivered in one websocket frame
+inline std::vector<std::uint8_t> make_frame(std::string_view op_type,
+                                            nlohmann::json const &message) {
+  std::vector<std::uint8_t> frame(
+      nlohmann::json::to_cbor({{"op", 1}, {"t", op_type}}));
+  auto body(nlohmann::json::to_cbor(message));
+  frame.insert(frame.end(), body.cbegin(), body.cend());
+  return frame;
+}
+
+inline void append_varint(std::vector<std::uint8_t> &output,
+                          std::uint64_t value) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<std::uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<std::uint8_t>(value));
+}
+
+// CIDv1 DAG-CBOR sha2-256 with a synthetic digest, content is not verified
+inline std::vector<std::uint8_t> make_cid(std::uint32_t seed) {
+  std::vector<std::uint8_t> cid({0x01, 0x71, 0x12, 0x20});
+  for (std::uint32_t index = 0; index < 32; ++index) {
+    cid.push_back(static_cast<std::uint8_t>((seed * 31 + index * 7) & 0xff));
+  }
+  return cid;
+}
+
+// #commit frame creating one record, in the same shape as the relay's. The
+// rev defaults to the rkey.
+inline std::vector<std::uint8_t>
+make_commit_frame(std::string const &repo, nlohmann::json const &record,
+                  std::string const &rkey, std::int64_t seq,
+                  std::string const &rev = {}) {
+  auto cid(make_cid(static_cast<std::uint32_t>(seq)));
+  std::vector<std::uint8_t> link({0x00});
+  link.insert(link.end(), cid.cbegin(), cid.cend());
+
+  std::vector<std::uint8_t> car;
+  auto car_header(nlohmann::json::to_cbor(
+      {{"roots", nlohmann::json::array({nlohmann::json::binary(link, 42)})},
+       {"version", 1}}));
+  append_varint(car, car_header.size());
+  car.insert(car.end(), car_header.cbegin(), car_header.cend());
+  auto block(nlohmann::json::to_cbor(record));
+  append_varint(car, cid.size() + block.size());
+  car.insert(car.end(), cid.cbegin(), cid.cend());
+  car.insert(car.end(), block.cbegin(), block.cend());
+
+  nlohmann::json message(
+      {{"blobs", nlohmann::json::array()},
+       {"blocks", nlohmann::json::binary(std::move(car))},
+       {"commit", nlohmann::json::binary(link, 42)},
+       {"ops",
+        nlohmann::json::array(
+            {{{"action", "create"},
+              {"cid", nlohmann::json::binary(link, 42)},
+              {"path",
+               record["$type"].template get<std::string>() + '/' + rkey}}})},
+       {"prev", nullptr},
+       {"rebase", false},
+       {"repo", repo},
+       {"rev", rev.empty() ? rkey : rev},
+       {"seq", seq},
+       {"since", nullptr},
+       {"time", "2024-12-20T21:28:36.920Z"},
+       {"tooBig", false}});
+  return make_frame("#commit", message);
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "capture_log.hpp"
+
+namespace {
+constexpr size_t SegmentBytes = 64 * 1024;
+
+struct capture_fixture : public ::testing::Test {
+  void SetUp() override {
+    _directory = std::filesystem::temp_directory_path() /
+                 "firehose_client_capture_test";
+    std::filesystem::remove_all(_directory);
+  }
+  void TearDown() override { std::filesystem::remove_all(_directory); }
+
+  // frames of varying size, every 50th has no seq as for #info
+  void write_frames(const size_t count) {
+    capture_writer writer(_directory, SegmentBytes);
+    for (size_t index = 0; index < count; ++index) {
+      size_t ordinal(_frames.size());
+      std::vector<uint8_t> frame(1 + (ordinal * 37) % 900,
+                                 static_cast<uint8_t>(ordinal));
+      int64_t seq(ordinal % 50 == 3 ? -1
+                                    : 1000 + static_cast<int64_t>(ordinal));
+      writer.append(seq, frame);
+      _frames.push_back(std::move(frame));
+      _seqs.push_back(seq);
+    }
+  }
+
+  std::filesystem::path _directory;
+  std::vector<std::vector<uint8_t>> _frames;
+  std::vector<int64_t> _seqs;
+};
+} // namespace
+
+TEST_F(capture_fixture, ReplayAll) {
+  write_frames(3000);
+  // a later run starts new segments
+  write_frames(1000);
+  capture_reader reader(_directory);
+  captured_frame frame;
+  size_t count(0);
+  while (reader.next(frame)) {
+    ASSERT_LT(count, _frames.size());
+    EXPECT_EQ(frame._seq, _seqs[count]);
+    EXPECT_TRUE(std::ranges::equal(frame._frame, _frames[count]));
+    ++count;
+  }
+  EXPECT_EQ(count, _frames.size());
+}
+
+TEST_F(capture_fixture, SeekToSeq) {
+  write_frames(4000);
+  for (int64_t target : {1000, 1500, 1053, 4999}) {
+    capture_reader reader(_directory);
+    reader.seek(target);
+    captured_frame frame;
+    ASSERT_TRUE(reader.next(frame));
+    // 1053 was recorded without a seq, next frame follows it
+    EXPECT_EQ(frame._seq, target == 1053 ? 1054 : target);
+  }
+  capture_reader reader(_directory);
+  reader.seek(5000);
+  captured_frame frame;
+  EXPECT_FALSE(reader.next(frame));
+}
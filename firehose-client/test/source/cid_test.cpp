@@ -1,3 +1,5 @@
+#include "cid.hpp"
+#include "frame_builder.hpp"
 #include "multiformats/cid.hpp"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -13,3 +15,81 @@ TEST(CIDTest, RoundTrip) {
   auto decoded(Multiformats::Multibase::decode(mod_service_banner));
   EXPECT_EQ(decoded.size(), 36);
 }
+
+TEST(CIDTest, BinaryToString) {
+  const std::string mod_service_banner(
+      "bafyreifd275x5ujvzarnxzwmztn32ncrtewmtp4ne4bb73opkflvdabere");
+  auto decoded(Multiformats::Multibase::decode(mod_service_banner));
+  std::vector<uint8_t> binary(decoded.cbegin(), decoded.cend());
+  atproto::cid cid{dag_cbor::bytes_view(binary)};
+  EXPECT_EQ(cid.to_string(), mod_service_banner);
+  EXPECT_EQ(cid.bytes().size(), 36);
+}
+
+TEST(CIDTest, MatchesMultiformats) {
+  for (uint32_t seed = 0; seed < 256; ++seed) {
+    auto binary(make_cid(seed));
+    atproto::cid cid{dag_cbor::bytes_view(binary)};
+    Multiformats::Cid reference({1}, {0x71}, {binary.cbegin() + 2,
+                                              binary.cend()});
+    EXPECT_EQ(cid.to_string(),
+              reference.to_string(Multiformats::Multibase::Protocol::Base32));
+  }
+}
+
+TEST(CIDTest, Version0) {
+  // sha2-256 multihash of the empty string, as a CIDv0
+  std::vector<uint8_t> binary({0x12, 0x20, 0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc,
+                               0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f,
+                               0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b,
+                               0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52,
+                               0xb8, 0x55});
+  atproto::cid cid{dag_cbor::bytes_view(binary)};
+  EXPECT_TRUE(cid.is_v0());
+  EXPECT_EQ(cid.to_string(), "QmdfTbBqBPQ7VNxZEYEj14VmRuZBkqFbiwReogJgS1zR1n");
+}
+
+TEST(CIDTest, EqualityAndHash) {
+  auto first(make_cid(1));
+  auto second(make_cid(2));
+  atproto::cid one{dag_cbor::bytes_view(first)};
+  atproto::cid same{dag_cbor::bytes_view(first)};
+  atproto::cid other{dag_cbor::bytes_view(second)};
+  EXPECT_EQ(one, same);
+  EXPECT_NE(one, other);
+  EXPECT_EQ(atproto::cid_hash()(one), atproto::cid_hash()(same));
+  EXPECT_NE(atproto::cid_hash()(one), atproto::cid_hash()(other));
+  // same leading bytes, different length
+  atproto::cid shorter{dag_cbor::bytes_view(first).first(35)};
+  EXPECT_NE(one, shorter);
+  EXPECT_TRUE(atproto::cid().empty());
+}
+
+TEST(CIDTest, InvalidSize) {
+  std::vector<uint8_t> binary(37, 0x01);
+  EXPECT_THROW(atproto::cid{dag_cbor::bytes_view(binary)},
+               std::invalid_argument);
+  EXPECT_THROW(atproto::cid{dag_cbor::bytes_view(binary).first(1)},
+               std::invalid_argument);
+}
+
+// every tail length against RFC 4648 test vectors, in lower case
+TEST(Base32Test, TestVectors) {
+  const std::vector<std::pair<std::string, std::string>> vectors = {
+      {"", ""},
+      {"f", "my"},
+      {"fo", "mzxq"},
+      {"foo", "mzxw6"},
+      {"foob", "mzxw6yq"},
+      {"fooba", "mzxw6ytb"},
+      {"foobar", "mzxw6ytboi"},
+      {"foobarfoobar", "mzxw6ytbojtg633cmfza"}};
+  for (auto const &vector : vectors) {
+    dag_cbor::bytes_view input(
+        reinterpret_cast<const uint8_t *>(vector.first.data()),
+        vector.first.size());
+    std::string output(base32::encoded_size(input.size()), '?');
+    base32::encode(input, output.data());
+    EXPECT_EQ(output, vector.second);
+  }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "common/bluesky/compact_at_uri.hpp"
+
+namespace {
+constexpr std::string_view Post =
+    "at://did:plc:ewvi7nxzyoun6zhxrhs64oiz/app.bsky.feed.post/3lc23oncbdk2l";
+}
+
+TEST(CompactAtUriTest, TidRoundTrip) {
+  auto value(atproto::tid::parse("3lc23oncbdk2l"));
+  ASSERT_TRUE(value);
+  EXPECT_EQ(atproto::tid::to_string(*value), "3lc23oncbdk2l");
+  EXPECT_EQ(atproto::tid::parse("2222222222222"), 0u);
+  EXPECT_EQ(atproto::tid::to_string(0x7fffffffffffffffULL), "bzzzzzzzzzzzz");
+  // more than 64 bits, wrong length, outside the alphabet
+  EXPECT_FALSE(atproto::tid::parse("kzzzzzzzzzzzz"));
+  EXPECT_FALSE(atproto::tid::parse("3lc23oncbdk2"));
+  EXPECT_FALSE(atproto::tid::parse("3lc23oncbdk21"));
+  EXPECT_FALSE(atproto::tid::parse("self"));
+}
+
+TEST(CompactAtUriTest, KnownCollectionAndTid) {
+  atproto::compact_at_uri uri(Post);
+  ASSERT_TRUE(uri);
+  EXPECT_EQ(uri.authority().to_string(),
+            "did:plc:ewvi7nxzyoun6zhxrhs64oiz");
+  EXPECT_EQ(uri.collection_id(),
+            atproto::compact_at_uri::collection::feed_post);
+  EXPECT_EQ(uri.collection_name(), "app.bsky.feed.post");
+  EXPECT_TRUE(uri.tid());
+  EXPECT_EQ(uri.rkey(), "3lc23oncbdk2l");
+  EXPECT_EQ(std::string(uri), Post);
+}
+
+TEST(CompactAtUriTest, TextFallbacks) {
+  atproto::compact_at_uri profile("at://did:web:example.com/"
+                                  "app.bsky.actor.profile/self");
+  EXPECT_FALSE(profile.tid());
+  EXPECT_EQ(profile.rkey(), "self");
+  EXPECT_EQ(std::string(profile),
+            "at://did:web:example.com/app.bsky.actor.profile/self");
+
+  atproto::compact_at_uri other("at://did:web:example.com/"
+                                "com.example.record/3lc23oncbdk2l");
+  EXPECT_EQ(other.collection_id(), atproto::compact_at_uri::collection::other);
+  EXPECT_EQ(other.collection_name(), "com.example.record");
+  EXPECT_EQ(other.rkey(), "3lc23oncbdk2l");
+  EXPECT_EQ(std::string(other),
+            "at://did:web:example.com/com.example.record/3lc23oncbdk2l");
+
+  atproto::compact_at_uri authority("at://did:web:example.com");
+  EXPECT_EQ(authority.collection_id(),
+            atproto::compact_at_uri::collection::none);
+  EXPECT_EQ(std::string(authority), "at://did:web:example.com");
+}
+
+TEST(CompactAtUriTest, Malformed) {
+  EXPECT_FALSE(atproto::compact_at_uri(""));
+  EXPECT_FALSE(atproto::compact_at_uri("https://bsky.app"));
+  EXPECT_FALSE(atproto::compact_at_uri("at:///app.bsky.feed.post"));
+}
+
+TEST(CompactAtUriTest, EqualityAndHash) {
+  atproto::compact_at_uri parsed(Post);
+  atproto::compact_at_uri built(
+      bsky::did("did:plc:ewvi7nxzyoun6zhxrhs64oiz"),
+      "app.bsky.feed.post/3lc23oncbdk2l");
+  EXPECT_EQ(parsed, built);
+  EXPECT_EQ(atproto::compact_at_uri_hash()(parsed),
+            atproto::compact_at_uri_hash()(built));
+  EXPECT_NE(parsed, atproto::compact_at_uri(
+                        "at://did:plc:ewvi7nxzyoun6zhxrhs64oiz/"
+                        "app.bsky.feed.post/3lc23oncbdk2m"));
+  EXPECT_NE(parsed, atproto::compact_at_uri(
+                        "at://did:plc:ewvi7nxzyoun6zhxrhs64oiz/"
+                        "app.bsky.feed.like/3lc23oncbdk2l"));
+  // a non-canonical key stays text and so differs from the TID form
+  EXPECT_NE(parsed, atproto::compact_at_uri(
+                        "at://did:plc:ewvi7nxzyoun6zhxrhs64oiz/"
+                        "app.bsky.feed.post/3LC23ONCBDK2L"));
+}
@@ -0,0 +1,138 @@
+#include "dag_cbor.hpp"
+#include "frame_builder.hpp"
+#include "json_scan.hpp"
+#include "parser.hpp"
+#include "testdefs.hpp"
+#include <algorithm>
+#include <array>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+TEST(DagCborTest, RecordedCommit) {
+  const auto frame(make_frame(
+      "#commit", restore_binary(load_json_from_file("raw_firehose_commit.json"))));
+  dag_cbor::frame decoded{dag_cbor::bytes_view(frame)};
+  EXPECT_EQ(decoded._header["op"].as_integer(), 1);
+  EXPECT_EQ(decoded._header["t"].as_text(), "#commit");
+  EXPECT_EQ(decoded._message.end(), frame.data() + frame.size());
+  EXPECT_EQ(decoded._message["repo"].as_text(),
+            "did:plc:4xu4evbtjxhoyxjta6nrnxg2");
+  EXPECT_EQ(decoded._message["seq"].as_integer(), 2057690245);
+  EXPECT_TRUE(decoded._message["prev"].is_null());
+  EXPECT_FALSE(decoded._message["tooBig"].as_bool());
+  EXPECT_FALSE(decoded._message["missing"].is_valid());
+
+  auto const op(decoded._message["ops"][0]);
+  EXPECT_EQ(op["action"].as_text(), "create");
+  EXPECT_EQ(op["path"].as_text(), "app.bsky.graph.follow/3ldrdeafu442z");
+  auto const op_cid(op["cid"].as_cid());
+  EXPECT_EQ(op_cid.size(), 36);
+
+  dag_cbor::car_reader car(decoded._message["blocks"].as_bytes());
+  EXPECT_EQ(car.header()["version"].as_integer(), 1);
+  dag_cbor::car_reader::block block;
+  size_t blocks(0);
+  size_t records(0);
+  while (car.next(block)) {
+    ++blocks;
+    auto const content(block.content());
+    if (content["$type"].is_text()) {
+      ++records;
+      EXPECT_EQ(content["$type"].as_text(), "app.bsky.graph.follow");
+      EXPECT_EQ(content["subject"].as_text(),
+                "did:plc:s3gkdzgo23ev4e2wo5qpi3i3");
+      EXPECT_TRUE(std::ranges::equal(block._cid, op_cid));
+    }
+  }
+  EXPECT_EQ(blocks, 9);
+  EXPECT_EQ(records, 1);
+}
+
+TEST(DagCborTest, PostFields) {
+  auto record(load_json_from_file("post.json")["commit"]["record"]);
+  record["embed"] = {
+      {"$type", "app.bsky.embed.images"},
+      {"images", {{{"alt", "first"}}, {{"alt", "second \"quoted\""}}}}};
+  const auto frame(
+      make_commit_frame("did:plc:mkxsukn6mamazgawvntevvfg", record,
+                        "3lc23oncbdk2l", 1));
+  dag_cbor::frame decoded{dag_cbor::bytes_view(frame)};
+  dag_cbor::car_reader car(decoded._message["blocks"].as_bytes());
+  dag_cbor::car_reader::block block;
+  ASSERT_TRUE(car.next(block));
+  auto const content(block.content());
+  EXPECT_EQ(content["text"].as_text(),
+            record["text"].template get<std::string>());
+  EXPECT_EQ(content.at_pointer("/embed/images/1/alt").as_text(),
+            "second \"quoted\"");
+  EXPECT_FALSE(content.at_pointer("/embed/images/2/alt").is_valid());
+  EXPECT_FALSE(content.at_pointer("/embed/video/alt").is_valid());
+  // diagnostic rendering follows nlohmann for text
+  EXPECT_EQ(dag_cbor::dump(content.at_pointer("/embed/images/1/alt")),
+            nlohmann::to_string(record["embed"]["images"][1]["alt"]));
+  std::vector<std::string> langs;
+  for (auto const &lang : content["langs"].items()) {
+    langs.emplace_back(lang.as_text());
+  }
+  EXPECT_EQ(langs, record["langs"].template get<std::vector<std::string>>());
+  EXPECT_FALSE(car.next(block));
+}
+
+TEST(DagCborTest, CandidatesMatchJetstream) {
+  auto record(load_json_from_file("post.json")["commit"]["record"]);
+  record["embed"] = {
+      {"$type", "app.bsky.embed.images"},
+      {"images", {{{"alt", "first"}}, {{"alt", "second \"quoted\""}}}}};
+  const auto frame(
+      make_commit_frame("did:plc:mkxsukn6mamazgawvntevvfg", record,
+                        "3lc23oncbdk2l", 1));
+  dag_cbor::frame decoded{dag_cbor::bytes_view(frame)};
+  dag_cbor::car_reader car(decoded._message["blocks"].as_bytes());
+  dag_cbor::car_reader::block block;
+  ASSERT_TRUE(car.next(block));
+  const std::string json(record.dump());
+  // the same record from the firehose, Jetstream or a DOM
+  candidate_list candidates(
+      parser::get_candidates_from_record(block.content()));
+  EXPECT_EQ(candidates,
+            parser::get_candidates_from_record(json_scan::value(json)));
+  EXPECT_EQ(candidates, parser::get_candidates_from_record(record));
+  ASSERT_EQ(candidates.size(), 3);
+  EXPECT_EQ(candidates[0]._value, record["text"].template get<std::string>());
+  EXPECT_EQ(candidates[2]._value, "second \"quoted\"");
+}
+
+TEST(DagCborTest, SelectFields) {
+  auto record(load_json_from_file("post.json")["commit"]["record"]);
+  const auto frame(make_commit_frame("did:plc:mkxsukn6mamazgawvntevvfg",
+                                     record, "3lc23oncbdk2l", 1));
+  dag_cbor::frame decoded{dag_cbor::bytes_view(frame)};
+  dag_cbor::car_reader car(decoded._message["blocks"].as_bytes());
+  dag_cbor::car_reader::block block;
+  ASSERT_TRUE(car.next(block));
+  const std::array<std::string_view, 3> keys = {"createdAt", "absent",
+                                                "text"};
+  std::array<dag_cbor::value, 3> found;
+  EXPECT_EQ(block.content().select(keys, found), 2);
+  EXPECT_EQ(found[0].as_text(),
+            record["createdAt"].template get<std::string>());
+  EXPECT_FALSE(found[1].is_valid());
+  EXPECT_EQ(found[2].as_text(), record["text"].template get<std::string>());
+}
+
+TEST(DagCborTest, TruncatedFrame) {
+  const auto frame(make_frame(
+      "#commit", restore_binary(load_json_from_file("raw_firehose_commit.json"))));
+  dag_cbor::car_reader::block block;
+  for (size_t length = 0; length < frame.size(); ++length) {
+    EXPECT_THROW(
+        {
+          dag_cbor::frame decoded{dag_cbor::bytes_view(frame.data(), length)};
+          dag_cbor::car_reader car(decoded._message["blocks"].as_bytes());
+          while (car.next(block)) {
+            block.content();
+          }
+        },
+        dag_cbor::decode_error);
+  }
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "common/bluesky/did.hpp"
+
+TEST(DidTest, PlcPackRoundTrip) {
+  const std::string text("did:plc:z72i7hdynmk6r22z27h6tvur");
+  bsky::did_interner::packed_plc packed;
+  ASSERT_TRUE(bsky::did_interner::pack_plc(text, packed));
+  EXPECT_EQ(bsky::did_interner::unpack_plc(packed), text);
+
+  EXPECT_FALSE(bsky::did_interner::pack_plc("did:web:example.com", packed));
+  EXPECT_FALSE(bsky::did_interner::pack_plc(
+      "did:plc:z72i7hdynmk6r22z27h6tvu1", packed));
+  EXPECT_FALSE(bsky::did_interner::pack_plc(
+      "did:plc:z72i7hdynmk6r22z27h6tvu", packed));
+}
+
+TEST(DidTest, SameDidSameId) {
+  bsky::did first("did:plc:ewvi7nxzyoun6zhxrhs64oiz");
+  bsky::did second("did:plc:ewvi7nxzyoun6zhxrhs64oiz");
+  bsky::did other("did:plc:vpkhqolt662uhesyj6nxm7ys");
+  EXPECT_EQ(first, second);
+  EXPECT_NE(first, other);
+  EXPECT_EQ(std::hash<bsky::did>()(first), std::hash<bsky::did>()(second));
+  EXPECT_EQ(first.to_string(), "did:plc:ewvi7nxzyoun6zhxrhs64oiz");
+  EXPECT_EQ(other.to_string(), "did:plc:vpkhqolt662uhesyj6nxm7ys");
+}
+
+TEST(DidTest, OtherMethods) {
+  bsky::did web("did:web:example.com");
+  EXPECT_FALSE(web.empty());
+  EXPECT_EQ(web.to_string(), "did:web:example.com");
+  EXPECT_EQ(web, bsky::did("did:web:example.com"));
+  EXPECT_NE(web, bsky::did("did:web:example.org"));
+}
+
+TEST(DidTest, ExistingOnlyFindsDidsInUse) {
+  const std::string text("did:plc:ragtjsm2j2vknwkz3zp4oxrd");
+  EXPECT_TRUE(bsky::did::existing(text).empty());
+  bsky::did held(text);
+  EXPECT_EQ(bsky::did::existing(text), held);
+  EXPECT_TRUE(bsky::did().empty());
+  EXPECT_EQ(bsky::did().to_string(), "");
+}
+
+TEST(DidTest, ReleasedIdsAreReused) {
+  auto &interner(bsky::did_interner::instance());
+  const size_t before(interner.size());
+  bsky::did::id_type released;
+  {
+    bsky::did first("did:plc:4llrhdclvdlmmynkwsmg5tdc");
+    bsky::did copy(first);
+    bsky::did moved(std::move(copy));
+    EXPECT_TRUE(copy.empty());
+    EXPECT_EQ(interner.size(), before + 1);
+    released = first.id();
+  }
+  EXPECT_EQ(interner.size(), before);
+  EXPECT_TRUE(bsky::did::existing("did:plc:4llrhdclvdlmmynkwsmg5tdc").empty());
+  bsky::did next("did:plc:3jpt2mvvsumj2r7eqk4gzzjz");
+  EXPECT_EQ(next.id(), released);
+  EXPECT_EQ(next.to_string(), "did:plc:3jpt2mvvsumj2r7eqk4gzzjz");
+}
+
+TEST(DidTest, CompactAtScale) {
+  static constexpr char Alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+  auto &interner(bsky::did_interner::instance());
+  const size_t before(interner.size());
+  std::vector<bsky::did> dids;
+  constexpr size_t Count = 100000;
+  dids.reserve(Count);
+  for (size_t index = 0; index < Count; ++index) {
+    std::string text("did:plc:aaaaaaaaaaaaaaaaaaaaaaaa");
+    size_t value(index * 2654435761ULL);
+    for (size_t place = 0; place < 8; ++place, value >>= 5) {
+      text[text.size() - 1 - place] = Alphabet[value & 31];
+    }
+    text[8] = Alphabet[index & 31];
+    dids.emplace_back(text);
+    ASSERT_EQ(dids.back().to_string(), text);
+  }
+  EXPECT_EQ(interner.size(), before + Count);
+  EXPECT_EQ(bsky::did::existing(dids[Count / 2].to_string()), dids[Count / 2]);
+  // table overhead, against 80 bytes or more for a std::string copy
+  EXPECT_LT(interner.memory_bytes() / interner.size(), 48);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "common/helpers.hpp"
+#include "filter_automaton.hpp"
+
+namespace {
+typedef std::tuple<uint32_t, filter_automaton::role, size_t> hit;
+
+std::vector<hit> hits_in(filter_automaton const &automaton,
+                         std::string_view text) {
+  std::vector<hit> hits;
+  automaton.scan(text, [&](filter_automaton::pattern const &found,
+                           size_t start) {
+    hits.emplace_back(found._owner, found._role, start);
+  });
+  std::ranges::sort(hits);
+  return hits;
+}
+
+filter_automaton::pattern primary(const uint32_t owner,
+                                  const bool whole_word = false) {
+  return {owner, filter_automaton::role::primary, whole_word};
+}
+} // namespace
+
+TEST(FilterAutomatonTest, OverlappingKeywords) {
+  filter_automaton automaton;
+  automaton.add("he", primary(0));
+  automaton.add("she", primary(1));
+  automaton.add("his", primary(2));
+  automaton.add("hers", primary(3));
+  automaton.build();
+  EXPECT_EQ(hits_in(automaton, "ushers"),
+            (std::vector<hit>{{0, filter_automaton::role::primary, 2},
+                              {1, filter_automaton::role::primary, 1},
+                              {3, filter_automaton::role::primary, 2}}));
+  EXPECT_TRUE(hits_in(automaton, "hxs").empty());
+}
+
+TEST(FilterAutomatonTest, WholeWords) {
+  filter_automaton automaton;
+  automaton.add("cat", primary(0, true));
+  automaton.add("cat", primary(1));
+  automaton.build();
+  EXPECT_EQ(hits_in(automaton, "concatenate").size(), 1);
+  EXPECT_EQ(hits_in(automaton, "cat").size(), 2);
+  EXPECT_EQ(hits_in(automaton, "a cat, 2cats").size(), 3);
+}
+
+TEST(FilterAutomatonTest, FoldsAscii) {
+  filter_automaton automaton;
+  automaton.add("casing", primary(0));
+  automaton.add(to_canonical_utf8("Straße"), primary(1));
+  automaton.add("привет", primary(2));
+  automaton.build();
+  EXPECT_EQ(hits_in(automaton, "CaSiNg").size(), 1);
+  EXPECT_EQ(hits_in(automaton, "STRASSE").size(), 1);
+  // non-ASCII is only folded ahead of the scan
+  EXPECT_TRUE(hits_in(automaton, "ПРИВЕТ").empty());
+  std::string scratch;
+  EXPECT_EQ(hits_in(automaton, fold_non_ascii("ПРИВЕТ", scratch)).size(), 1);
+  EXPECT_EQ(hits_in(automaton, fold_non_ascii("STRAẞE", scratch)).size(), 1);
+}
+
+TEST(FilterAutomatonTest, SharedKeywordRoles) {
+  filter_automaton automaton;
+  automaton.add("alpha", primary(0));
+  automaton.add("beta", {0, filter_automaton::role::required, false});
+  automaton.add("beta", primary(1));
+  automaton.add("gamma", {1, filter_automaton::role::absent, false});
+  automaton.build();
+  EXPECT_EQ(hits_in(automaton, "alpha beta gamma"),
+            (std::vector<hit>{{0, filter_automaton::role::primary, 0},
+                              {0, filter_automaton::role::required, 6},
+                              {1, filter_automaton::role::primary, 6},
+                              {1, filter_automaton::role::absent, 11}}));
+}
+
+TEST(FilterAutomatonTest, RebuildAddsKeywords) {
+  filter_automaton automaton;
+  automaton.add("one", primary(0));
+  automaton.build();
+  filter_automaton copy(automaton);
+  copy.add("two", primary(1));
+  EXPECT_FALSE(copy.is_built());
+  EXPECT_TRUE(hits_in(copy, "one two").empty());
+  copy.build();
+  EXPECT_EQ(hits_in(copy, "one two").size(), 2);
+  EXPECT_EQ(hits_in(automaton, "one two").size(), 1);
+}
+
+TEST(FilterAutomatonTest, AgreesWithNaiveSearch) {
+  std::mt19937 generator(19);
+  std::uniform_int_distribution<int> letter(0, 3);
+  auto random_text = [&](const size_t length) {
+    std::string text;
+    for (size_t count = 0; count < length; ++count) {
+      text.push_back("abcd"[letter(generator)]);
+    }
+    return text;
+  };
+  std::vector<std::string> keywords;
+  filter_automaton automaton;
+  for (uint32_t owner = 0; owner < 50; ++owner) {
+    keywords.push_back(random_text(1 + owner % 5));
+    automaton.add(keywords.back(), primary(owner));
+  }
+  automaton.build();
+  for (size_t round = 0; round < 100; ++round) {
+    std::string text(random_text(200));
+    std::vector<hit> expected;
+    for (uint32_t owner = 0; owner < keywords.size(); ++owner) {
+      for (size_t start = text.find(keywords[owner]);
+           start != std::string::npos;
+           start = text.find(keywords[owner], start + 1)) {
+        expected.emplace_back(owner, filter_automaton::role::primary, start);
+      }
+    }
+    std::ranges::sort(expected);
+    EXPECT_EQ(hits_in(automaton, text), expected);
+  }
+}
+
+// every byte value bar upper case, so states fill the double array densely
+TEST(FilterAutomatonTest, AgreesWithNaiveSearchOnAnyBytes) {
+  std::mt19937 generator(23);
+  std::uniform_int_distribution<int> byte(0, 255 - 26);
+  auto random_bytes = [&](const size_t length) {
+    std::string text;
+    for (size_t count = 0; count < length; ++count) {
+      int next(byte(generator));
+      text.push_back(static_cast<char>(next < 'A' ? next : next + 26));
+    }
+    return text;
+  };
+  std::vector<std::string> keywords;
+  filter_automaton automaton;
+  for (uint32_t owner = 0; owner < 500; ++owner) {
+    keywords.push_back(random_bytes(1 + owner % 6));
+    automaton.add(keywords.back(), primary(owner));
+  }
+  automaton.build();
+  for (size_t round = 0; round < 100; ++round) {
+    std::string text(random_bytes(100));
+    for (size_t count = 0; count < 10; ++count) {
+      text += keywords[generator() % keywords.size()] + random_bytes(5);
+    }
+    std::vector<hit> expected;
+    for (uint32_t owner = 0; owner < keywords.size(); ++owner) {
+      for (size_t start = text.find(keywords[owner]);
+           start != std::string::npos;
+           start = text.find(keywords[owner], start + 1)) {
+        expected.emplace_back(owner, filter_automaton::role::primary, start);
+      }
+    }
+    std::ranges::sort(expected);
+    EXPECT_EQ(hits_in(automaton, text), expected);
+  }
+}
+
+TEST(FoldNonAsciiTest, AsciiIsUnchanged) {
+  std::string scratch;
+  std::string_view input("Plain ASCII Text");
+  EXPECT_EQ(fold_non_ascii(input, scratch).data(), input.data());
+  EXPECT_EQ(to_canonical_utf8(input), "plain ascii text");
+}
+
+TEST(FoldNonAsciiTest, FoldsMixedScript) {
+  std::string scratch;
+  EXPECT_EQ(fold_non_ascii("Hello ΣΟΦΙΑ and Привет!", scratch),
+            "Hello σοφια and привет!");
+  EXPECT_EQ(to_canonical_utf8("Hello ΣΟΦΙΑ and Привет!"),
+            "hello σοφια and привет!");
+  // folding can change the length
+  EXPECT_EQ(to_canonical_utf8("Maße"), "masse");
+  EXPECT_EQ(to_canonical_utf8("\u212a"), "k");
+}
@@ -0,0 +1,87 @@
+#include "json_scan.hpp"
+#include "testdefs.hpp"
+#include <gtest/gtest.h>
+
+TEST(JsonScanTest, JetstreamPost) {
+  const auto post(load_from_file("post.json"));
+  json_scan::value event(post);
+  std::string scratch;
+  EXPECT_TRUE(event["kind"] == "commit");
+  EXPECT_EQ(event["time_us"].raw(), "1732832091234656");
+  json_scan::value record(event["commit"]["record"]);
+  ASSERT_TRUE(record.is_object());
+  EXPECT_EQ(record["$type"].as_text(scratch), "app.bsky.feed.post");
+  EXPECT_EQ(record.at_pointer("/langs/0").as_text(scratch), "en");
+  EXPECT_FALSE(record.at_pointer("/langs/1"));
+  EXPECT_EQ(record.at_pointer("/reply/root/uri").as_text(scratch),
+            "at://did:plc:hvp5heuq7an4nerdbmyv7vxp/app.bsky.feed.post/"
+            "3lc2364nigc27");
+  EXPECT_TRUE(record.at_pointer("/text").as_text(scratch).starts_with(
+      "You have been immensely kind"));
+  EXPECT_FALSE(record.at_pointer("/embed/external/title"));
+  EXPECT_EQ(event["commit"]["cid"].as_text(scratch),
+            "bafyreifsjqllkba45kn4azvtbtxn3r7eodmczzygvsd6ccpfutzwlo4lta");
+}
+
+TEST(JsonScanTest, JetstreamProfile) {
+  const auto profile(load_from_file("abusive_profile.json"));
+  json_scan::value event(profile);
+  json_scan::value record(event["commit"]["record"]);
+  std::string scratch;
+  EXPECT_EQ(record["description"].as_text(scratch),
+            "russians use \xD1\x85\xD0\xBE\xD1\x85\xD0\xBE\xD0\xBB as a slur");
+  EXPECT_EQ(record["displayName"].as_text(scratch),
+            "russian slur \xD1\x85\xD0\xBE\xD1\x85\xD0\xBE\xD0\xBB");
+  // found after skipping the nested blobs
+  EXPECT_EQ(record.at_pointer("/banner/size").raw(), "686024");
+}
+
+TEST(JsonScanTest, Escapes) {
+  json_scan::value record(
+      R"({"a\"b":1,"text":"line\none \"q\" \\ \/ хé 😀 )"
+      R"(<b>","lone":"\udc00"})");
+  std::string scratch;
+  EXPECT_EQ(record["a\"b"].raw(), "1");
+  EXPECT_EQ(record["text"].as_text(scratch),
+            "line\none \"q\" \\ / \xD1\x85\xC3\xA9 \xF0\x9F\x98\x80 <b>");
+  EXPECT_EQ(record["lone"].as_text(scratch), "\xEF\xBF\xBD");
+  // escaped strings compare on their decoded contents
+  EXPECT_TRUE(record["lone"] == "\xEF\xBF\xBD");
+  EXPECT_FALSE(record["text"] == "line");
+}
+
+TEST(JsonScanTest, SkipsNestedValues) {
+  // long enough that the block scan runs, brackets inside strings ignored
+  json_scan::value record(
+      R"({ "skip" : [ {"x": "}]\"{["}, [1, 2, [3]],)"
+      R"( "padding padding padding" ],)"
+      "\n\t\"n\" : null , \"t\":true, \"f\" : -1.5e3, \"e\": {}, \"ea\": [] ,"
+      R"("last": "value" })");
+  std::string scratch;
+  EXPECT_EQ(record["last"].as_text(scratch), "value");
+  EXPECT_EQ(record["n"].raw(), "null");
+  EXPECT_EQ(record["t"].raw(), "true");
+  EXPECT_EQ(record["f"].raw(), "-1.5e3");
+  EXPECT_TRUE(record["e"].is_object());
+  EXPECT_FALSE(record["e"]["x"]);
+  EXPECT_FALSE(record["ea"][0]);
+  EXPECT_EQ(record.at_pointer("/skip/0/x").as_text(scratch), "}]\"{[");
+  EXPECT_EQ(record.at_pointer("/skip/1/2/0").raw(), "3");
+  EXPECT_FALSE(record.at_pointer("/skip/x"));
+  EXPECT_FALSE(record["missing"]);
+  EXPECT_FALSE(record["last"]["x"]);
+}
+
+TEST(JsonScanTest, Malformed) {
+  EXPECT_THROW(json_scan::value(""), json_scan::scan_error);
+  EXPECT_THROW(json_scan::value(R"({"a":"unterminated})"),
+               json_scan::scan_error);
+  EXPECT_THROW(json_scan::value(R"({"a":[1,2})"), json_scan::scan_error);
+  json_scan::value missing_colon(R"({"a" 1, "b": 2})");
+  EXPECT_THROW(missing_colon["b"], json_scan::scan_error);
+  json_scan::value bad_escape(R"({"a":"\q"})");
+  std::string scratch;
+  EXPECT_THROW(bad_escape["a"].as_text(scratch), json_scan::scan_error);
+  EXPECT_THROW(json_scan::value("{}").as_text(scratch),
+               json_scan::scan_error);
+}
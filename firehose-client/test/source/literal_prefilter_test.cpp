@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "literal_prefilter.hpp"
+
+TEST(LiteralPrefilterTest, RejectsTextWithoutFilters) {
+  literal_prefilter prefilter;
+  prefilter.add("mudshark");
+  prefilter.add("kys");
+  EXPECT_FALSE(prefilter.may_match("Lovely weather for a walk in the park"));
+  EXPECT_TRUE(prefilter.may_match("what a MudShark"));
+  EXPECT_TRUE(prefilter.may_match("KYS"));
+  EXPECT_FALSE(prefilter.may_match(""));
+}
+
+TEST(LiteralPrefilterTest, ShortFilters) {
+  literal_prefilter prefilter;
+  prefilter.add("tq");
+  EXPECT_FALSE(prefilter.may_match("nothing here"));
+  EXPECT_TRUE(prefilter.may_match("a TQ b"));
+  prefilter.add("#");
+  EXPECT_TRUE(prefilter.may_match("#edusky"));
+}
+
+TEST(LiteralPrefilterTest, NonAsciiFallsThrough) {
+  literal_prefilter prefilter;
+  prefilter.add("stalin");
+  // non-ASCII filters cannot occur in ASCII text
+  prefilter.add("хохол");
+  EXPECT_FALSE(prefilter.may_match("plain ascii text"));
+  // folding could turn non-ASCII text into a match, leave it to the matcher
+  EXPECT_TRUE(prefilter.may_match("Привет"));
+  EXPECT_TRUE(prefilter.may_match(std::string(40, 'a') + "é"));
+}
+
+TEST(LiteralPrefilterTest, NoFilters) {
+  literal_prefilter prefilter;
+  EXPECT_FALSE(prefilter.may_match("anything at all"));
+}
+
+TEST(LiteralPrefilterTest, NeverRejectsAMatch) {
+  std::mt19937 generator(22);
+  std::uniform_int_distribution<int> letter(0, 7);
+  auto random_text = [&](const size_t length) {
+    std::string text;
+    for (size_t count = 0; count < length; ++count) {
+      text.push_back("abcdEFG "[letter(generator)]);
+    }
+    return text;
+  };
+  auto folded = [](std::string text) {
+    for (char &next : text) {
+      if (next >= 'A' && next <= 'Z')
+        next = static_cast<char>(next - 'A' + 'a');
+    }
+    return text;
+  };
+  literal_prefilter prefilter;
+  std::vector<std::string> keywords;
+  for (size_t count = 0; count < 20; ++count) {
+    keywords.push_back(folded(random_text(1 + count % 6)));
+    if (keywords.back().size() > 1) {
+      prefilter.add(keywords.back());
+    } else {
+      keywords.pop_back();
+    }
+  }
+  size_t rejected(0);
+  for (size_t round = 0; round < 2000; ++round) {
+    // lengths either side of the 16-byte blocks
+    std::string text(random_text(round % 50));
+    std::string canonical(folded(text));
+    bool contains(false);
+    for (auto const &keyword : keywords) {
+      contains |= canonical.find(keyword) != std::string::npos;
+    }
+    if (contains) {
+      EXPECT_TRUE(prefilter.may_match(text)) << text;
+    } else if (!prefilter.may_match(text)) {
+      ++rejected;
+    }
+  }
+  EXPECT_GT(rejected, 0);
+}
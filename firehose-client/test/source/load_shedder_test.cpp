@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "load_shedder.hpp"
+
+TEST(LoadShedderTest, AdmitsAllWithoutBacklog) {
+  load_shedder shedder(100, 200, 10);
+  for (size_t count = 0; count < 1000; ++count) {
+    EXPECT_TRUE(shedder.admit(frame_value::statistics, 99));
+    EXPECT_TRUE(shedder.admit(frame_value::essential, 99));
+  }
+  EXPECT_EQ(shedder.dropped(), 0);
+}
+
+TEST(LoadShedderTest, SamplesStatistics) {
+  load_shedder shedder(100, 200, 10);
+  size_t admitted(0);
+  for (size_t count = 0; count < 1000; ++count) {
+    if (shedder.admit(frame_value::statistics, 150)) {
+      ++admitted;
+    }
+  }
+  EXPECT_EQ(admitted, 100);
+  EXPECT_EQ(shedder.dropped(), 900);
+}
+
+TEST(LoadShedderTest, DropsAllStatisticsAtLimit) {
+  load_shedder shedder(100, 200, 10);
+  for (size_t count = 0; count < 1000; ++count) {
+    EXPECT_FALSE(shedder.admit(frame_value::statistics, 200));
+  }
+  EXPECT_EQ(shedder.dropped(), 1000);
+}
+
+TEST(LoadShedderTest, NeverDropsEssential) {
+  load_shedder shedder(100, 200, 10);
+  for (size_t backlog : {0, 100, 150, 200, 1000000}) {
+    EXPECT_TRUE(shedder.admit(frame_value::essential, backlog));
+  }
+  EXPECT_EQ(shedder.dropped(), 0);
+}
+
+TEST(LoadShedderTest, DefaultsWithoutOverloadSettings) {
+  load_shedder shedder(100, 200, 10);
+  shedder.set_config(YAML::Load(R"(
+hosts: "jetstream1.us-east.bsky.network"
+port: 443
+)"));
+  EXPECT_TRUE(shedder.enabled());
+  EXPECT_FALSE(shedder.under_pressure(load_shedder::DefaultShedFrom - 1));
+  EXPECT_TRUE(shedder.under_pressure(load_shedder::DefaultShedFrom));
+}
+
+TEST(LoadShedderTest, OverloadSettings) {
+  load_shedder shedder;
+  shedder.set_config(YAML::Load(R"(
+overload:
+  shed_from: 100
+  sample_every: 5
+)"));
+  EXPECT_TRUE(shedder.enabled());
+  EXPECT_TRUE(shedder.under_pressure(100));
+  size_t admitted(0);
+  for (size_t count = 0; count < 100; ++count) {
+    if (shedder.admit(frame_value::statistics, 150)) {
+      ++admitted;
+    }
+  }
+  EXPECT_EQ(admitted, 20);
+
+  shedder.set_config(YAML::Load("overload: {enabled: false}"));
+  EXPECT_FALSE(shedder.enabled());
+  shedder.set_config(YAML::Load("replay: {directory: ./capture}"));
+  EXPECT_FALSE(shedder.enabled());
+}
@@ -1,12 +1,28 @@
 #include <aho_corasick/aho_corasick.hpp>
+#include <atomic>
 #include <exception>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <ios>
+#include <map>
+#include <thread>
 
+#include "common/metrics_factory.hpp"
 #include "matcher.hpp"
 #include "testdefs.hpp"
 
+namespace {
+// families that main registers at startup, once per process
+void register_metrics() {
+  static bool registered([] {
+    metrics_factory::instance().add_counter("match_prefilter", "test");
+    metrics_factory::instance().add_counter("match_cache", "test");
+    return true;
+  }());
+  (void)registered;
+}
+} // namespace
+
 // Demonstrate some basic assertions.
 TEST(MatcherTest, BasicAssertions) {
   // Expect two strings not to be equal.
@@ -70,48 +86,55 @@ TEST(MatcherTest, Parse) {
 TEST(MatcherTest, LoadFile) {
   std::string decorated = DataPath;
   decorated.append("filters");
-  matcher my_matcher(decorated);
-  {
-    candidate_list candidates(
-        {{"app.bsky.actor.profile", "description", "hate symbols include 卐"}});
-    EXPECT_TRUE(candidates.size() == 1);
-  }
-  {
-    candidate_list candidates(
-        {{"app.bsky.actor.profile", "description", "hate symbols include ☭"}});
-    EXPECT_TRUE(candidates.size() == 1);
-  }
-  {
-    candidate_list candidates({{"app.bsky.actor.profile", "description",
-                                "hate symbol ⚡⚡ represents the Nazi SS"}});
-    EXPECT_TRUE(candidates.size() == 1);
-  }
+  matcher my_matcher;
+  my_matcher.load_filter_file(decorated);
+  EXPECT_TRUE(my_matcher.check_candidates(
+      {{"app.bsky.actor.profile", "description", "hate symbols include 卐"}}));
+  EXPECT_TRUE(my_matcher.check_candidates(
+      {{"app.bsky.actor.profile", "description", "hate symbols include ☭"}}));
+  EXPECT_TRUE(my_matcher.check_candidates(
+      {{"app.bsky.actor.profile", "description",
+        "hate symbol ⚡⚡ represents the Nazi SS"}}));
+  EXPECT_FALSE(my_matcher.check_candidates(
+      {{"app.bsky.actor.profile", "description", "nothing to see here"}}));
+  EXPECT_EQ(my_matcher.find_rule("Stalin")._match_type,
+            matcher::rule::match_type::whole_word);
 }
 
 TEST(MatcherTest, RuleErrors) {
   // blank fields
-  EXPECT_THAT([]() { matcher::rule my_rule("|blah|false|word|blah"); },
+  EXPECT_THAT([]() { matcher::rule my_rule("|blah|match=word|blah"); },
               testing::Throws<std::invalid_argument>());
-  EXPECT_THAT([]() { matcher::rule my_rule("blah||true|substring|blah"); },
+  EXPECT_THAT([]() { matcher::rule my_rule("blah||match=substring|blah"); },
               testing::Throws<std::invalid_argument>());
   // wrong length
-  EXPECT_THAT([]() { matcher::rule my_rule("blah|blah|true"); },
+  EXPECT_THAT([]() { matcher::rule my_rule("blah|blah"); },
               testing::Throws<std::invalid_argument>());
   EXPECT_THAT(
-      []() { matcher::rule my_rule("blah|blah|true|substring|blah|blah"); },
+      []() { matcher::rule my_rule("blah|blah|match=substring|blah|blah"); },
       testing::Throws<std::invalid_argument>());
+  // actions are key=value
+  EXPECT_THAT([]() { matcher::rule my_rule("blah|blah|false|blah"); },
+              testing::Throws<std::invalid_argument>());
+  EXPECT_THAT([]() { matcher::rule my_rule("blah|blah|match=maybe|blah"); },
+              testing::Throws<std::invalid_argument>());
   // last field optional
-  EXPECT_NO_THROW(matcher::rule my_rule("blah|blah|false|word|"));
-  EXPECT_NO_THROW(matcher::rule my_rule("blah|blah|false|substring"));
+  EXPECT_NO_THROW(matcher::rule my_rule("blah|blah|match=word|"));
+  EXPECT_NO_THROW(matcher::rule my_rule("blah|blah|match=substring"));
   // contingent matching strings
-  EXPECT_NO_THROW(matcher::rule my_rule("blah|blah|false|substring|blah"));
+  EXPECT_NO_THROW(matcher::rule my_rule("blah|blah|match=substring|blah"));
   EXPECT_NO_THROW(
-      matcher::rule my_rule("blah|blah|false|substring|blah,blah1,blah2"));
+      matcher::rule my_rule("blah|blah|match=substring|blah,blah1,!blah2"));
+  matcher::rule tracked("blah|blah|track=true,label=true,match=word|");
+  EXPECT_TRUE(tracked._track);
+  EXPECT_TRUE(tracked._label);
+  EXPECT_EQ(tracked._match_type, matcher::rule::match_type::whole_word);
+  EXPECT_FALSE(matcher::rule("blah|blah|match=word|")._track);
 }
 
 TEST(MatcherTest, Ukrainian) {
   matcher my_matcher;
-  my_matcher.add_rule("Хохол|abusive|true|substring|");
+  my_matcher.add_rule("Хохол|abusive|track=true,match=substring|");
   candidate_list expected = {
       {"app.bsky.actor.profile", "description", "russians use Хохол as a slur"},
       {"app.bsky.actor.profile", "displayName", "russian slur Хохол"}};
@@ -120,9 +143,165 @@ TEST(MatcherTest, Ukrainian) {
 
 TEST(MatcherTest, UkrainianRule) {
   matcher my_matcher;
-  std::string rule("Хохол|abusive|false|substring|");
+  std::string rule("Хохол|abusive|track=true,match=substring|");
   my_matcher.add_rule(rule);
   candidate_list expected = {{"app.bsky.actor.profile", "description", rule},
                              {"app.bsky.actor.profile", "displayName", rule}};
-  EXPECT_FALSE(my_matcher.all_matches_for_candidates(expected).empty());
+  EXPECT_EQ(my_matcher.all_matches_for_candidates(expected).size(), 2);
+}
+
+TEST(MatcherTest, RefreshWhileMatching) {
+  matcher my_matcher;
+  my_matcher.add_rule("alpha", "abusive", "match=substring", "", "slur", 1,
+                      true, false);
+  my_matcher.publish();
+  candidate_list candidates = {
+      {"app.bsky.feed.post", "text", "alpha beta gamma"}};
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> readers;
+  for (size_t count = 0; count < 4; ++count) {
+    readers.emplace_back([&] {
+      while (!stop) {
+        // every published rule set contains alpha
+        EXPECT_FALSE(my_matcher.all_matches_for_candidates(candidates).empty());
+      }
+    });
+  }
+  for (int rule_id = 2; rule_id < 100; ++rule_id) {
+    matcher replacement;
+    replacement.add_rule("alpha", "abusive", "match=substring", "", "slur", 1,
+                         true, false);
+    replacement.add_rule("beta", "abusive", "match=word", "gamma", "slur",
+                         rule_id, true, false);
+    my_matcher.refresh_rules(std::move(replacement));
+  }
+  stop = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  auto matches(my_matcher.all_matches_for_candidates(candidates));
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0]._matches.size(), 2);
+}
+
+TEST(MatcherTest, ResultsOutliveRefresh) {
+  matcher my_matcher;
+  my_matcher.add_rule("beta", "abusive", "match=word", "gamma,!delta", "slur",
+                      7, true, false);
+  candidate_list candidates = {
+      {"app.bsky.feed.post", "text", "alpha beta gamma"},
+      {"app.bsky.feed.post", "text", "beta gamma delta"}};
+  auto matches(my_matcher.all_matches_for_candidates(candidates));
+  // the second candidate fails the contingent check
+  ASSERT_EQ(matches.size(), 1);
+  ASSERT_EQ(matches[0]._matches.size(), 1);
+  my_matcher.refresh_rules(matcher());
+  EXPECT_TRUE(my_matcher.all_matches_for_candidates(candidates).empty());
+  matcher::rule const &matched(
+      matches[0]._rules->rule(matches[0]._matches[0]));
+  EXPECT_EQ(matched._id, 7);
+  EXPECT_EQ(matches[0]._rules->filter(matches[0]._matches[0]), "beta");
+  EXPECT_EQ(matches[0].filters(), "'beta'");
+}
+
+TEST(MatcherTest, CachedVerdictsFollowRefresh) {
+  register_metrics();
+  matcher my_matcher;
+  my_matcher.set_config(YAML::Load("{use_db: true, cache: {entries: 1024}}"));
+  my_matcher.add_rule("spam", "spam", "match=substring", "", "spam", 1, true,
+                      false);
+  candidate_list candidates = {
+      {"app.bsky.feed.post", "text", "Buy SPAM now"},
+      {"app.bsky.feed.post", "text", "nothing to see"}};
+  // first pass fills the cache, later ones read it
+  for (size_t pass = 0; pass < 3; ++pass) {
+    auto matches(my_matcher.all_matches_for_candidates(candidates));
+    ASSERT_EQ(matches.size(), 1);
+    EXPECT_EQ(matches[0].filters(), "'spam'");
+  }
+  matcher replacement;
+  replacement.add_rule("see", "spam", "match=word", "", "spam", 2, true,
+                       false);
+  my_matcher.refresh_rules(std::move(replacement));
+  auto matches(my_matcher.all_matches_for_candidates(candidates));
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0]._candidate._value, "nothing to see");
+  EXPECT_EQ(matches[0].filters(), "'see'");
+}
+
+TEST(MatcherTest, RefreshReusesUnchangedRules) {
+  // published rule behind each rule id matched in the text
+  auto published_rules = [](matcher const &rules, std::string const &text) {
+    std::map<int, std::shared_ptr<const matcher::rule>> by_id;
+    for (auto const &result : rules.all_matches_for_candidates(
+             {{"app.bsky.feed.post", "text", text}})) {
+      for (auto const id : result._matches) {
+        by_id[result._rules->rule(id)._id] = result._rules->shared_rule(id);
+      }
+    }
+    return by_id;
+  };
+  matcher my_matcher;
+  my_matcher.add_rule("Spam", "spam", "match=substring", "", "spam", 1, true,
+                      false);
+  my_matcher.add_rule("scam", "spam", "match=word", "coin,!bitten", "spam", 2,
+                      true, false);
+  my_matcher.add_rule("hoax", "spam", "match=word", "", "spam", 4, true,
+                      false);
+  my_matcher.publish();
+  std::string const text("SPAM scam coin hoax fraud");
+  auto before(published_rules(my_matcher, text));
+  ASSERT_EQ(before.size(), 3);
+
+  matcher replacement;
+  replacement.reuse_rules_from(my_matcher);
+  replacement.add_rule("Spam", "spam", "match=substring", "", "spam", 1, true,
+                       false);
+  // contingent changed
+  replacement.add_rule("scam", "spam", "match=word", "coin", "spam", 2, true,
+                       false);
+  // actions changed
+  replacement.add_rule("hoax", "spam", "match=substring", "", "spam", 4, true,
+                       false);
+  replacement.add_rule("fraud", "spam", "match=word", "", "spam", 3, true,
+                       false);
+  EXPECT_EQ(replacement.reused_rules(), 1);
+  my_matcher.refresh_rules(std::move(replacement));
+  EXPECT_EQ(my_matcher.find_rule("spam")._id, 1);
+  EXPECT_EQ(my_matcher.find_rule("scam")._contingent, "coin");
+  EXPECT_EQ(my_matcher.find_rule("hoax")._match_type,
+            matcher::rule::match_type::substring);
+
+  auto after(published_rules(my_matcher, text));
+  ASSERT_EQ(after.size(), 4);
+  // the unchanged rule is the one already published, the others are rebuilt
+  EXPECT_EQ(after[1], before[1]);
+  EXPECT_NE(after[2], before[2]);
+  EXPECT_NE(after[4], before[4]);
+
+  candidate_list candidates = {
+      {"app.bsky.feed.post", "text", "SPAM scam coin bitten fraud"}};
+  auto matches(my_matcher.all_matches_for_candidates(candidates));
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0]._matches.size(), 3);
+}
+
+TEST(MatcherTest, SkeletonMatchesLookAlikes) {
+  register_metrics();
+  matcher my_matcher;
+  my_matcher.set_config(YAML::Load(
+      "{use_db: true, skeleton: {enabled: true, folds: {'4': a}}}"));
+  my_matcher.add_rule("scam", "spam", "match=word", "coin", "spam", 1, true,
+                      false);
+  candidate_list candidates = {
+      {"app.bsky.feed.post", "text", "SC4M c0in"},
+      {"app.bsky.feed.post", "text", "ѕс​аm соin"},
+      {"app.bsky.feed.post", "text", "scam"},
+      {"app.bsky.feed.post", "text", "seam coin"}};
+  auto matches(my_matcher.all_matches_for_candidates(candidates));
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0]._candidate._value, "SC4M c0in");
+  EXPECT_EQ(matches[1].filters(), "'scam'");
+  // rules are still found by their filter as given
+  EXPECT_EQ(my_matcher.find_rule("SCAM")._id, 1);
 }
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include "recent_window.hpp"
+
+TEST(RecentWindowTest, FirstArrivalWins) {
+  recent_window recent(100);
+  uint64_t key(recent_window::key_of({"did:plc:abc", "3lc23oncbdk2l"}));
+  EXPECT_FALSE(recent.insert(key, 1000, 0));
+  auto first(recent.insert(key, 1500, 1));
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first->_arrived, 1000);
+  EXPECT_EQ(first->_source, 0);
+  EXPECT_FALSE(recent.insert(
+      recent_window::key_of({"did:plc:abc", "3lc23oncbdk2m"}), 0, 0));
+}
+
+TEST(RecentWindowTest, KeySeparatesFields) {
+  EXPECT_NE(recent_window::key_of({"ab", "c"}),
+            recent_window::key_of({"a", "bc"}));
+  EXPECT_NE(recent_window::key_of({"#identity", "did:plc:abc", "t"}),
+            recent_window::key_of({"#account", "did:plc:abc", "t"}));
+  EXPECT_NE(recent_window::key_of({"", ""}), 0);
+  EXPECT_NE(recent_window::key_of({}), 0);
+}
+
+TEST(RecentWindowTest, BoundedMemory) {
+  constexpr size_t Window = 1000;
+  recent_window recent(Window);
+  constexpr uint64_t Inserted = 10 * Window;
+  for (uint64_t key = 1; key <= Inserted; ++key) {
+    ASSERT_FALSE(recent.insert(key, 0, 0));
+  }
+  // the last Window keys are always remembered
+  for (uint64_t key = Inserted - Window + 1; key <= Inserted; ++key) {
+    EXPECT_TRUE(recent.insert(key, 0, 0));
+  }
+  // and nothing older than twice that
+  EXPECT_FALSE(recent.insert(Inserted - 2 * Window, 0, 0));
+  EXPECT_FALSE(recent.insert(1, 0, 0));
+}
@@ -0,0 +1,111 @@
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <new>
+#include <thread>
+
+#include "buffer_pool.hpp"
+#include "common/metrics_factory.hpp"
+#include "common/stage_queue.hpp"
+
+// Replaces operator new for the whole executable, so these tests have one of
+// their own. Allocations are only counted while a test sets counting.
+// moodycamel queues take their blocks from malloc, sized up front from the
+// queue capacity.
+namespace {
+std::atomic<bool> counting(false);
+std::atomic<size_t> allocations(0);
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (counting.load(std::memory_order_relaxed))
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+constexpr size_t Batch = 32;
+constexpr size_t FrameSize = 512;
+
+void register_metrics() {
+  static bool registered([] {
+    metrics_factory::instance().add_gauge("process_operation", "test");
+    metrics_factory::instance().add_counter("receive_buffers", "test");
+    metrics_factory::instance().add_gauge("receive_buffers_held", "test");
+    receive_buffer_pool::instance().start();
+    return true;
+  }());
+  (void)registered;
+}
+
+struct frame_message {
+  int64_t _seq = -1;
+  pooled_buffer _frame;
+};
+} // namespace
+
+// websocket -> decode stage -> post-processor, as in the firehose client
+TEST(StageQueueTest, NoAllocationPerMessage) {
+  register_metrics();
+  stage_queue<frame_message> ingest(1000, {{"test", "ingest"}});
+  stage_queue<frame_message,
+              moodycamel::BlockingReaderWriterQueue<frame_message>>
+      processed(1000, {{"test", "processed"}});
+
+  std::atomic<bool> stop(false);
+  std::thread worker([&] {
+    std::array<frame_message, Batch> batch;
+    while (!stop) {
+      size_t count(ingest.wait_dequeue_bulk(batch));
+      processed.enqueue_bulk(std::span(batch.data(), count));
+    }
+  });
+
+  int64_t next_seq(0);
+  int64_t expected_seq(0);
+  std::array<frame_message, Batch> produced;
+  auto run_batches([&](const size_t batches) {
+    for (size_t count = 0; count < batches; ++count) {
+      for (auto &message : produced) {
+        message._seq = next_seq++;
+        message._frame = receive_buffer_pool::instance().acquire();
+        auto space(message._frame->prepare(FrameSize));
+        std::memset(space.data(), static_cast<int>(message._seq & 0xff),
+                    FrameSize);
+        message._frame->commit(FrameSize);
+      }
+      ingest.enqueue_bulk(produced);
+      for (size_t index = 0; index < Batch; ++index) {
+        frame_message message;
+        processed.wait_dequeue(message);
+        ASSERT_EQ(message._seq, expected_seq++);
+        ASSERT_EQ(message._frame.bytes().size(), FrameSize);
+        ASSERT_EQ(message._frame.bytes().front(),
+                  static_cast<uint8_t>(message._seq & 0xff));
+        // buffer goes back to the pool here
+      }
+    }
+  });
+
+  // first use of each queue and the pool allocates, and pooled buffers are
+  // replaced once the pool has sized them from observed frames
+  run_batches(2 * receive_buffer_pool::SampleWindow / Batch);
+  constexpr size_t Measured = 1000;
+  counting = true;
+  run_batches(Measured);
+  counting = false;
+  double per_message(static_cast<double>(allocations.load()) /
+                     static_cast<double>(Measured * Batch));
+  EXPECT_EQ(per_message, 0.0);
+
+  // release the worker
+  stop = true;
+  ingest.enqueue(frame_message());
+  worker.join();
+}
@@ -0,0 +1,40 @@
+#include <array>
+#include <gtest/gtest.h>
+
+#include "buffer_pool.hpp"
+#include "common/metrics_factory.hpp"
+#include "common/stage_queue.hpp"
+
+namespace {
+void register_metrics() {
+  static bool registered([] {
+    metrics_factory::instance().add_gauge("process_operation", "test");
+    metrics_factory::instance().add_counter("receive_buffers", "test");
+    metrics_factory::instance().add_gauge("receive_buffers_held", "test");
+    receive_buffer_pool::instance().start();
+    return true;
+  }());
+  (void)registered;
+}
+} // namespace
+
+TEST(StageQueueTest, BulkOrderPreserved) {
+  register_metrics();
+  stage_queue<int64_t, moodycamel::BlockingReaderWriterQueue<int64_t>> queue(
+      100, {{"test", "bulk"}});
+  std::array<int64_t, 10> values;
+  for (size_t index = 0; index < values.size(); ++index) {
+    values[index] = static_cast<int64_t>(index);
+  }
+  queue.enqueue_bulk(values);
+  EXPECT_EQ(queue.size_approx(), values.size());
+  std::array<int64_t, 4> taken;
+  int64_t expected(0);
+  while (expected < static_cast<int64_t>(values.size())) {
+    size_t count(queue.wait_dequeue_bulk(taken));
+    for (size_t index = 0; index < count; ++index) {
+      EXPECT_EQ(taken[index], expected++);
+    }
+  }
+  EXPECT_EQ(queue.size_approx(), 0);
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "text_skeleton.hpp"
+
+namespace {
+std::string skeleton_of(text_skeleton const &skeleton, std::string_view text) {
+  std::string scratch;
+  return std::string(skeleton.apply(text, scratch));
+}
+} // namespace
+
+TEST(TextSkeletonTest, UnmappedTextIsUnchanged) {
+  text_skeleton skeleton(false, {});
+  std::string scratch;
+  std::string_view input("plain text, ünïcode too");
+  EXPECT_EQ(skeleton.apply(input, scratch).data(), input.data());
+}
+
+TEST(TextSkeletonTest, DropsZeroWidth) {
+  text_skeleton skeleton(false, {});
+  EXPECT_EQ(skeleton_of(skeleton, "s​p‍a­m﻿"), "spam");
+}
+
+TEST(TextSkeletonTest, Confusables) {
+  text_skeleton skeleton(true, {});
+  EXPECT_GT(skeleton.size(), 1000);
+  // Cyrillic and Greek look-alikes, mathematical bold
+  EXPECT_EQ(skeleton_of(skeleton, "раураl"), skeleton_of(skeleton, "paypal"));
+  EXPECT_EQ(skeleton_of(skeleton, "ѕсаm"), skeleton_of(skeleton, "scam"));
+  EXPECT_EQ(skeleton_of(skeleton, "𝐬𝐜𝐚𝐦"), skeleton_of(skeleton, "scam"));
+  EXPECT_EQ(skeleton_of(skeleton, "ѕс​аm"), skeleton_of(skeleton, "scam"));
+  EXPECT_NE(skeleton_of(skeleton, "seam"), skeleton_of(skeleton, "scam"));
+  // ASCII is not case-folded ahead of the skeleton
+  EXPECT_EQ(skeleton_of(skeleton, "SCAM"), skeleton_of(skeleton, "scam"));
+}
+
+TEST(TextSkeletonTest, Folds) {
+  text_skeleton plain(true, {});
+  EXPECT_NE(skeleton_of(plain, "sc4m"), skeleton_of(plain, "scam"));
+  text_skeleton skeleton(true, {{"4", "a"}, {"@", "a"}, {"3", "e"}});
+  EXPECT_EQ(skeleton_of(skeleton, "sc4m"), skeleton_of(skeleton, "scam"));
+  EXPECT_EQ(skeleton_of(skeleton, "sc@m"), skeleton_of(skeleton, "scam"));
+  EXPECT_EQ(skeleton_of(skeleton, "fr33"), skeleton_of(skeleton, "free"));
+  // without confusables only the folds and zero-width apply
+  text_skeleton folds_only(false, {{"4", "a"}});
+  EXPECT_EQ(skeleton_of(folds_only, "sc4​m"), "scam");
+}
+
+TEST(TextSkeletonTest, BadFold) {
+  EXPECT_THROW(text_skeleton(false, {{"ab", "c"}}), std::invalid_argument);
+  EXPECT_THROW(text_skeleton(false, {{"", "c"}}), std::invalid_argument);
+}
@@ -0,0 +1,73 @@
+#include "common/bluesky/platform.hpp"
+#include "testdefs.hpp"
+#include <gtest/gtest.h>
+#include <regex>
+#include <set>
+
+namespace {
+// date-times in the recorded content, plus each in the other forms seen
+std::set<std::string> time_stamp_corpus() {
+  std::set<std::string> corpus;
+  const std::regex date_time(
+      R"(\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}(\.\d+)?(Z|[+-]\d{2}:\d{2}))");
+  for (auto const &filename :
+       {"abusive_profile.json", "failure.json", "post.json", "profile.json",
+        "raw_firehose_commit.json"}) {
+    std::string content(load_from_file(filename));
+    for (auto match = std::sregex_iterator(content.cbegin(), content.cend(),
+                                           date_time);
+         match != std::sregex_iterator(); ++match) {
+      corpus.insert(match->str());
+    }
+  }
+  for (std::string const &found : std::set<std::string>(corpus)) {
+    std::string seconds(found.substr(0, 19));
+    for (auto const &fraction :
+         {"", ".1", ".12", ".123", ".1234", ".123456", ".999999999"}) {
+      for (auto const &zone : {"Z", "+00:00", "-03:00", "+05:30"}) {
+        corpus.insert(seconds + fraction + zone);
+      }
+    }
+  }
+  return corpus;
+}
+} // namespace
+
+TEST(TimeStampTest, MatchesParsedForm) {
+  auto corpus(time_stamp_corpus());
+  ASSERT_GT(corpus.size(), 28);
+  for (auto const &date_time : corpus) {
+    auto fast(bsky::fast_time_stamp_from_iso_8601(date_time));
+    ASSERT_TRUE(fast.has_value()) << date_time;
+    EXPECT_EQ(*fast, bsky::parsed_time_stamp_from_iso_8601(date_time))
+        << date_time;
+  }
+}
+
+TEST(TimeStampTest, KnownValues) {
+  using namespace std::chrono;
+  const sys_days day(year(2024) / November / 28);
+  const bsky::time_stamp expected(day + hours(22) + minutes(14) +
+                                  seconds(50) + milliseconds(399));
+  EXPECT_EQ(bsky::time_stamp_from_iso_8601("2024-11-28T22:14:50.399Z"),
+            expected);
+  EXPECT_EQ(bsky::time_stamp_from_iso_8601("2024-11-28T22:14:50.399123Z"),
+            expected);
+  EXPECT_EQ(bsky::time_stamp_from_iso_8601("2024-11-28T22:14:50.399+00:00"),
+            expected);
+  EXPECT_EQ(bsky::time_stamp_from_iso_8601("2024-11-28T19:14:50.399-03:00"),
+            expected);
+}
+
+// left for the parsed path
+TEST(TimeStampTest, FastPathDeclines) {
+  for (auto const &date_time :
+       {"", "2024-11-28", "2024-11-28T22:14:50", "2024-11-28 22:14:50Z",
+        "2024-11-28T22:14:50.Z", "2024-11-28T24:00:00Z",
+        "2023-02-29T00:00:00Z", "2024-11-28T22:14:60Z",
+        "2024-11-28T22:14:50+0000", "2024-11-28T22:14:50z",
+        "1970-01-01T00:00:00Z"}) {
+    EXPECT_FALSE(bsky::fast_time_stamp_from_iso_8601(date_time).has_value())
+        << date_time;
+  }
+}
@@ -0,0 +1,101 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "verdict_cache.hpp"
+
+TEST(VerdictCacheTest, FindsStoredVerdict) {
+  verdict_cache cache(1024);
+  const uint64_t key(
+      verdict_cache::key_of("app.bsky.feed.post", "text", "buy followers"));
+  verdict_cache::verdict found;
+  EXPECT_FALSE(cache.find(key, 1, found));
+  cache.store(key, 1, {3, 7});
+  ASSERT_TRUE(cache.find(key, 1, found));
+  EXPECT_THAT(found, testing::ElementsAre(3, 7));
+  // no match is a verdict too
+  const uint64_t other(
+      verdict_cache::key_of("app.bsky.feed.post", "text", "hello"));
+  cache.store(other, 1, {});
+  ASSERT_TRUE(cache.find(other, 1, found));
+  EXPECT_TRUE(found.empty());
+}
+
+TEST(VerdictCacheTest, NewGenerationMisses) {
+  verdict_cache cache(1024);
+  const uint64_t key(verdict_cache::key_of("app.bsky.actor.profile",
+                                           "description", "spam"));
+  cache.store(key, 1, {2});
+  verdict_cache::verdict found;
+  EXPECT_FALSE(cache.find(key, 2, found));
+  cache.store(key, 2, {});
+  ASSERT_TRUE(cache.find(key, 2, found));
+  EXPECT_TRUE(found.empty());
+  EXPECT_FALSE(cache.find(key, 1, found));
+}
+
+TEST(VerdictCacheTest, LongVerdictNotCached) {
+  verdict_cache cache(1024);
+  const uint64_t key(
+      verdict_cache::key_of("app.bsky.feed.post", "text", "spam spam spam"));
+  std::vector<uint32_t> ids(verdict_cache::MaxRules, 5);
+  EXPECT_TRUE(cache.store(key, 1, ids));
+  verdict_cache::verdict found;
+  ASSERT_TRUE(cache.find(key, 1, found));
+  EXPECT_EQ(found.size(), verdict_cache::MaxRules);
+  ids.push_back(5);
+  EXPECT_FALSE(cache.store(key, 2, ids));
+  EXPECT_FALSE(cache.find(key, 2, found));
+}
+
+TEST(VerdictCacheTest, KeyCoversTypeAndField) {
+  const uint64_t text(verdict_cache::key_of("app.bsky.feed.post", "text", "a"));
+  EXPECT_NE(text, verdict_cache::key_of("app.bsky.feed.post", "alt", "a"));
+  EXPECT_NE(text, verdict_cache::key_of("app.bsky.actor.profile", "text", "a"));
+  EXPECT_EQ(text, verdict_cache::key_of("app.bsky.feed.post", "text", "a"));
+}
+
+TEST(VerdictCacheTest, BoundedCapacity) {
+  verdict_cache cache(256);
+  EXPECT_EQ(cache.capacity(), 256);
+  for (uint32_t next = 0; next < 10000; ++next) {
+    cache.store(verdict_cache::key_of("t", "f", std::to_string(next)), 1,
+                {next});
+  }
+  size_t held(0);
+  verdict_cache::verdict found;
+  for (uint32_t next = 0; next < 10000; ++next) {
+    if (cache.find(verdict_cache::key_of("t", "f", std::to_string(next)), 1,
+                   found)) {
+      EXPECT_THAT(found, testing::ElementsAre(next));
+      ++held;
+    }
+  }
+  EXPECT_LE(held, cache.capacity());
+  EXPECT_GT(held, 0);
+}
+
+TEST(VerdictCacheTest, ConcurrentUse) {
+  verdict_cache cache(4096);
+  std::vector<std::thread> threads;
+  for (uint32_t thread = 0; thread < 4; ++thread) {
+    threads.emplace_back([&cache, thread] {
+      verdict_cache::verdict found;
+      for (uint32_t next = 0; next < 20000; ++next) {
+        const uint64_t key(
+            verdict_cache::key_of("t", "f", std::to_string(next % 500)));
+        if (cache.find(key, 1, found)) {
+          EXPECT_THAT(found, testing::ElementsAre(next % 500));
+        } else {
+          cache.store(key, 1, {next % 500});
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
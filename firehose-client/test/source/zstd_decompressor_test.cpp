@@ -0,0 +1,99 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <zstd.h>
+
+#include "zstd_decompressor.hpp"
+
+namespace {
+std::string read_file(std::filesystem::path const &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+// Jetstream trains its dictionary on recent events, similar records will do
+struct zstd_fixture : public ::testing::Test {
+  void SetUp() override {
+    _frame = read_file("./data/post.json");
+    _dictionary = read_file("./data/profile.json") +
+                  read_file("./data/abusive_profile.json");
+    ASSERT_FALSE(_frame.empty());
+    _dictionary_file = std::filesystem::temp_directory_path() /
+                       "firehose_client_zstd_dictionary";
+    std::ofstream(_dictionary_file, std::ios::binary) << _dictionary;
+  }
+  void TearDown() override { std::filesystem::remove(_dictionary_file); }
+
+  std::vector<uint8_t> compress(const bool with_content_size) const {
+    ZSTD_CCtx *context(ZSTD_createCCtx());
+    ZSTD_CCtx_setParameter(context, ZSTD_c_contentSizeFlag,
+                           with_content_size ? 1 : 0);
+    ZSTD_CCtx_loadDictionary(context, _dictionary.data(), _dictionary.size());
+    std::vector<uint8_t> compressed(ZSTD_compressBound(_frame.size()));
+    size_t size(ZSTD_compress2(context, compressed.data(), compressed.size(),
+                               _frame.data(), _frame.size()));
+    ZSTD_freeCCtx(context);
+    EXPECT_FALSE(ZSTD_isError(size));
+    compressed.resize(size);
+    return compressed;
+  }
+
+  std::string _frame;
+  std::string _dictionary;
+  std::filesystem::path _dictionary_file;
+};
+} // namespace
+
+TEST_F(zstd_fixture, KnownContentSize) {
+  zstd_decompressor decompressor(_dictionary_file.string());
+  auto compressed(compress(true));
+  EXPECT_LT(compressed.size(), _frame.size());
+  // context is reused across frames
+  for (size_t count = 0; count < 3; ++count) {
+    EXPECT_EQ(decompressor.decompress(compressed).text(), _frame);
+  }
+}
+
+TEST_F(zstd_fixture, UnknownContentSize) {
+  zstd_decompressor decompressor(_dictionary_file.string());
+  auto compressed(compress(false));
+  EXPECT_EQ(ZSTD_getFrameContentSize(compressed.data(), compressed.size()),
+            ZSTD_CONTENTSIZE_UNKNOWN);
+  EXPECT_EQ(decompressor.decompress(compressed).text(), _frame);
+}
+
+TEST_F(zstd_fixture, SharedDictionary) {
+  auto dictionary(
+      zstd_decompressor::load_dictionary(_dictionary_file.string()));
+  zstd_decompressor first(dictionary);
+  zstd_decompressor second(dictionary);
+  EXPECT_EQ(dictionary.use_count(), 3);
+  auto compressed(compress(true));
+  EXPECT_EQ(first.decompress(compressed).text(), _frame);
+  EXPECT_EQ(second.decompress(compressed).text(), _frame);
+}
+
+TEST_F(zstd_fixture, FrameSizeLimit) {
+  zstd_decompressor decompressor(_dictionary_file.string(), _frame.size() - 1);
+  EXPECT_THROW(decompressor.decompress(compress(true)), std::runtime_error);
+  EXPECT_THROW(decompressor.decompress(compress(false)), std::runtime_error);
+  zstd_decompressor exact(_dictionary_file.string(), _frame.size());
+  EXPECT_EQ(exact.decompress(compress(true)).text(), _frame);
+  EXPECT_EQ(exact.decompress(compress(false)).text(), _frame);
+}
+
+TEST_F(zstd_fixture, InvalidFrame) {
+  zstd_decompressor decompressor(_dictionary_file.string());
+  std::vector<uint8_t> plain(_frame.cbegin(), _frame.cend());
+  EXPECT_THROW(decompressor.decompress(plain), std::runtime_error);
+  auto truncated(compress(false));
+  truncated.resize(truncated.size() / 2);
+  EXPECT_THROW(decompressor.decompress(truncated), std::runtime_error);
+  EXPECT_THROW(zstd_decompressor("./data/no_such_dictionary"),
+               std::invalid_argument);
+}
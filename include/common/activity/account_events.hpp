@@ -19,6 +19,8 @@ http://www.fsf.org/licensing/licenses
 >>> END OF LICENSE >>>
 *************************************************************************/
 
+#include "common/bluesky/compact_at_uri.hpp"
+#include "common/bluesky/did.hpp"
 #include "common/helpers.hpp"
 #include <cache.hpp>
 #include <chrono>
@@ -31,23 +33,23 @@ http://www.fsf.org/licensing/licenses
 namespace activity {
 class event_cache;
 
-typedef std::string did_type;
+typedef bsky::did did_type;
 
 struct post {
   std::string _ref;
 };
 struct reply {
   std::string _reply;
-  atproto::at_uri _root;
-  atproto::at_uri _parent;
+  atproto::compact_at_uri _root;
+  atproto::compact_at_uri _parent;
 };
 struct repost {
   std::string _repost;
-  atproto::at_uri _post;
+  atproto::compact_at_uri _post;
 };
 struct quote {
   std::string _quote;
-  atproto::at_uri _post;
+  atproto::compact_at_uri _post;
 };
 struct follow {
   std::string _follow;
@@ -59,7 +61,7 @@ struct block {
 };
 struct like {
   std::string _like;
-  atproto::at_uri _content;
+  atproto::compact_at_uri _content;
 };
 struct active {};
 struct inactive {
@@ -92,6 +94,10 @@ struct timed_event {
   inline timed_event(const did_type &did, bsky::time_stamp created_at,
                      event &&this_event)
       : _did(did), _created_at(created_at), _event(std::move(this_event)) {}
+  // interns the DID on the producer's thread
+  inline timed_event(std::string_view did, bsky::time_stamp created_at,
+                     event &&this_event)
+      : _did(did), _created_at(created_at), _event(std::move(this_event)) {}
   inline timed_event(const timed_event &event)
       : _did(event._did), _created_at(event._created_at), _event(event._event) {
   }
@@ -104,6 +110,12 @@ struct timed_event {
   inline timed_event(timed_event &&event)
       : _did(std::move(event._did)), _created_at(std::move(event._created_at)),
         _event(std::move(event._event)) {}
+  inline timed_event &operator=(timed_event &&event) {
+    _did = std::move(event._did);
+    _created_at = std::move(event._created_at);
+    _event = std::move(event._event);
+    return *this;
+  }
 
   did_type _did;
   bsky::time_stamp _created_at;
@@ -126,9 +138,9 @@ struct content_hit_count {
   inline void hit() { ++_hits; }
   inline size_t hits() const { return _hits; }
 };
-typedef std::unordered_map<atproto::at_uri,
+typedef std::unordered_map<atproto::compact_at_uri,
                            caches::WrappedValue<content_hit_count>,
-                           atproto::at_uri_hash>
+                           atproto::compact_at_uri_hash>
     content_hits;
 
 // cache policy for Key with custom hash
@@ -171,7 +183,8 @@ public:
 
 private:
   std::multimap<std::size_t, Key> frequency_storage;
-  std::unordered_map<Key, lfu_iterator, atproto::at_uri_hash> lfu_storage;
+  std::unordered_map<Key, lfu_iterator, atproto::compact_at_uri_hash>
+      lfu_storage;
 };
 
 template <typename Key, typename Value>
@@ -207,9 +220,9 @@ public:
 
     void alert();
 
-    void post(atproto::at_uri const &uri);
+    void post(atproto::compact_at_uri const &uri);
     void replied_to();
-    void reply_to(atproto::at_uri const &uri);
+    void reply_to(atproto::compact_at_uri const &uri);
     void reply();
     void quoted();
     void quote();
@@ -233,7 +246,7 @@ public:
     void add_matches(const unsigned short matches);
     size_t matches() const { return _matches; }
 
-    std::string _did;
+    did_type _did;
     std::string _handle;
     state _state = state::unknown;
     size_t _event_count = 0;
@@ -329,24 +342,25 @@ public:
 
   account(did_type const &did);
 
-  inline std::string did() const { return _statistics._did; }
+  inline did_type const &did() const { return _statistics._did; }
 
   void record(event_cache &parent_cache, timed_event const &event);
   inline size_t event_count() const { return _statistics._event_count; }
   inline size_t alert_count() const { return _statistics._alert_count; }
 
   caches::WrappedValue<content_hit_count>
-  get_content_item(atproto::at_uri const &uri);
+  get_content_item(atproto::compact_at_uri const &uri);
   // Callback on LFU cache eviction
-  void on_erase(atproto::at_uri const &uri,
+  void on_erase(atproto::compact_at_uri const &uri,
                 caches::WrappedValue<content_hit_count> const &entry);
   inline statistics &get_statistics() { return _statistics; }
 
 private:
   caches::WrappedValue<content_hit_count>
-  get_content_hits(atproto::at_uri const &uri);
+  get_content_hits(atproto::compact_at_uri const &uri);
   // TODO might be better to indirect to event_cache
-  std::shared_ptr<lfu_cache_at_uri_t<atproto::at_uri, content_hit_count>>
+  std::shared_ptr<
+      lfu_cache_at_uri_t<atproto::compact_at_uri, content_hit_count>>
       _content_hits;
   statistics _statistics;
 };
@@ -378,7 +392,7 @@ struct augment_account_event {
   void operator()(activity::facets const &value);
 
 private:
-  void reply_to(atproto::at_uri const &uri);
+  void reply_to(atproto::compact_at_uri const &uri);
 
   account::statistics &_stats;
   event_cache &_cache;
@@ -39,11 +39,14 @@ public:
   ~event_cache() = default;
 
   // Callback on LFU cache eviction
-  void on_erase(std::string const &did,
+  void on_erase(did_type const &did,
                 caches::WrappedValue<account> const &entry);
 
   void record(timed_event const &value);
-  caches::WrappedValue<account> get_account(std::string const &did);
+  caches::WrappedValue<account> get_account(did_type const &did);
+  inline caches::WrappedValue<account> get_account(std::string_view did) {
+    return get_account(did_type(did));
+  }
 
 private:
   // visitor for event-specific logic
@@ -53,7 +56,7 @@ private:
 
   // LFU cache of recently-active accounts
   std::mutex _cache_lock;
-  lfu_cache_t<std::string, account> _account_events;
+  lfu_cache_t<did_type, account> _account_events;
 };
 } // namespace activity
 
@@ -21,7 +21,8 @@ http://www.fsf.org/licensing/licenses
 *************************************************************************/
 
 #include "common/activity/event_cache.hpp"
-#include "readerwriterqueue.h"
+#include "common/stage_queue.hpp"
+#include <span>
 
 namespace activity {
 class event_recorder {
@@ -30,17 +31,23 @@ public:
     static event_recorder recorder;
     return recorder;
   }
+  // recorder thread drains the queue in batches of this size
+  static constexpr size_t DequeueBatch = 64;
+
   void wait_enqueue(timed_event &&value);
+  void wait_enqueue_bulk(std::span<timed_event> values);
   std::string ensure_loaded(std::string const &did);
   void update_handle(std::string const &did, std::string const &handle);
   std::string get_handle(std::string const &did);
+  std::string get_handle(did_type const &did);
 
 private:
   event_recorder();
-  caches::WrappedValue<account> add_if_needed(std::string const &did);
+  caches::WrappedValue<account> add_if_needed(did_type const &did);
 
   // Declare queue between post-processing and recording
-  moodycamel::BlockingReaderWriterQueue<timed_event> _queue;
+  stage_queue<timed_event, moodycamel::BlockingReaderWriterQueue<timed_event>>
+      _queue;
   std::thread _thread;
 
   event_cache _events;
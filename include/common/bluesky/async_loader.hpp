@@ -22,7 +22,7 @@ http://www.fsf.org/licensing/licenses
 #include "common/log_wrapper.hpp"
 #include "common/metrics_factory.hpp"
 #include "common/rest_utils.hpp"
-#include "readerwriterqueue.h"
+#include "common/stage_queue.hpp"
 
 #include <thread>
 
@@ -45,7 +45,10 @@ public:
 private:
   ~async_loader() = default;
   // Use queue to buffer incoming requests for bsky API data
-  moodycamel::BlockingReaderWriterQueue<std::unordered_set<std::string>> _queue;
+  stage_queue<std::unordered_set<std::string>,
+              moodycamel::BlockingReaderWriterQueue<
+                  std::unordered_set<std::string>>>
+      _queue;
   std::thread _thread;
   std::unique_ptr<client> _appview_client;
   bool _batch_in_progress = false;
@@ -0,0 +1,120 @@
+#ifndef __compact_at_uri_hpp__
+#define __compact_at_uri_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "common/bluesky/did.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace atproto {
+
+// Record key per https://atproto.com/specs/tid, 13 base32-sortable
+// characters holding a 64-bit value
+namespace tid {
+constexpr size_t Length = 13;
+std::optional<uint64_t> parse(std::string_view text);
+std::string to_string(const uint64_t value);
+} // namespace tid
+
+// at-uri for the content items that interactions refer to. The authority is
+// an interned DID, a known collection is an enum value and a TID record key
+// is held as its 64-bit value. Anything else is kept as text in _tail, so
+// each URI has one representation and equality is member-wise.
+class compact_at_uri {
+public:
+  enum class collection : uint8_t {
+    none,
+    other, // text in _tail
+    feed_post,
+    feed_like,
+    feed_repost,
+    feed_generator,
+    feed_threadgate,
+    feed_postgate,
+    graph_follow,
+    graph_block,
+    graph_list,
+    graph_listitem,
+    graph_listblock,
+    graph_starterpack,
+    actor_profile,
+    labeler_service
+  };
+
+  compact_at_uri() = default;
+  // at://authority[/collection[/rkey]], logs and leaves the URI empty if
+  // malformed
+  compact_at_uri(std::string_view uri);
+  inline compact_at_uri(std::string const &uri)
+      : compact_at_uri(std::string_view(uri)) {}
+  inline compact_at_uri(char const *uri)
+      : compact_at_uri(std::string_view(uri)) {}
+  // record in the given repo, path is collection/rkey
+  compact_at_uri(bsky::did const &authority, std::string_view path);
+
+  inline bsky::did const &authority() const { return _authority; }
+  inline collection collection_id() const { return _collection; }
+  std::string_view collection_name() const;
+  std::string rkey() const;
+  inline std::optional<uint64_t> tid() const {
+    return _has_tid ? std::optional<uint64_t>(_tid) : std::nullopt;
+  }
+
+  operator std::string() const;
+  inline operator bool() const { return !_authority.empty(); }
+
+  friend bool operator==(compact_at_uri const &lhs,
+                         compact_at_uri const &rhs) = default;
+
+  static collection collection_of(std::string_view name);
+  static std::string_view name_of(const collection value);
+
+private:
+  void assign_path(std::string_view path);
+
+  bsky::did _authority;
+  collection _collection = collection::none;
+  bool _has_tid = false;
+  uint64_t _tid = 0;
+  // collection/rkey for an unknown collection, otherwise a non-TID rkey
+  std::string _tail;
+
+  friend struct compact_at_uri_hash;
+};
+
+struct compact_at_uri_hash {
+  std::size_t operator()(const compact_at_uri &uri) const {
+    uint64_t mixed((uint64_t(uri._authority.id()) << 8) |
+                   static_cast<uint8_t>(uri._collection));
+    mixed = (mixed * 0x9e3779b97f4a7c15ULL) ^ uri._tid;
+    mixed = (mixed ^ (mixed >> 32)) * 0xff51afd7ed558ccdULL;
+    if (!uri._tail.empty()) {
+      mixed ^= std::hash<std::string>()(uri._tail);
+    }
+    return static_cast<size_t>(mixed ^ (mixed >> 29));
+  }
+};
+
+} // namespace atproto
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef __did_hpp__
+#define __did_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bsky {
+
+// Process-wide table of the DIDs in use. Each distinct DID has one entry and
+// a dense 32-bit id, did:plc values are packed to 15 bytes. Entries are
+// reference counted by bsky::did handles and their ids reused once the last
+// handle goes, so the table tracks the live accounts rather than every
+// account ever seen.
+class did_interner {
+public:
+  typedef uint32_t id_type;
+  static constexpr id_type None = std::numeric_limits<id_type>::max();
+  static constexpr size_t PackedSize = 15;
+  typedef std::array<uint8_t, PackedSize> packed_plc;
+
+  static did_interner &instance();
+
+  // id with a reference held for the caller, the DID is added if new
+  id_type acquire(std::string_view text);
+  // as acquire for a DID in use, None otherwise
+  id_type acquire_existing(std::string_view text);
+  inline void add_reference(const id_type id) {
+    entry_at(id)._references.fetch_add(1, std::memory_order_relaxed);
+  }
+  void release(const id_type id);
+  std::string to_string(const id_type id) const;
+
+  // DIDs in use
+  size_t size() const;
+  // entries, lookup table and free list, not counting non-plc DID text
+  size_t memory_bytes() const;
+
+  // did:plc:<24 base32 characters> as 120 bits, false for anything else
+  static bool pack_plc(std::string_view text, packed_plc &packed);
+  static std::string unpack_plc(packed_plc const &packed);
+
+private:
+  did_interner();
+
+  static constexpr size_t ChunkBits = 14;
+  static constexpr size_t ChunkSize = size_t(1) << ChunkBits;
+  // 2^28 ids
+  static constexpr size_t MaxChunks = 16384;
+  // lookup table slots that hold no id
+  static constexpr id_type EmptySlot = None;
+  static constexpr id_type DeletedSlot = None - 1;
+
+  enum class form : uint8_t { free, plc, other };
+  struct entry {
+    packed_plc _packed = {};
+    form _form = form::free;
+    std::atomic<uint32_t> _references = 0;
+  };
+  // DID as looked up, packed if possible
+  struct key {
+    packed_plc _packed = {};
+    form _form = form::other;
+    std::string_view _text;
+    size_t _hash = 0;
+  };
+
+  inline entry &entry_at(const id_type id) const {
+    return _chunks[id >> ChunkBits][id & (ChunkSize - 1)];
+  }
+  static key key_of(std::string_view text);
+  bool matches(const id_type id, key const &lookup) const;
+  size_t hash_of(const id_type id) const;
+  // slot holding the key's id, or the empty slot ending its probe
+  size_t find_slot(key const &lookup) const;
+  id_type allocate();
+  void insert_slot(const id_type id, const size_t hash);
+  void grow();
+
+  mutable std::shared_mutex _lock;
+  std::unique_ptr<std::unique_ptr<entry[]>[]> _chunks;
+  size_t _chunk_count = 0;
+  id_type _next = 0;
+  std::vector<id_type> _free;
+  // open addressed, ids indexed by hash
+  std::vector<id_type> _slots;
+  size_t _used_slots = 0;
+  size_t _live = 0;
+  std::unordered_map<id_type, std::string> _other_text;
+};
+
+// Interned DID, the size of its id. Copies share the table entry, equality
+// and hashing are on the id.
+class did {
+public:
+  typedef did_interner::id_type id_type;
+
+  did() = default;
+  explicit did(std::string_view text)
+      : _id(did_interner::instance().acquire(text)) {}
+  // empty unless the DID is already in use
+  static inline did existing(std::string_view text) {
+    did result;
+    result._id = did_interner::instance().acquire_existing(text);
+    return result;
+  }
+  did(did const &other) : _id(other._id) {
+    if (_id != did_interner::None) {
+      did_interner::instance().add_reference(_id);
+    }
+  }
+  did(did &&other) noexcept
+      : _id(std::exchange(other._id, did_interner::None)) {}
+  did &operator=(did const &other) {
+    did copy(other);
+    std::swap(_id, copy._id);
+    return *this;
+  }
+  did &operator=(did &&other) noexcept {
+    if (this != &other) {
+      reset();
+      _id = std::exchange(other._id, did_interner::None);
+    }
+    return *this;
+  }
+  ~did() { reset(); }
+
+  inline bool empty() const { return _id == did_interner::None; }
+  inline id_type id() const { return _id; }
+  inline std::string to_string() const {
+    return empty() ? std::string() : did_interner::instance().to_string(_id);
+  }
+
+  friend bool operator==(did const &lhs, did const &rhs) = default;
+
+private:
+  inline void reset() {
+    if (_id != did_interner::None) {
+      did_interner::instance().release(std::exchange(_id, did_interner::None));
+    }
+  }
+  id_type _id = did_interner::None;
+};
+
+} // namespace bsky
+
+template <> struct std::hash<bsky::did> {
+  size_t operator()(bsky::did const &value) const noexcept {
+    return static_cast<size_t>(value.id());
+  }
+};
+
+template <>
+struct std::formatter<bsky::did> : std::formatter<std::string> {
+  auto format(bsky::did const &value, format_context &ctx) const {
+    return std::formatter<std::string>::format(value.to_string(), ctx);
+  }
+};
+
+#endif
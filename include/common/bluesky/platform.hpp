@@ -23,6 +23,7 @@ http://www.fsf.org/licensing/licenses
 #include <chrono>
 #include <multiformats/cid.hpp>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <string>
 #include <string_view>
 
@@ -130,8 +131,15 @@ inline bsky::time_stamp current_time() {
       std::chrono::system_clock::now());
 }
 
-// Parse ISO8601 time
-bsky::time_stamp time_stamp_from_iso_8601(std::string const &date_time);
+// Parse ISO8601 time. RFC 3339 forms are read in place, others go through
+// std::chrono::parse.
+bsky::time_stamp time_stamp_from_iso_8601(std::string_view date_time);
+// YYYY-MM-DDThh:mm:ss[.fraction] then Z, +hh:mm or -hh:mm, otherwise nullopt
+std::optional<bsky::time_stamp>
+fast_time_stamp_from_iso_8601(std::string_view date_time);
+// std::chrono::parse with fixups for the offsets seen in practice, current
+// time if that fails too
+bsky::time_stamp parsed_time_stamp_from_iso_8601(std::string const &date_time);
 
 } // namespace bsky
 
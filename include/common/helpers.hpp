@@ -95,6 +95,13 @@ inline std::string to_lower(std::string const &input) {
 
 // convert UTF-8 input to canonical form where case differences are erased
 std::wstring to_canonical(std::string_view const input);
+// UTF-8 input with its non-ASCII text case-folded as to_canonical does,
+// ASCII may be left for the caller to fold. Returns input if it is all
+// ASCII, otherwise the folded text in scratch. Empty if ICU rejects it.
+std::string_view fold_non_ascii(std::string_view const input,
+                                std::string &scratch);
+// canonical form as UTF-8, ASCII folded too
+std::string to_canonical_utf8(std::string_view const input);
 
 inline std::string dump_json(nlohmann::json const &full_json,
                              bool indent = false) {
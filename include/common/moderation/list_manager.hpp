@@ -24,12 +24,13 @@ http://www.fsf.org/licensing/licenses
 #include <unordered_map>
 #include <unordered_set>
 
-#include "blockingconcurrentqueue.h"
 #include "common/bluesky/client.hpp"
+#include "common/bluesky/did.hpp"
 #include "common/helpers.hpp"
 #include "common/metrics_factory.hpp"
 #include "common/moderation/ozone_adapter.hpp"
 #include "common/moderation/session_manager.hpp"
+#include "common/stage_queue.hpp"
 #include "jwt-cpp/jwt.h"
 // #include "matcher.hpp"
 // #include "project_defs.hpp"
@@ -152,9 +153,9 @@ struct block_list_addition {
 };
 
 typedef std::unordered_map<std::string, atproto::at_uri> list_uris_by_name;
-typedef std::unordered_map<std::string, std::unordered_set<std::string>>
+typedef std::unordered_map<std::string, std::unordered_set<bsky::did>>
     active_list_membership_for_group;
-typedef std::unordered_map<std::string, std::unordered_set<std::string>>
+typedef std::unordered_map<std::string, std::unordered_set<bsky::did>>
     list_group_membership;
 
 class list_manager {
@@ -178,9 +179,9 @@ class list_manager {
   inline static bool is_active_list_for_group(std::string const &list_name) {
     return !list_name.contains('-');
   }
-  void update_blacklist(std::unordered_set<std::string> new_blacklist);
-  void update_whitelist(std::unordered_set<std::string> new_whitelist);
-  void update_ignored(std::unordered_set<std::string> new_ignored);
+  void update_blacklist(std::unordered_set<bsky::did> new_blacklist);
+  void update_whitelist(std::unordered_set<bsky::did> new_whitelist);
+  void update_ignored(std::unordered_set<bsky::did> new_ignored);
   bool skip_account(std::string const &did) const;
 
  private:
@@ -199,27 +200,31 @@ class list_manager {
 
   inline bool is_account_in_list_group(
       std::string const &did, std::string const &list_group_name) const {
+    const bsky::did account(bsky::did::existing(did));
+    if (account.empty())
+      return false;
     auto const &list_group_members(_list_group_members.find(list_group_name));
     return list_group_members != _list_group_members.cend() &&
-           list_group_members->second.contains(did);
+           list_group_members->second.contains(account);
   }
 
   inline void record_account_in_list_and_group(std::string const &did,
                                                std::string const &list_name) {
+    const bsky::did account(did);
     if (is_active_list_for_group(list_name)) {
       auto this_list(_active_list_members_for_group.find(list_name));
       if (this_list == _active_list_members_for_group.end()) {
-        _active_list_members_for_group.insert({list_name, {{did}}});
+        _active_list_members_for_group.insert({list_name, {account}});
       } else {
-        this_list->second.insert(did);
+        this_list->second.insert(account);
       }
     }
     auto this_list_group(
         _list_group_members.find(as_list_group_name(list_name)));
     if (this_list_group == _list_group_members.end()) {
-      _list_group_members.insert({as_list_group_name(list_name), {{did}}});
+      _list_group_members.insert({as_list_group_name(list_name), {account}});
     } else {
-      this_list_group->second.insert(did);
+      this_list_group->second.insert(account);
     }
     metrics_factory::instance()
         .get_counter("automation")
@@ -295,7 +300,7 @@ class list_manager {
   std::unique_ptr<bsky::client> _client;
   std::unique_ptr<bsky::pds_session> _session;
   // Declare queue between match post-processing and HTTP Client
-  moodycamel::BlockingConcurrentQueue<block_list_addition> _queue;
+  stage_queue<block_list_addition> _queue;
   std::string _handle;
   std::string _password;
   std::string _host;
@@ -308,9 +313,9 @@ class list_manager {
   std::unordered_map<std::string, std::unordered_set<std::string>>
       _block_reasons;
 
-  std::unordered_set<std::string> _blacklist;
-  std::unordered_set<std::string> _whitelist;
-  std::unordered_set<std::string> _ignored;
+  std::unordered_set<bsky::did> _blacklist;
+  std::unordered_set<bsky::did> _whitelist;
+  std::unordered_set<bsky::did> _ignored;
   mutable std::mutex _lock;
 };
 #endif
\ No newline at end of file
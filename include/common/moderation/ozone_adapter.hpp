@@ -68,10 +68,14 @@ public:
     return _filtered_subjects;
   }
 
-  typedef std::unordered_set<std::string> account_list;
+  typedef std::unordered_set<bsky::did> account_list;
   bool is_tracked(std::string const &did) const {
+    // an account not in use anywhere cannot be in the list
+    const bsky::did account(bsky::did::existing(did));
+    if (account.empty())
+      return false;
     std::lock_guard guard(_lock);
-    return _tracked_accounts.contains(did);
+    return _tracked_accounts.contains(account);
   }
   bool track_account(std::string const &did);
 
@@ -89,7 +93,7 @@ private:
   std::thread _thread;
   account_list _tracked_accounts;
   std::chrono::steady_clock::time_point _last_refresh;
-  std::unordered_set<std::string> _closed_reports;
+  account_list _closed_reports;
   pending_report_tags _pending_report_tags;
   content_reporters _content_reporters;
   filtered_subjects _filtered_subjects;
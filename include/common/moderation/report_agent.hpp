@@ -22,11 +22,11 @@ http://www.fsf.org/licensing/licenses
 #include <unordered_map>
 #include <unordered_set>
 
-#include "blockingconcurrentqueue.h"
 #include "common/activity/rate_observer.hpp"
 #include "common/bluesky/client.hpp"
 #include "common/bluesky/platform.hpp"
 #include "common/moderation/ozone_adapter.hpp"
+#include "common/stage_queue.hpp"
 #include "yaml-cpp/yaml.h"
 
 // per https://github.com/SteveTownsend/pef-moderation/issues/248
@@ -179,7 +179,7 @@ class report_agent {
   size_t _number_of_threads = DefaultNumberOfReportingThreads;
   std::string _project_name;
   // Declare queue between match post-processing and HTTP Client
-  moodycamel::BlockingConcurrentQueue<account_report> _queue;
+  stage_queue<account_report> _queue;
   std::string _handle;
   std::string _did;
   std::string _service_did;
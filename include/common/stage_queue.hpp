@@ -0,0 +1,123 @@
+#ifndef __stage_queue_hpp__
+#define __stage_queue_hpp__
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "blockingconcurrentqueue.h"
+#include "common/metrics_factory.hpp"
+#include "readerwriterqueue.h"
+#include <chrono>
+#include <iterator>
+#include <mutex>
+#include <prometheus/gauge.h>
+#include <prometheus/labels.h>
+#include <span>
+#include <type_traits>
+
+// Hand-off between pipeline stages. Payloads are moved in and out, never
+// copied, and the backlog gauge is resolved once rather than per message.
+// QUEUE is moodycamel::BlockingConcurrentQueue<T> for multiple producers, or
+// moodycamel::BlockingReaderWriterQueue<T> where there is a single producer.
+template <typename T, typename QUEUE = moodycamel::BlockingConcurrentQueue<T>>
+class stage_queue {
+public:
+  // backlog_labels identify this stage in the process_operation gauge
+  stage_queue(const size_t capacity, prometheus::Labels &&backlog_labels)
+      : _queue(capacity), _backlog_labels(std::move(backlog_labels)) {}
+  ~stage_queue() = default;
+  stage_queue(stage_queue const &) = delete;
+  stage_queue &operator=(stage_queue const &) = delete;
+
+  void enqueue(T &&value) {
+    _queue.enqueue(std::move(value));
+    backlog().Increment();
+  }
+
+  // moves all the values, leaving them in a moved-from state
+  void enqueue_bulk(std::span<T> values) {
+    if (values.empty())
+      return;
+    if constexpr (IsConcurrent) {
+      _queue.enqueue_bulk(std::make_move_iterator(values.begin()),
+                          values.size());
+    } else {
+      for (auto &value : values) {
+        _queue.enqueue(std::move(value));
+      }
+    }
+    backlog().Increment(static_cast<double>(values.size()));
+  }
+
+  void wait_dequeue(T &value) {
+    _queue.wait_dequeue(value);
+    backlog().Decrement();
+  }
+
+  template <typename Rep, typename Period>
+  bool wait_dequeue_timed(T &value,
+                          std::chrono::duration<Rep, Period> const &timeout) {
+    if (!_queue.wait_dequeue_timed(value, timeout))
+      return false;
+    backlog().Decrement();
+    return true;
+  }
+
+  // blocks for the first value, then takes whatever else is ready
+  size_t wait_dequeue_bulk(std::span<T> values) {
+    if (values.empty())
+      return 0;
+    size_t count(0);
+    if constexpr (IsConcurrent) {
+      count = _queue.wait_dequeue_bulk(values.begin(), values.size());
+    } else {
+      _queue.wait_dequeue(values.front());
+      count = 1;
+      while (count < values.size() && _queue.try_dequeue(values[count])) {
+        ++count;
+      }
+    }
+    backlog().Decrement(static_cast<double>(count));
+    return count;
+  }
+
+  inline size_t size_approx() const { return _queue.size_approx(); }
+
+private:
+  static constexpr bool IsConcurrent =
+      std::is_same_v<QUEUE, moodycamel::BlockingConcurrentQueue<T>>;
+
+  // Gauge families are registered at startup, possibly after the stage is
+  // constructed, so resolve on first use
+  prometheus::Gauge &backlog() {
+    std::call_once(_resolved, [this] {
+      _backlog = &metrics_factory::instance()
+                      .get_gauge("process_operation")
+                      .Get(_backlog_labels);
+    });
+    return *_backlog;
+  }
+
+  QUEUE _queue;
+  prometheus::Labels _backlog_labels;
+  std::once_flag _resolved;
+  prometheus::Gauge *_backlog = nullptr;
+};
+
+#endif
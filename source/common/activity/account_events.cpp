@@ -26,7 +26,7 @@ http://www.fsf.org/licensing/licenses
 #include <boost/fusion/adapted.hpp>
 
 BOOST_FUSION_ADAPT_STRUCT(
-    activity::account::statistics, (std::string, _did), (std::string, _handle),
+    activity::account::statistics, (bsky::did, _did), (std::string, _handle),
     (size_t, _event_count), (size_t, _alert_count), (size_t, _tags),
     (size_t, _links), (size_t, _mentions), (size_t, _facets), (int32_t, _posts),
     (int32_t, _replied_to), (int32_t, _replies), (int32_t, _quoted),
@@ -41,10 +41,10 @@ BOOST_FUSION_ADAPT_STRUCT(
 namespace activity {
 
 account::account(const did_type &did)
-    : _content_hits(std::make_shared<
-                    lfu_cache_at_uri_t<atproto::at_uri, content_hit_count>>(
-          MaxContentItems, CustomLFUCachePolicy<atproto::at_uri>(),
-          std::function<void(atproto::at_uri const &,
+    : _content_hits(std::make_shared<lfu_cache_at_uri_t<
+                        atproto::compact_at_uri, content_hit_count>>(
+          MaxContentItems, CustomLFUCachePolicy<atproto::compact_at_uri>(),
+          std::function<void(atproto::compact_at_uri const &,
                              std::shared_ptr<content_hit_count> const &)>(
               std::bind(&account::on_erase, this, std::placeholders::_1,
                         std::placeholders::_2)))) {
@@ -153,7 +153,7 @@ void account::statistics::alert() {
   }
 }
 
-void account::statistics::post(atproto::at_uri const &) {
+void account::statistics::post(atproto::compact_at_uri const &) {
   if (alert_needed(++_posts, PostFactor)) {
     REL_INFO("Account flagged posts {}/{} {}", _did, _handle, _posts);
     metrics_factory::instance()
@@ -247,7 +247,7 @@ void account::statistics::like() {
 }
 
 // Callback for tracked account removal
-void account::on_erase(atproto::at_uri const &uri,
+void account::on_erase(atproto::compact_at_uri const &uri,
                        caches::WrappedValue<content_hit_count> const &entry) {
   metrics_factory::instance()
       .get_gauge("process_operation")
@@ -272,7 +272,7 @@ void account::on_erase(atproto::at_uri const &uri,
 }
 
 caches::WrappedValue<content_hit_count>
-account::get_content_hits(atproto::at_uri const &uri) {
+account::get_content_hits(atproto::compact_at_uri const &uri) {
   if (!_content_hits->Cached(uri)) {
     _content_hits->Put(uri, {});
     metrics_factory::instance()
@@ -284,7 +284,7 @@ account::get_content_hits(atproto::at_uri const &uri) {
 }
 
 caches::WrappedValue<content_hit_count>
-account::get_content_item(const atproto::at_uri &uri) {
+account::get_content_item(const atproto::compact_at_uri &uri) {
   caches::WrappedValue<content_hit_count> content_hits(get_content_hits(uri));
   content_hits->hit();
   return content_hits;
@@ -441,7 +441,7 @@ augment_account_event::augment_account_event(event_cache &cache,
 
 void augment_account_event::augment_account_event::operator()(
     activity::post const &value) {
-  _stats.post(atproto::make_at_uri(_stats._did, value._ref));
+  _stats.post(atproto::compact_at_uri(_stats._did, value._ref));
 }
 
 void augment_account_event::augment_account_event::operator()(
@@ -453,13 +453,14 @@ void augment_account_event::augment_account_event::operator()(
 }
 void augment_account_event::augment_account_event::operator()(
     activity::repost const &value) {
-  auto post_account(_cache.get_account(value._post._authority));
+  auto post_account(_cache.get_account(value._post.authority()));
   post_account->get_statistics().reposted();
   auto content(post_account->get_content_item(value._post));
   if (alert_needed(++content->_reposts, account::ContentRepostFactor)) {
     content->alert();
-    REL_INFO("Account flagged content-reposts {}/{} {}", value._post._authority,
-             post_account->get_statistics()._handle, content->_reposts);
+    REL_INFO("Account flagged content-reposts {}/{} {}",
+             value._post.authority(), post_account->get_statistics()._handle,
+             content->_reposts);
     metrics_factory::instance()
         .get_counter("realtime_alerts")
         .Get({{"account", "content-reposts"}})
@@ -470,12 +471,12 @@ void augment_account_event::augment_account_event::operator()(
 }
 void augment_account_event::augment_account_event::operator()(
     activity::quote const &value) {
-  auto post_account(_cache.get_account(value._post._authority));
+  auto post_account(_cache.get_account(value._post.authority()));
   post_account->get_statistics().quoted();
   auto content(post_account->get_content_item(value._post));
   if (alert_needed(++content->_quotes, account::ContentQuoteFactor)) {
     content->alert();
-    REL_INFO("Account flagged content-quotes {}/{} {}", value._post._authority,
+    REL_INFO("Account flagged content-quotes {}/{} {}", value._post.authority(),
              post_account->get_statistics()._handle, content->_quotes);
     metrics_factory::instance()
         .get_counter("realtime_alerts")
@@ -496,7 +497,7 @@ void augment_account_event::augment_account_event::operator()(
       bsky::moderation::report_agent::instance().service_did()) {
     bsky::moderation::report_agent::instance().wait_enqueue(
         bsky::moderation::account_report(
-            _stats._did, bsky::moderation::blocks_moderation()));
+            _stats._did.to_string(), bsky::moderation::blocks_moderation()));
   }
 }
 void augment_account_event::augment_account_event::operator()(
@@ -508,14 +509,14 @@ void augment_account_event::augment_account_event::operator()(
 
 void augment_account_event::augment_account_event::operator()(
     activity::like const &value) {
-  auto liked_account(_cache.get_account(value._content._authority));
+  auto liked_account(_cache.get_account(value._content.authority()));
   liked_account->get_statistics().liked();
   auto content(liked_account->get_content_item(value._content));
   if (alert_needed(++content->_likes, account::ContentLikeFactor)) {
     content->alert();
     REL_INFO("Account flagged content-likes {}/{} {}",
-             value._content._authority, liked_account->get_statistics()._handle,
-             content->_likes);
+             value._content.authority(),
+             liked_account->get_statistics()._handle, content->_likes);
     metrics_factory::instance()
         .get_counter("realtime_alerts")
         .Get({{"account", "content-likes"}})
@@ -567,13 +568,13 @@ void augment_account_event::operator()(activity::facets const &value) {
 }
 
 void augment_account_event::augment_account_event::reply_to(
-    atproto::at_uri const &uri) {
-  auto account(_cache.get_account(uri._authority));
+    atproto::compact_at_uri const &uri) {
+  auto account(_cache.get_account(uri.authority()));
   account->get_statistics().replied_to();
   auto content(account->get_content_item(uri));
   if (alert_needed(++content->_replies, account::ContentReplyFactor)) {
     content->alert();
-    REL_INFO("Account flagged content-replies {}/{} {}", uri._authority,
+    REL_INFO("Account flagged content-replies {}/{} {}", uri.authority(),
              account->get_statistics()._handle, content->_replies);
     metrics_factory::instance()
         .get_counter("realtime_alerts")
@@ -26,8 +26,8 @@ namespace activity {
 
 event_cache::event_cache()
     : _account_events(
-          MaxAccounts, caches::LFUCachePolicy<std::string>(),
-          std::function<void(std::string const &,
+          MaxAccounts, caches::LFUCachePolicy<did_type>(),
+          std::function<void(did_type const &,
                              std::shared_ptr<account> const &)>(
               std::bind(&event_cache::on_erase, this, std::placeholders::_1,
                         std::placeholders::_2))) {}
@@ -44,7 +44,7 @@ void event_cache::record(timed_event const &value) {
   std::visit(augment_event{}, value._event);
 }
 
-caches::WrappedValue<account> event_cache::get_account(std::string const &did) {
+caches::WrappedValue<account> event_cache::get_account(did_type const &did) {
   std::lock_guard guard(_cache_lock);
   if (!_account_events.Cached(did)) {
     _account_events.Put(did, account(did));
@@ -57,7 +57,7 @@ caches::WrappedValue<account> event_cache::get_account(std::string const &did) {
 }
 
 // Callback for tracked account removal
-void event_cache::on_erase(std::string const &did,
+void event_cache::on_erase(did_type const &did,
                            caches::WrappedValue<account> const &account) {
   metrics_factory::instance()
       .get_gauge("process_operation")
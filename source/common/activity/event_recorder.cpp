@@ -22,32 +22,31 @@ http://www.fsf.org/licensing/licenses
 #include "common/bluesky/async_loader.hpp"
 #include "common/controller.hpp"
 #include "common/metrics_factory.hpp"
+#include <array>
 
 namespace activity {
-event_recorder::event_recorder() : _queue(MaxBacklog) {
+event_recorder::event_recorder()
+    : _queue(MaxBacklog, {{"events", "backlog"}}) {
   _thread = std::thread([&, this] {
     static size_t matches(0);
+    std::array<timed_event, DequeueBatch> my_payloads;
     while (controller::instance().is_active()) {
-      timed_event my_payload;
-      _queue.wait_dequeue(my_payload);
-      metrics_factory::instance()
-          .get_gauge("process_operation")
-          .Get({{"events", "backlog"}})
-          .Decrement();
-
+      size_t count(_queue.wait_dequeue_bulk(my_payloads));
       // record the activity
-      _events.record(my_payload);
+      for (size_t index = 0; index < count; ++index) {
+        _events.record(my_payloads[index]);
+      }
     }
     REL_INFO("event_recorder stopping");
   });
 }
 
 void event_recorder::wait_enqueue(timed_event &&value) {
-  _queue.enqueue(value);
-  metrics_factory::instance()
-      .get_gauge("process_operation")
-      .Get({{"events", "backlog"}})
-      .Increment();
+  _queue.enqueue(std::move(value));
+}
+
+void event_recorder::wait_enqueue_bulk(std::span<timed_event> values) {
+  _queue.enqueue_bulk(values);
 }
 
 std::string event_recorder::ensure_loaded(std::string const &did) {
@@ -60,16 +59,20 @@ std::string event_recorder::ensure_loaded(std::string const &did) {
 }
 
 caches::WrappedValue<account>
-event_recorder::add_if_needed(std::string const &did) {
+event_recorder::add_if_needed(did_type const &did) {
   return _events.get_account(did);
 }
 
 void event_recorder::update_handle(std::string const &did,
                                    std::string const &handle) {
-  add_if_needed(did)->get_statistics()._handle = handle;
+  add_if_needed(did_type(did))->get_statistics()._handle = handle;
 }
 
 std::string event_recorder::get_handle(std::string const &did) {
+  return get_handle(did_type(did));
+}
+
+std::string event_recorder::get_handle(did_type const &did) {
   return add_if_needed(did)->get_statistics()._handle;
 }
 
@@ -24,7 +24,8 @@ http://www.fsf.org/licensing/licenses
 #include "common/metrics_factory.hpp"
 
 namespace bsky {
-async_loader::async_loader() : _queue(MaxBacklog) {}
+async_loader::async_loader()
+    : _queue(MaxBacklog, {{"bsky_api", "backlog"}}) {}
 
 void async_loader::start(YAML::Node const &settings) {
   // create client
@@ -35,10 +36,6 @@ void async_loader::start(YAML::Node const &settings) {
     while (controller::instance().is_active()) {
       std::unordered_set<std::string> dids;
       _queue.wait_dequeue(dids);
-      metrics_factory::instance()
-          .get_gauge("process_operation")
-          .Get({{"bsky_api", "backlog"}})
-          .Decrement();
       try {
         if (dids.size() != 1) {
           // Avoid a backlog of batch invocations, all but the first should be
@@ -70,11 +67,7 @@ void async_loader::start(YAML::Node const &settings) {
 }
 
 void async_loader::wait_enqueue(std::unordered_set<std::string> &&value) {
-  _queue.enqueue(value);
-  metrics_factory::instance()
-      .get_gauge("process_operation")
-      .Get({{"bsky_api", "backlog"}})
-      .Increment();
+  _queue.enqueue(std::move(value));
 }
 
 } // namespace bsky
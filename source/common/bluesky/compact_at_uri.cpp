@@ -0,0 +1,197 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "common/bluesky/compact_at_uri.hpp"
+#include "common/log_wrapper.hpp"
+#include <array>
+#include <utility>
+
+namespace atproto {
+
+namespace {
+constexpr std::string_view Prefix = "at://";
+constexpr char TidAlphabet[] = "234567abcdefghijklmnopqrstuvwxyz";
+
+typedef compact_at_uri::collection collection;
+constexpr std::array<std::pair<collection, std::string_view>, 14> Collections{
+    {{collection::feed_post, "app.bsky.feed.post"},
+     {collection::feed_like, "app.bsky.feed.like"},
+     {collection::feed_repost, "app.bsky.feed.repost"},
+     {collection::feed_generator, "app.bsky.feed.generator"},
+     {collection::feed_threadgate, "app.bsky.feed.threadgate"},
+     {collection::feed_postgate, "app.bsky.feed.postgate"},
+     {collection::graph_follow, "app.bsky.graph.follow"},
+     {collection::graph_block, "app.bsky.graph.block"},
+     {collection::graph_list, "app.bsky.graph.list"},
+     {collection::graph_listitem, "app.bsky.graph.listitem"},
+     {collection::graph_listblock, "app.bsky.graph.listblock"},
+     {collection::graph_starterpack, "app.bsky.graph.starterpack"},
+     {collection::actor_profile, "app.bsky.actor.profile"},
+     {collection::labeler_service, "app.bsky.labeler.service"}}};
+
+// base32-sortable digit value, -1 if there is none
+inline int tid_value(const char next) {
+  if (next >= '2' && next <= '7')
+    return next - '2';
+  if (next >= 'a' && next <= 'z')
+    return next - 'a' + 6;
+  return -1;
+}
+} // namespace
+
+namespace tid {
+std::optional<uint64_t> parse(std::string_view text) {
+  if (text.size() != Length)
+    return std::nullopt;
+  uint64_t value(0);
+  for (size_t index = 0; index < Length; ++index) {
+    const int digit(tid_value(text[index]));
+    // 65 bits of digits, the first must leave the top bit clear
+    if (digit < 0 || (index == 0 && digit >= 16))
+      return std::nullopt;
+    value = (value << 5) | static_cast<uint64_t>(digit);
+  }
+  return value;
+}
+
+std::string to_string(const uint64_t value) {
+  std::string result(Length, '2');
+  for (size_t index = 0; index < Length; ++index) {
+    result[Length - 1 - index] = TidAlphabet[(value >> (5 * index)) & 0x1f];
+  }
+  return result;
+}
+} // namespace tid
+
+compact_at_uri::collection
+compact_at_uri::collection_of(std::string_view name) {
+  // a short scan costs less than hashing the name
+  for (auto const &known : Collections) {
+    if (known.second == name)
+      return known.first;
+  }
+  return name.empty() ? collection::none : collection::other;
+}
+
+std::string_view compact_at_uri::name_of(const collection value) {
+  for (auto const &known : Collections) {
+    if (known.first == value)
+      return known.second;
+  }
+  return {};
+}
+
+compact_at_uri::compact_at_uri(std::string_view uri) {
+  if (uri.empty())
+    return;
+  if (!uri.starts_with(Prefix)) {
+    REL_ERROR("Malformed at-uri {}", uri);
+    return;
+  }
+  uri.remove_prefix(Prefix.size());
+  const size_t authority_end(uri.find('/'));
+  const std::string_view authority(uri.substr(0, authority_end));
+  if (authority.empty()) {
+    REL_ERROR("Blank authority in at-uri {}", uri);
+    return;
+  }
+  _authority = bsky::did(authority);
+  if (authority_end != std::string_view::npos) {
+    assign_path(uri.substr(authority_end + 1));
+  }
+}
+
+compact_at_uri::compact_at_uri(bsky::did const &authority,
+                               std::string_view path)
+    : _authority(authority) {
+  assign_path(path);
+}
+
+void compact_at_uri::assign_path(std::string_view path) {
+  const size_t collection_end(path.find('/'));
+  const std::string_view name(path.substr(0, collection_end));
+  std::string_view key;
+  if (collection_end != std::string_view::npos) {
+    key = path.substr(collection_end + 1);
+    // anything after the record key is not part of the URI
+    key = key.substr(0, key.find('/'));
+  }
+  _collection = collection_of(name);
+  if (_collection == collection::none)
+    return;
+  if (_collection == collection::other) {
+    _tail.reserve(name.size() + 1 + key.size());
+    _tail.assign(name);
+    if (!key.empty()) {
+      _tail.push_back('/');
+      _tail.append(key);
+    }
+    return;
+  }
+  if (key.empty())
+    return;
+  // the canonical TID spelling is the only one that parses
+  if (auto value = tid::parse(key)) {
+    _has_tid = true;
+    _tid = *value;
+  } else {
+    _tail.assign(key);
+  }
+}
+
+std::string_view compact_at_uri::collection_name() const {
+  if (_collection == collection::other)
+    return std::string_view(_tail).substr(0, _tail.find('/'));
+  return name_of(_collection);
+}
+
+std::string compact_at_uri::rkey() const {
+  if (_has_tid)
+    return tid::to_string(_tid);
+  if (_collection == collection::other) {
+    const size_t separator(_tail.find('/'));
+    return separator == std::string::npos ? std::string()
+                                          : _tail.substr(separator + 1);
+  }
+  return _tail;
+}
+
+compact_at_uri::operator std::string() const {
+  if (_authority.empty())
+    return {};
+  std::string result(Prefix);
+  result.append(_authority.to_string());
+  if (_collection == collection::none)
+    return result;
+  result.push_back('/');
+  if (_collection == collection::other) {
+    result.append(_tail);
+    return result;
+  }
+  result.append(name_of(_collection));
+  const std::string key(rkey());
+  if (!key.empty()) {
+    result.push_back('/');
+    result.append(key);
+  }
+  return result;
+}
+
+} // namespace atproto
@@ -0,0 +1,280 @@
+/*************************************************************************
+Public Education Forum Moderation Firehose Client
+Copyright (c) Steve Townsend 2025
+
+>>> SOURCE LICENSE >>>
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation (www.fsf.org); either version 3 of the
+License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+A copy of the GNU General Public License is available at
+http://www.fsf.org/licensing/licenses
+>>> END OF LICENSE >>>
+*************************************************************************/
+
+#include "common/bluesky/did.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace bsky {
+
+namespace {
+constexpr std::string_view PlcPrefix = "did:plc:";
+constexpr size_t PlcLength = 24;
+constexpr char Base32Alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+
+// index of a lower case RFC 4648 base32 character, -1 if there is none
+inline int base32_value(const char next) {
+  if (next >= 'a' && next <= 'z')
+    return next - 'a';
+  if (next >= '2' && next <= '7')
+    return next - '2' + 26;
+  return -1;
+}
+
+// identifiers are hash-derived but a DID from elsewhere need not be, so mix
+// all 120 bits
+inline size_t plc_hash(did_interner::packed_plc const &packed) {
+  uint64_t high, low;
+  std::memcpy(&high, packed.data(), sizeof(high));
+  std::memcpy(&low, packed.data() + packed.size() - sizeof(low), sizeof(low));
+  const uint64_t mixed((high ^ (low * 0x9e3779b97f4a7c15ULL)) *
+                       0xff51afd7ed558ccdULL);
+  return static_cast<size_t>(mixed ^ (mixed >> 32));
+}
+} // namespace
+
+// Never destroyed: singletons built before the first did hold dids, and
+// release them as they are destroyed after main returns
+did_interner &did_interner::instance() {
+  static did_interner *interner = new did_interner;
+  return *interner;
+}
+
+did_interner::did_interner()
+    : _chunks(std::make_unique<std::unique_ptr<entry[]>[]>(MaxChunks)),
+      _slots(1024, EmptySlot) {}
+
+bool did_interner::pack_plc(std::string_view text, packed_plc &packed) {
+  if (text.size() != PlcPrefix.size() + PlcLength ||
+      !text.starts_with(PlcPrefix))
+    return false;
+  text.remove_prefix(PlcPrefix.size());
+  // 8 characters to 5 bytes at a time
+  for (size_t group = 0; group < PlcLength / 8; ++group) {
+    uint64_t bits(0);
+    for (size_t index = 0; index < 8; ++index) {
+      const int value(base32_value(text[group * 8 + index]));
+      if (value < 0)
+        return false;
+      bits = (bits << 5) | static_cast<uint64_t>(value);
+    }
+    for (size_t index = 0; index < 5; ++index) {
+      packed[group * 5 + index] =
+          static_cast<uint8_t>(bits >> (32 - 8 * index));
+    }
+  }
+  return true;
+}
+
+std::string did_interner::unpack_plc(packed_plc const &packed) {
+  std::string result(PlcPrefix);
+  result.reserve(PlcPrefix.size() + PlcLength);
+  for (size_t group = 0; group < PlcLength / 8; ++group) {
+    uint64_t bits(0);
+    for (size_t index = 0; index < 5; ++index) {
+      bits = (bits << 8) | packed[group * 5 + index];
+    }
+    for (size_t index = 0; index < 8; ++index) {
+      result.push_back(Base32Alphabet[(bits >> (35 - 5 * index)) & 0x1f]);
+    }
+  }
+  return result;
+}
+
+did_interner::key did_interner::key_of(std::string_view text) {
+  key result;
+  result._text = text;
+  if (pack_plc(text, result._packed)) {
+    result._form = form::plc;
+    result._hash = plc_hash(result._packed);
+  } else {
+    result._hash = std::hash<std::string_view>()(text);
+  }
+  return result;
+}
+
+bool did_interner::matches(const id_type id, key const &lookup) const {
+  entry const &candidate(entry_at(id));
+  if (candidate._form != lookup._form)
+    return false;
+  if (lookup._form == form::plc)
+    return candidate._packed == lookup._packed;
+  auto text(_other_text.find(id));
+  return text != _other_text.cend() && text->second == lookup._text;
+}
+
+size_t did_interner::hash_of(const id_type id) const {
+  entry const &existing(entry_at(id));
+  if (existing._form == form::plc)
+    return plc_hash(existing._packed);
+  return std::hash<std::string_view>()(_other_text.at(id));
+}
+
+size_t did_interner::find_slot(key const &lookup) const {
+  const size_t mask(_slots.size() - 1);
+  size_t index(lookup._hash & mask);
+  while (_slots[index] != EmptySlot) {
+    if (_slots[index] != DeletedSlot && matches(_slots[index], lookup))
+      return index;
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+did_interner::id_type did_interner::acquire_existing(std::string_view text) {
+  const key lookup(key_of(text));
+  std::shared_lock guard(_lock);
+  const id_type id(_slots[find_slot(lookup)]);
+  if (id != EmptySlot) {
+    add_reference(id);
+  }
+  return id;
+}
+
+did_interner::id_type did_interner::acquire(std::string_view text) {
+  const key lookup(key_of(text));
+  {
+    std::shared_lock guard(_lock);
+    const id_type id(_slots[find_slot(lookup)]);
+    if (id != EmptySlot) {
+      add_reference(id);
+      return id;
+    }
+  }
+  std::unique_lock guard(_lock);
+  // another thread may have added it
+  const size_t slot(find_slot(lookup));
+  if (_slots[slot] != EmptySlot) {
+    add_reference(_slots[slot]);
+    return _slots[slot];
+  }
+  const id_type id(allocate());
+  entry &added(entry_at(id));
+  added._form = lookup._form;
+  added._packed = lookup._packed;
+  if (lookup._form == form::other) {
+    _other_text.insert({id, std::string(text)});
+  }
+  added._references.store(1, std::memory_order_relaxed);
+  insert_slot(id, lookup._hash);
+  ++_live;
+  return id;
+}
+
+void did_interner::release(const id_type id) {
+  entry &released(entry_at(id));
+  if (released._references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  std::unique_lock guard(_lock);
+  // reacquired by lookup, or already freed by an earlier last release
+  if (released._references.load(std::memory_order_acquire) != 0 ||
+      released._form == form::free)
+    return;
+  const size_t mask(_slots.size() - 1);
+  size_t index(hash_of(id) & mask);
+  while (_slots[index] != id) {
+    index = (index + 1) & mask;
+  }
+  _slots[index] = DeletedSlot;
+  if (released._form == form::other) {
+    _other_text.erase(id);
+  }
+  released._form = form::free;
+  released._packed = {};
+  _free.push_back(id);
+  --_live;
+}
+
+std::string did_interner::to_string(const id_type id) const {
+  entry const &existing(entry_at(id));
+  // packed form does not change while a reference is held
+  if (existing._form == form::plc)
+    return unpack_plc(existing._packed);
+  std::shared_lock guard(_lock);
+  auto text(_other_text.find(id));
+  return text == _other_text.cend() ? std::string() : text->second;
+}
+
+size_t did_interner::size() const {
+  std::shared_lock guard(_lock);
+  return _live;
+}
+
+size_t did_interner::memory_bytes() const {
+  std::shared_lock guard(_lock);
+  return _chunk_count * ChunkSize * sizeof(entry) +
+         _slots.capacity() * sizeof(id_type) +
+         _free.capacity() * sizeof(id_type);
+}
+
+did_interner::id_type did_interner::allocate() {
+  if (!_free.empty()) {
+    const id_type id(_free.back());
+    _free.pop_back();
+    return id;
+  }
+  if ((_next >> ChunkBits) == _chunk_count) {
+    if (_chunk_count == MaxChunks)
+      throw std::length_error("DID interner is full");
+    _chunks[_chunk_count++] = std::make_unique<entry[]>(ChunkSize);
+  }
+  return _next++;
+}
+
+void did_interner::insert_slot(const id_type id, const size_t hash) {
+  // at most half the slots are live or deleted
+  if (2 * (_used_slots + 1) > _slots.size()) {
+    grow();
+  }
+  const size_t mask(_slots.size() - 1);
+  size_t index(hash & mask);
+  while (_slots[index] != EmptySlot && _slots[index] != DeletedSlot) {
+    index = (index + 1) & mask;
+  }
+  if (_slots[index] == EmptySlot) {
+    ++_used_slots;
+  }
+  _slots[index] = id;
+}
+
+// rebuild without deleted slots, doubling when a quarter or more are live
+void did_interner::grow() {
+  std::vector<id_type> previous(std::move(_slots));
+  _slots.assign(std::max<size_t>(std::bit_ceil(4 * (_live + 1)),
+                                 previous.size()),
+                EmptySlot);
+  _used_slots = 0;
+  const size_t mask(_slots.size() - 1);
+  for (id_type id : previous) {
+    if (id == EmptySlot || id == DeletedSlot)
+      continue;
+    size_t index(hash_of(id) & mask);
+    while (_slots[index] != EmptySlot) {
+      index = (index + 1) & mask;
+    }
+    _slots[index] = id;
+    ++_used_slots;
+  }
+}
+
+} // namespace bsky
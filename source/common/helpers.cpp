@@ -90,8 +90,95 @@ embed_type embed_type_from_string(std::string_view embed_type_str) {
   return embed_type::invalid;
 }
 
+namespace {
+// value of `count` ASCII digits at `offset`, -1 if any is not a digit
+inline int digits_at(std::string_view text, const size_t offset,
+                     const size_t count) {
+  int value(0);
+  for (size_t index = offset; index < offset + count; ++index) {
+    const unsigned digit(static_cast<unsigned char>(text[index]) - '0');
+    if (digit > 9)
+      return -1;
+    value = value * 10 + static_cast<int>(digit);
+  }
+  return value;
+}
+} // namespace
+
+bsky::time_stamp time_stamp_from_iso_8601(std::string_view date_time) {
+  std::optional<bsky::time_stamp> fast(
+      fast_time_stamp_from_iso_8601(date_time));
+  if (fast)
+    return *fast;
+  return parsed_time_stamp_from_iso_8601(std::string(date_time));
+}
+
+// No allocation. Fractional seconds of any length truncate to milliseconds,
+// as the cast in the parsed path does. Leap seconds, pre-1971 dates and
+// anything else unusual are left to std::chrono::parse.
+std::optional<bsky::time_stamp>
+fast_time_stamp_from_iso_8601(std::string_view date_time) {
+  if (date_time.size() < 20 || date_time[4] != '-' || date_time[7] != '-' ||
+      date_time[10] != 'T' || date_time[13] != ':' || date_time[16] != ':')
+    return std::nullopt;
+  const int year(digits_at(date_time, 0, 4));
+  const int month(digits_at(date_time, 5, 2));
+  const int day(digits_at(date_time, 8, 2));
+  const int hour(digits_at(date_time, 11, 2));
+  const int minute(digits_at(date_time, 14, 2));
+  const int second(digits_at(date_time, 17, 2));
+  if (year < 1971 || month < 0 || day < 0 || hour < 0 || hour > 23 ||
+      minute < 0 || minute > 59 || second < 0 || second > 59)
+    return std::nullopt;
+  const std::chrono::year_month_day date{
+      std::chrono::year(year), std::chrono::month(static_cast<unsigned>(month)),
+      std::chrono::day(static_cast<unsigned>(day))};
+  if (!date.ok())
+    return std::nullopt;
+
+  size_t next(19);
+  int milliseconds(0);
+  if (date_time[next] == '.') {
+    size_t digits(0);
+    for (++next; next < date_time.size(); ++next, ++digits) {
+      const unsigned digit(static_cast<unsigned char>(date_time[next]) - '0');
+      if (digit > 9)
+        break;
+      if (digits < 3) {
+        milliseconds = milliseconds * 10 + static_cast<int>(digit);
+      }
+    }
+    if (digits == 0)
+      return std::nullopt;
+    for (; digits < 3; ++digits) {
+      milliseconds *= 10;
+    }
+  }
+
+  std::string_view zone(date_time.substr(next));
+  std::chrono::minutes offset(0);
+  if (zone.size() == 6 && (zone[0] == '+' || zone[0] == '-') &&
+      zone[3] == ':') {
+    const int offset_hours(digits_at(zone, 1, 2));
+    const int offset_minutes(digits_at(zone, 4, 2));
+    if (offset_hours < 0 || offset_hours > 23 || offset_minutes < 0 ||
+        offset_minutes > 59)
+      return std::nullopt;
+    offset = std::chrono::minutes(offset_hours * 60 + offset_minutes);
+    if (zone[0] == '-') {
+      offset = -offset;
+    }
+  } else if (zone != "Z") {
+    return std::nullopt;
+  }
+  // local time minus its offset is UTC
+  return std::chrono::sys_days(date) + std::chrono::hours(hour) +
+         std::chrono::minutes(minute) + std::chrono::seconds(second) +
+         std::chrono::milliseconds(milliseconds) - offset;
+}
+
 // Parse ISO8601 time permissively
-bsky::time_stamp time_stamp_from_iso_8601(std::string const &date_time) {
+bsky::time_stamp parsed_time_stamp_from_iso_8601(std::string const &date_time) {
   std::istringstream is(date_time);
   bsky::parse_time_stamp tp;
   // is >> date::parse<bsky::parse_time_stamp, char>(UtcDefault, tp);
@@ -238,6 +325,80 @@ std::wstring to_canonical(std::string_view const input) {
   return std::wstring(&case_folded.front(), &case_folded.front() + new_size);
 }
 
+namespace {
+inline bool is_ascii(const char next) {
+  return static_cast<unsigned char>(next) < 0x80;
+}
+
+// Case-fold UTF-8 onto the end of output, via UTF-16 in per-thread buffers
+// so there is no allocation once they have grown. Ill-formed input becomes
+// U+FFFD.
+bool append_folded(std::string_view const input, std::string &output) {
+  thread_local std::vector<UChar> utf16;
+  thread_local std::vector<UChar> folded;
+  // a UTF-8 sequence never needs more UTF-16 units than it has bytes
+  utf16.resize(input.length());
+  icu::ErrorCode error_code;
+  int32_t length(0);
+  u_strFromUTF8WithSub(utf16.data(), static_cast<int32_t>(utf16.size()),
+                       &length, input.data(),
+                       static_cast<int32_t>(input.length()), 0xfffd, nullptr,
+                       (UErrorCode *)error_code);
+  if (error_code.isFailure()) {
+    REL_ERROR("fold_non_ascii: u_strFromUTF8 error {}",
+              error_code.errorName());
+    return false;
+  }
+  // full case folding expands a unit to at most three
+  folded.resize(static_cast<size_t>(length) * 3);
+  int32_t folded_length(u_strFoldCase(
+      folded.data(), static_cast<int32_t>(folded.size()), utf16.data(),
+      length, U_FOLD_CASE_DEFAULT, (UErrorCode *)error_code));
+  if (error_code.isFailure()) {
+    REL_ERROR("fold_non_ascii: u_strFoldCase error {}",
+              error_code.errorName());
+    return false;
+  }
+  // and a UTF-16 unit to at most three UTF-8 bytes
+  const size_t offset(output.length());
+  output.resize(offset + static_cast<size_t>(folded_length) * 3);
+  int32_t written(0);
+  u_strToUTF8(output.data() + offset,
+              static_cast<int32_t>(output.length() - offset), &written,
+              folded.data(), folded_length, (UErrorCode *)error_code);
+  if (error_code.isFailure()) {
+    REL_ERROR("fold_non_ascii: u_strToUTF8 error {}", error_code.errorName());
+    output.resize(offset);
+    return false;
+  }
+  output.resize(offset + static_cast<size_t>(written));
+  return true;
+}
+} // namespace
+
+// One ICU pass from the first non-ASCII byte. Folding ASCII along with it
+// is redundant but splitting the text into runs costs more in ICU calls.
+std::string_view fold_non_ascii(std::string_view const input,
+                                std::string &scratch) {
+  auto first(std::ranges::find_if_not(input, is_ascii));
+  if (first == input.cend())
+    return input;
+  scratch.assign(input.cbegin(), first);
+  if (!append_folded(std::string_view(first, input.cend()), scratch))
+    return std::string_view();
+  return scratch;
+}
+
+std::string to_canonical_utf8(std::string_view const input) {
+  std::string scratch;
+  std::string result(fold_non_ascii(input, scratch));
+  std::ranges::transform(result, result.begin(), [](const char next) {
+    return next >= 'A' && next <= 'Z' ? static_cast<char>(next - 'A' + 'a')
+                                      : next;
+  });
+  return result;
+}
+
 std::string wstring_to_utf8(std::wstring const &rc_string) {
   return wstring_to_utf8(
       std::wstring_view(rc_string.c_str(), rc_string.length()));
@@ -101,7 +101,8 @@ list_manager &list_manager::instance() {
   return my_instance;
 }
 
-list_manager::list_manager() : _queue(QueueLimit) {}
+list_manager::list_manager()
+    : _queue(QueueLimit, {{"list_manager", "backlog"}}) {}
 
 void list_manager::start(YAML::Node const &settings) {
   _handle = settings["handle"].as<std::string>();
@@ -121,11 +122,6 @@ void list_manager::start(YAML::Node const &settings) {
         block_list_addition to_block;
         if (_queue.wait_dequeue_timed(to_block, DequeueTimeout)) {
           // process the item
-          metrics_factory::instance()
-              .get_gauge("process_operation")
-              .Get({{"list_manager", "backlog"}})
-              .Decrement();
-
           // do not process if whitelisted
           if (bsky::moderation::ozone_adapter::instance().already_processed(
                   to_block._did)) {
@@ -159,11 +155,7 @@ void list_manager::start(YAML::Node const &settings) {
 }
 
 void list_manager::wait_enqueue(block_list_addition &&value) {
-  _queue.enqueue(value);
-  metrics_factory::instance()
-      .get_gauge("process_operation")
-      .Get({{"list_manager", "backlog"}})
-      .Increment();
+  _queue.enqueue(std::move(value));
 }
 
 void list_manager::lazy_load_managed_lists() {
@@ -375,42 +367,46 @@ atproto::at_uri list_manager::add_account_to_list_and_group(
 }
 
 void list_manager::update_blacklist(
-    std::unordered_set<std::string> new_blacklist) {
+    std::unordered_set<bsky::did> new_blacklist) {
   std::lock_guard<std::mutex> lock{_lock};
   // add new blacklist entries to Moderation List
   std::ranges::for_each(
-      new_blacklist | std::views::filter([&](const std::string &did) {
+      new_blacklist | std::views::filter([&](const bsky::did &did) {
         return !_blacklist.contains(did);
       }),
-      [&](const std::string &did) {
+      [&](const bsky::did &did) {
         list_manager::instance().wait_enqueue(
-            {did, std::string(BlacklistName)});
+            {did.to_string(), std::string(BlacklistName)});
       });
   std::swap(_blacklist, new_blacklist);
 }
 
 void list_manager::update_whitelist(
-    std::unordered_set<std::string> new_whitelist) {
+    std::unordered_set<bsky::did> new_whitelist) {
   std::lock_guard<std::mutex> lock{_lock};
   std::swap(_whitelist, new_whitelist);
 }
 
-void list_manager::update_ignored(std::unordered_set<std::string> new_ignored) {
+void list_manager::update_ignored(std::unordered_set<bsky::did> new_ignored) {
   std::lock_guard<std::mutex> lock{_lock};
   std::swap(_ignored, new_ignored);
 }
 
 bool list_manager::skip_account(std::string const &did) const {
+  // every listed account holds a reference, so one not in use is not listed
+  const bsky::did account(bsky::did::existing(did));
+  if (account.empty())
+    return false;
   std::lock_guard<std::mutex> lock{_lock};
-  if (_blacklist.contains(did)) {
+  if (_blacklist.contains(account)) {
     REL_INFO("Skipping blacklisted account {}", did);
     return true;
   }
-  if (_whitelist.contains(did)) {
+  if (_whitelist.contains(account)) {
     REL_INFO("Processing whitelisted account {}", did);
     return true;
   }
-  if (_ignored.contains(did)) {
+  if (_ignored.contains(account)) {
     REL_INFO("Skipping ignored account {}", did);
     return true;
   }
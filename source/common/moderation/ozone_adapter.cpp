@@ -81,7 +81,7 @@ void ozone_adapter::check_refresh_tracked_accounts() {
              "where mss.\"reviewState\" in "
              "('tools.ozone.moderation.defs#reviewOpen', "
              "'tools.ozone.moderation.defs#reviewEscalated')")) {
-      new_tracked.insert(did);
+      new_tracked.emplace(did);
     }
     // Closed reports at account level
     decltype(_closed_reports) new_closed;
@@ -90,8 +90,9 @@ void ozone_adapter::check_refresh_tracked_accounts() {
              "(mss.\"recordPath\" <> '') IS NOT true AND "
              "(mss.\"reviewState\" = "
              "'tools.ozone.moderation.defs#reviewClosed')")) {
-      if (!new_tracked.contains(did)) {
-        new_closed.insert(did);
+      bsky::did account(did);
+      if (!new_tracked.contains(account)) {
+        new_closed.insert(std::move(account));
       }
     }
 
@@ -105,14 +106,14 @@ void ozone_adapter::check_refresh_tracked_accounts() {
     _closed_reports.swap(new_closed);
     // make tracked accounts sticky in the tracked account event cache by
     // touching them each time
-    new_tracked.clear();
+    std::unordered_set<std::string> unnamed;
     for (auto const &account : _tracked_accounts) {
       auto handle(activity::event_recorder::instance().get_handle(account));
       if (handle.empty()) {
-        new_tracked.insert(account);
+        unnamed.insert(account.to_string());
       }
     }
-    bsky::async_loader::instance().wait_enqueue(std::move(new_tracked));
+    bsky::async_loader::instance().wait_enqueue(std::move(unnamed));
     _last_refresh = std::chrono::steady_clock::now();
   }
 }
@@ -276,8 +277,11 @@ void ozone_adapter::filter_subjects(std::string const &filter) {
 }
 
 bool ozone_adapter::already_processed(std::string const &did) const {
+  const bsky::did account(bsky::did::existing(did));
+  if (account.empty())
+    return false;
   std::lock_guard guard(_lock);
-  return _closed_reports.contains(did);
+  return _closed_reports.contains(account);
 }
 
 // mask the password
@@ -303,7 +307,7 @@ std::string ozone_adapter::safe_connection_string() const {
 // run
 bool ozone_adapter::track_account(std::string const &did) {
   std::lock_guard guard(_lock);
-  return _tracked_accounts.insert(did).second;
+  return _tracked_accounts.emplace(did).second;
 }
 } // namespace moderation
 } // namespace bsky
\ No newline at end of file
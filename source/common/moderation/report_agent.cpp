@@ -58,7 +58,8 @@ report_agent &report_agent::instance() {
   return my_instance;
 }
 
-report_agent::report_agent() : _queue(QueueLimit) {}
+report_agent::report_agent()
+    : _queue(QueueLimit, {{"report_agent", "backlog"}}) {}
 
 void report_agent::start(YAML::Node const &settings,
                          std::string const &project_name) {
@@ -82,11 +83,6 @@ void report_agent::start(YAML::Node const &settings,
           account_report report;
           if (_queue.wait_dequeue_timed(report, DequeueTimeout)) {
             // process the item
-            metrics_factory::instance()
-                .get_gauge("process_operation")
-                .Get({{"report_agent", "backlog"}})
-                .Decrement();
-
             // Track all reported accounts
             if (bsky::moderation::ozone_adapter::instance().track_account(
                     report._did)) {
@@ -116,11 +112,7 @@ void report_agent::start(YAML::Node const &settings,
 }
 
 void report_agent::wait_enqueue(account_report &&value) {
-  _queue.enqueue(value);
-  metrics_factory::instance()
-      .get_gauge("process_operation")
-      .Get({{"report_agent", "backlog"}})
-      .Increment();
+  _queue.enqueue(std::move(value));
 }
 
 // TODO add metrics